@@ -0,0 +1,37 @@
+#include <notify-cpp/watch_server.h>
+
+#include <csignal>
+#include <iostream>
+#include <thread>
+
+#include <pthread.h>
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) {
+        std::cout << "Usage: notify-cppd /path/to/socket" << std::endl;
+        return 1;
+    }
+
+    // SIGINT and SIGTERM are taken by sigwait below, not by any thread
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    try {
+        notifycpp::WatchServer server(argv[1]);
+        std::thread thread([&server]() { server.run(); });
+
+        int signal = 0;
+        sigwait(&signals, &signal);
+
+        server.stop();
+        thread.join();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <notify-cpp/string_table.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+namespace notifycpp {
+
+struct ChangedPath {
+    std::filesystem::path path;
+    //! logical clock of the last change
+    std::uint64_t clock;
+};
+
+/**
+ * @brief Last change of every path by logical clock
+ *
+ * Paths are interned once and linked into a list ordered by their last
+ * change, a change moves the path to the end. changedSince() walks the
+ * list backwards and stops at the first older change, so it costs the
+ * number of paths changed since then and not the number of known paths.
+ *
+ * Paths are never forgotten, a removed path stays as changed.
+ */
+class ChangeIndex {
+public:
+    ChangeIndex();
+
+    void record(std::string_view path, std::uint64_t clock);
+
+    std::vector<ChangedPath> changedSince(std::uint64_t clock, const std::filesystem::path& root = {}) const;
+
+    std::size_t size() const;
+
+private:
+    struct Entry {
+        std::uint64_t clock;
+        StringTable::Id previous;
+        StringTable::Id next;
+    };
+
+    static bool isBelow(std::string_view path, std::string_view root);
+
+    StringTable _Paths;
+    //! indexed by path id
+    std::vector<Entry> _Entries;
+    StringTable::Id _Oldest;
+    StringTable::Id _Newest;
+
+    mutable std::shared_mutex _Mutex;
+};
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <notify-cpp/file_system_event.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace notifycpp {
+
+enum class ChangeType { created,
+    removed,
+    modified,
+    renamed };
+
+struct Change {
+    ChangeType type;
+    std::filesystem::path path;
+    //! previous path of a renamed entry
+    std::filesystem::path from;
+};
+
+using ChangeSet = std::vector<Change>;
+using ChangeSetObserver = std::function<void(const ChangeSet&)>;
+
+/**
+ * @brief Accumulates events into their net effect per path
+ *
+ * A file created and deleted again cancels out, a temporary file
+ * written and renamed onto a target becomes a modification of the
+ * target and repeated modifications are merged. Access, open and
+ * close_nowrite events don't change anything and are skipped.
+ *
+ * A moved_from directly followed by a moved_to with the same cookie
+ * is a rename, the kernel queues both halves next to each other. An
+ * unpaired moved_from is a removal and an unpaired moved_to a
+ * modification, because it is unknown whether the target existed.
+ * For the same reason a path that only appeared as rename target and
+ * is gone again is reported as removed.
+ */
+class ChangeSetBuilder {
+public:
+    ChangeSetBuilder();
+
+    void add(const FileSystemEvent&);
+
+    ChangeSet take();
+
+    bool empty() const;
+
+private:
+    enum class Existence : std::uint8_t { unknown,
+        absent,
+        present };
+
+    struct Entry {
+        //! state when the change set was started
+        Existence before;
+        bool exists;
+        bool modified;
+        //! content is the one the path had when the change set was started
+        bool original;
+        //! content moved to another path, reported by its rename
+        bool movedAway;
+        //! original path of content moved here
+        std::string origin;
+    };
+
+    Entry& entry(const std::string&, Existence);
+    void release(Entry&);
+
+    void create(const std::string&);
+    void remove(const std::string&);
+    void modify(const std::string&);
+    void rename(const std::string& from, const std::string& to);
+    void moveIn(const std::string&);
+    void flushMove();
+
+    std::map<std::string, Entry> _Entries;
+    std::string _MovedFrom;
+    std::uint32_t _MovedFromCookie;
+    bool _HasMovedFrom;
+};
+}
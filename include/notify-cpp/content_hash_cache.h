@@ -0,0 +1,103 @@
+#pragma once
+
+#include <notify-cpp/file_system_event.h>
+#include <notify-cpp/snapshot.h>
+#include <notify-cpp/thread_pool.h>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace notifycpp {
+
+//! a file with these values has the content it had when it was hashed
+struct FileIdentity {
+    std::uint64_t device = 0;
+    std::uint64_t inode = 0;
+    std::uint64_t size = 0;
+    //! modification time in nanoseconds since the epoch
+    std::int64_t mtime = 0;
+
+    bool operator==(const FileIdentity&) const;
+};
+
+struct ContentHashStatistics {
+    std::size_t hits = 0;
+    std::size_t hashed = 0;
+    std::size_t entries = 0;
+};
+
+/**
+ * @brief XXH64 digests of file contents, computed at most once per file
+ *        version and invalidated by the events of a NotifyController
+ *
+ * Digests are keyed by the identity of the file, so a renamed file keeps
+ * its digest. modify, close_write, delete and replaced drop the digest of
+ * the path, an event also catches a rewrite within the resolution of the
+ * mtime. overflow drops everything.
+ *
+ * With threads the files are hashed again on close_write and moved_to in
+ * the background, otherwise on the next call to hash(). Files are read
+ * with large preads, a file changing while it is read is hashed but not
+ * cached. Neither is a file whose mtime is within one tick of the mtime
+ * clock of the start of hashing, a write in the same tick would not
+ * change its identity.
+ */
+class ContentHashCache {
+public:
+    explicit ContentHashCache(std::size_t threads = 0);
+    ~ContentHashCache();
+    ContentHashCache(const ContentHashCache&) = delete;
+    ContentHashCache& operator=(const ContentHashCache&) = delete;
+
+    std::uint64_t hash(const std::filesystem::path&);
+
+    void invalidate(const FileSystemEvent&);
+    void clear();
+
+    void load(const Snapshot&);
+    std::vector<Snapshot::HashRecord> records() const;
+    //! changes whenever a digest was added or dropped
+    std::uint64_t generation() const;
+
+    ContentHashStatistics getStatistics() const;
+
+private:
+    struct IdentityHash {
+        std::size_t operator()(const FileIdentity&) const;
+    };
+
+    //! digest last computed for a path
+    struct PathEntry {
+        FileIdentity identity;
+        //! set while the file is read
+        bool pending;
+        std::uint64_t token;
+    };
+
+    std::string key(const std::filesystem::path&) const;
+    void forget(const std::string&);
+    void schedule(const std::filesystem::path&);
+
+    const std::filesystem::path _WorkingDirectory;
+
+    mutable std::shared_mutex _Mutex;
+    std::unordered_map<FileIdentity, std::uint64_t, IdentityHash> _Hashes;
+    std::unordered_map<std::string, PathEntry> _Paths;
+    //! entries of moved_from events waiting for their moved_to, by cookie
+    std::unordered_map<std::uint32_t, PathEntry> _Moved;
+    std::uint64_t _Token;
+
+    std::atomic<std::uint64_t> _Generation;
+    std::atomic<std::size_t> _Hits;
+    std::atomic<std::size_t> _Hashed;
+
+    //! last member, its tasks are finished before the rest is destroyed
+    std::unique_ptr<ThreadPool> _Pool;
+};
+}
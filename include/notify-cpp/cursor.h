@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+
+namespace notifycpp {
+
+/**
+ * @brief Durable position of a subscriber in the event sequence
+ *
+ * ack() moves the position forward. The position is written to the
+ * file at most once per sync interval, flush() writes it at once. The
+ * file has two slots written in turn, each with a check value, so a
+ * write torn by a crash leaves the previous position readable. After a
+ * restart position() is the last position written, events after it
+ * have to be processed again. If they can't be replayed the subscriber
+ * rescans and moves the position with reset().
+ */
+class Cursor {
+public:
+    explicit Cursor(const std::filesystem::path& file,
+        std::chrono::milliseconds syncInterval = std::chrono::milliseconds(100));
+    ~Cursor();
+    Cursor(const Cursor&) = delete;
+    Cursor& operator=(const Cursor&) = delete;
+
+    std::uint64_t position() const;
+
+    void ack(std::uint64_t sequence);
+    void reset(std::uint64_t sequence);
+    void flush();
+
+private:
+    void write();
+
+    const std::filesystem::path _File;
+    const std::chrono::milliseconds _SyncInterval;
+    int _Fd;
+
+    mutable std::mutex _Mutex;
+    std::uint64_t _Position;
+    std::uint64_t _Written;
+    //! slot written next
+    unsigned _Slot;
+    std::chrono::steady_clock::time_point _NextSync;
+};
+}
@@ -49,6 +49,12 @@ enum class Event {
     // undefined behaver
     none = (1 << 12),
 
+    // the kernel queue overflowed, events were lost
+    overflow = (1 << 13),
+
+    // a followed path refers to a new file, e.g. after log rotation
+    replaced = (1 << 14),
+
     // helper
     close = Event::close_write | Event::close_nowrite,
 
@@ -87,7 +93,7 @@ static const std::array<std::uint32_t, 12> AllFanFlags = {{FAN_ACCESS,
     FAN_ALL_CLASS_BITS,
     FAN_ENABLE_AUDIT}};
 #endif
-static const std::array<Event, 15> AllEvents = {Event::access,
+static const std::array<Event, 17> AllEvents = {Event::access,
     Event::modify,
     Event::attrib,
     Event::close_write,
@@ -101,7 +107,9 @@ static const std::array<Event, 15> AllEvents = {Event::access,
     Event::move_self,
     Event::close,
     Event::move,
-    Event::all};
+    Event::all,
+    Event::overflow,
+    Event::replaced};
 
 template <>
 struct EnableBitMaskOperators<Event> {
@@ -137,4 +145,7 @@ private:
 std::string toString(const Event);
 std::ostream& operator<<(std::ostream&, const Event&);
 
+//! true if both event masks have at least one event in common
+bool intersects(const Event, const Event);
+
 }
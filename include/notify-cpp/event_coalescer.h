@@ -0,0 +1,65 @@
+#pragma once
+
+#include <notify-cpp/file_system_event.h>
+#include <notify-cpp/timing_wheel.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief When coalesced events are passed on
+ *
+ * trailing: once, when the window of the first event has passed
+ * leading:  the first event immediately, the events merged during
+ *           the window when it has passed
+ */
+enum class CoalesceMode { leading,
+    trailing };
+
+/**
+ * @brief Merges events for the same path within a time window
+ *
+ * The events of a path are combined into one FileSystemEvent with
+ * all event flags set. The window starts with the first event of a
+ * path and is not extended by later events, so an event is delayed
+ * by at most one window.
+ */
+class EventCoalescer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    EventCoalescer(std::chrono::milliseconds window, CoalesceMode = CoalesceMode::trailing);
+
+    void push(const FileSystemEvent&, Clock::time_point now, std::vector<TFileSystemEventPtr>& ready);
+    void advance(Clock::time_point now, std::vector<TFileSystemEventPtr>& ready);
+    void flush(std::vector<TFileSystemEventPtr>& ready);
+
+    Clock::time_point nextExpiry() const;
+    std::size_t pending() const;
+
+private:
+    struct Pending {
+        std::string path;
+        std::uint32_t events;
+        //! sequence of the last event merged
+        std::uint64_t sequence;
+    };
+
+    void emit(std::uint32_t slot, std::vector<TFileSystemEventPtr>& ready);
+
+    const std::chrono::milliseconds _Window;
+    const CoalesceMode _Mode;
+
+    //! path -> slot in _Pending
+    std::unordered_map<std::string, std::uint32_t> _Index;
+    std::vector<Pending> _Pending;
+    std::vector<std::uint32_t> _Free;
+
+    TimingWheel _Timers;
+};
+}
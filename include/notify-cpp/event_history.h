@@ -0,0 +1,42 @@
+#pragma once
+
+#include <notify-cpp/file_system_event.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace notifycpp {
+
+struct HistoryEntry {
+    std::uint64_t sequence;
+    Event event;
+    std::string path;
+};
+
+/**
+ * @brief Ring of the most recent events, ordered by sequence number.
+ *        Written by the event loop, read from any thread.
+ */
+class EventHistory {
+public:
+    //! @param base sequence number before the first event pushed
+    explicit EventHistory(std::size_t capacity, std::uint64_t base = 0);
+
+    void push(const FileSystemEvent&);
+
+    bool since(std::uint64_t sequence, std::vector<HistoryEntry>& entries) const;
+    std::size_t size() const;
+    std::size_t capacity() const;
+
+private:
+    mutable std::mutex _Mutex;
+    std::vector<HistoryEntry> _Ring;
+    //! slot written next
+    std::size_t _Next;
+    std::size_t _Size;
+    //! sequence number of the last event pushed, the base before
+    std::uint64_t _Last;
+};
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <notify-cpp/file_system_event.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace notifycpp {
+
+/**
+ * @brief What happens if an event is pushed into a full queue
+ *
+ * block:                the reader stops decoding, the remaining
+ *                       events stay in the kernel buffer. An event
+ *                       pushed into a full queue anyway, e.g. more
+ *                       events of one kernel event than accepted, is
+ *                       dropped
+ * drop_oldest:          the oldest queued event is dropped
+ * drop_newest:          the new event is dropped
+ * drop_lowest_priority: the oldest event of the lowest priority is dropped,
+ *                       access/open first, create/delete/move last
+ * coalesce:             the new event is merged into a queued event with
+ *                       the same path and event, otherwise dropped
+ *
+ * A dropped event queues an Event::overflow with an empty path, unless
+ * one is queued already. It is never dropped itself, observers rescan
+ * when they get it.
+ */
+enum class OverflowPolicy { block,
+    drop_oldest,
+    drop_newest,
+    drop_lowest_priority,
+    coalesce };
+
+struct QueueStatistics {
+    std::uint64_t enqueued;
+    std::uint64_t dropped;
+    std::uint64_t coalesced;
+    std::uint64_t blocked;
+    std::size_t highWatermark;
+};
+
+/**
+ * @brief Queue between the decoding of kernel events and getNextEvent
+ *
+ * A capacity of 0 means unbounded. The queue itself is used by the
+ * reading thread only, the limit can be set and the statistics read
+ * from any thread.
+ */
+class EventQueue {
+public:
+    EventQueue();
+
+    void setLimit(std::size_t capacity, OverflowPolicy);
+
+    bool accept(std::size_t events = 1);
+    void push(TFileSystemEventPtr);
+    TFileSystemEventPtr pop();
+
+    bool empty() const;
+    bool full() const;
+    std::size_t size() const;
+
+    QueueStatistics getStatistics() const;
+
+private:
+    static constexpr std::size_t Priorities = 4;
+    static std::size_t priority(Event);
+
+    void remove(std::deque<TFileSystemEventPtr>::iterator);
+    bool dropLowestPriority(Event);
+    bool coalesce(const FileSystemEvent&);
+    void dropped();
+    std::size_t queued() const;
+
+    std::deque<TFileSystemEventPtr> _Queue;
+    std::array<std::size_t, Priorities> _QueuedByPriority;
+
+    std::atomic<std::size_t> _Capacity;
+    std::atomic<OverflowPolicy> _Policy;
+    //! set while an Event::overflow is queued
+    bool _Overflowed;
+
+    std::atomic<std::uint64_t> _Enqueued;
+    std::atomic<std::uint64_t> _Dropped;
+    std::atomic<std::uint64_t> _Coalesced;
+    std::atomic<std::uint64_t> _Blocked;
+    std::atomic<std::size_t> _HighWatermark;
+};
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <notify-cpp/event.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Entry of a recording of the raw inotify stream
+ *
+ * read:    buffer returned by read() on the inotify descriptor
+ * watch:   watch added to the table used for decoding, command is set
+ *          for watches added by the user and cleared for directories
+ *          watched while decoding
+ * unwatch: path unwatched by the user
+ *
+ * timestamp is in nanoseconds since the recording was started.
+ */
+struct RecordedEntry {
+    enum class Type : std::uint8_t { read = 1,
+        watch = 2,
+        unwatch = 3 };
+
+    Type type;
+    std::int64_t timestamp;
+    int wd;
+    Event events;
+    bool recursive;
+    bool command;
+    std::filesystem::path path;
+    std::vector<char> data;
+};
+
+/**
+ * @brief Appends entries to a recording file. Used by the thread
+ *        reading events only.
+ */
+class EventRecorder {
+public:
+    explicit EventRecorder(const std::filesystem::path& file);
+
+    void read(const char* buffer, std::size_t length);
+    void watch(int wd, const std::filesystem::path&, Event, bool recursive, bool command);
+    void unwatch(const std::filesystem::path&);
+
+private:
+    void writeHeader(RecordedEntry::Type);
+    void writePath(const std::filesystem::path&);
+
+    std::ofstream _Stream;
+    const std::chrono::steady_clock::time_point _Start;
+};
+
+/**
+ * @brief Reads the entries of a recording in order
+ */
+class EventPlayback {
+public:
+    explicit EventPlayback(const std::filesystem::path& file);
+
+    //! next entry or nullptr at the end of the recording
+    const RecordedEntry* peek();
+    void pop();
+
+private:
+    bool readEntry();
+
+    std::ifstream _Stream;
+    const std::filesystem::path _File;
+    RecordedEntry _Entry;
+    bool _HasEntry;
+};
+}
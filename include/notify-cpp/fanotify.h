@@ -27,6 +27,9 @@
 #include <notify-cpp/notify.h>
 
 #include <filesystem>
+#include <vector>
+
+#include <sys/types.h>
 
 /**
  * @brief C++ wrapper for linux fanotify interface
@@ -58,6 +61,7 @@ public:
 private:
     void initFanotify();
     void watch(const std::filesystem::path&, unsigned int, const Event = Event::open);
+    void decodeEvents();
 
     int _FanotifyFd = -1;
 
@@ -65,5 +69,10 @@ private:
         FD_POLL_MAX };
 
     const size_t _fanotify_buffer_size = 8192;
+
+    //! events read but not decoded yet, used by the block overflow policy
+    std::vector<char> _Buffer;
+    ssize_t _BufferLength = 0;
+    ssize_t _BufferOffset = 0;
 };
 }
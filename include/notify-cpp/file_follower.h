@@ -0,0 +1,78 @@
+#pragma once
+
+#include <notify-cpp/notify_controller.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Bytes appended to a followed file
+ *
+ * data points into a buffer reused for the next chunk, it is valid
+ * while the observer runs only. truncated is set for the first chunk
+ * read after the file became shorter than the offset or was replaced,
+ * reading then starts again at offset 0, the chunk may be empty.
+ */
+struct FileChunk {
+    const std::filesystem::path& path;
+    std::uint64_t offset;
+    std::string_view data;
+    bool truncated;
+};
+
+using ChunkObserver = std::function<void(const FileChunk&)>;
+
+/**
+ * @brief Reads the bytes appended to files, like tail -f
+ *
+ * Every followed file stays open. On modify and close_write the bytes
+ * after the offset of the file are read with pread and passed to the
+ * observer in chunks of at most the buffer size. Files are watched by
+ * path, after log rotation the rest of the old file is read and the new
+ * file is read from its beginning. The observer runs in
+ * the thread running the event loop of the controller and must not
+ * call follow() or unfollow().
+ */
+class FileFollower {
+public:
+    static constexpr std::uint64_t end = std::numeric_limits<std::uint64_t>::max();
+
+    FileFollower(NotifyController&, ChunkObserver, std::size_t bufferSize = 64 * 1024);
+    ~FileFollower();
+    FileFollower(const FileFollower&) = delete;
+    FileFollower& operator=(const FileFollower&) = delete;
+
+    FileFollower& follow(const std::filesystem::path&, std::uint64_t offset = end);
+    FileFollower& unfollow(const std::filesystem::path&);
+
+    std::uint64_t offset(const std::filesystem::path&) const;
+
+    void read(const std::filesystem::path&);
+    void reopen(const std::filesystem::path&);
+
+private:
+    struct File {
+        std::filesystem::path path;
+        int fd;
+        std::uint64_t offset;
+    };
+
+    void readLocked(File&, bool restarted = false);
+
+    NotifyController& _Controller;
+    ChunkObserver _Observer;
+
+    mutable std::mutex _Mutex;
+    std::unordered_map<std::string, File> _Files;
+    std::vector<char> _Buffer;
+};
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 #include <string>
@@ -8,15 +9,39 @@
 #include <notify-cpp/event.h>
 
 namespace notifycpp {
+
+/**
+ * @brief Dispatch class of a watch
+ *
+ * normal:   events pass all stages of the controller
+ * critical: events are read from a kernel queue of their own and
+ *           dispatched before any other event, backends with a single
+ *           queue, e.g. replays and remote watches, reject critical
+ *           watches
+ */
+enum class Priority { normal,
+    critical };
+
 class FileSystemEvent {
 public:
     FileSystemEvent(const std::filesystem::path&);
     FileSystemEvent(const std::filesystem::path&,
         const Event);
+    FileSystemEvent(const std::filesystem::path&,
+        const Event, std::uint32_t cookie, std::uint32_t pid = 0);
     ~FileSystemEvent();
 
     Event getEvent() const;
     std::filesystem::path getPath() const;
+    std::uint32_t getCookie() const;
+    std::uint32_t getPid() const;
+    Priority getPriority() const;
+    void setPriority(Priority);
+    std::uint64_t getSequence() const;
+    void setSequence(std::uint64_t);
+    std::uint32_t getShard() const;
+    std::uint64_t getShardSequence() const;
+    void setShard(std::uint32_t shard, std::uint64_t sequence);
 
 private:
     //!
@@ -24,6 +49,23 @@ private:
 
     //! absoulte path + filename
     std::filesystem::path _Path;
+
+    //! connects moved_from and moved_to of one rename, 0 if unknown
+    std::uint32_t _Cookie;
+
+    //! process causing the event, 0 if unknown
+    std::uint32_t _Pid;
+
+    Priority _Priority;
+
+    //! clock of the controller when the event was read, 0 before
+    std::uint64_t _Sequence;
+
+    //! instance of a sharded backend which read the event, 0 otherwise
+    std::uint32_t _Shard;
+
+    //! order of the event among the events of its instance, 0 if unknown
+    std::uint64_t _ShardSequence;
 };
 using TFileSystemEventPtr = std::shared_ptr<FileSystemEvent>;
 }
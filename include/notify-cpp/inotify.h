@@ -12,16 +12,20 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <sstream>
 #include <string>
 #include <sys/inotify.h>
 #include <thread>
 #include <time.h>
+#include <unordered_map>
 #include <vector>
 
+#include <notify-cpp/event_recording.h>
 #include <notify-cpp/file_system_event.h>
 #include <notify-cpp/notify.h>
+#include <notify-cpp/watch_tree.h>
 
 #define MAX_EVENTS 4096
 #define EVENT_SIZE (sizeof(inotify_event))
@@ -63,6 +67,42 @@
  *
  * See inotify manpage for more event details
  *
+ * Events of watched directories are reported with the path of the
+ * directory entry they refer to. watchPathRecursively watches every
+ * directory of the tree and adds watches for directories created or
+ * moved into it later.
+ *
+ * Watches can be added and removed from any thread while another
+ * thread waits in getNextEvent. The watch descriptor table used for
+ * decoding is owned by the reading thread, changes are handed over
+ * as commands and applied before the next read buffer is decoded.
+ * Watches are removed by the reading thread as well, so an unwatched
+ * path stays registered in the kernel until the next read, its events
+ * are dropped.
+ *
+ * Watched paths are kept in a WatchTree. A watched directory renamed
+ * within the watched directories is relinked, so events below it are
+ * reported with the new path. A directory moved out of a recursively
+ * watched tree is unwatched with its subdirectories.
+ *
+ * followPath() watches a file by its name. The parent directory is
+ * watched for the name as well, with IN_MASK_ADD so a watch of the
+ * directory keeps its events. When the name disappears the watch of the
+ * old file is removed, when it appears again, e.g. after log rotation
+ * or an atomic replace, the new file is watched and a replaced event is
+ * reported. Watch the parent directory before following files in it.
+ * A file watched and followed shares one wd, it is removed from the
+ * kernel when neither holds it anymore.
+ *
+ * Critical paths are watched by a second inotify instance, created
+ * with the first critical watch. Its events are returned before any
+ * other event. An event loop already waiting sees the instance after
+ * its next read or timeout, watch critical paths before it is started.
+ *
+ * record() writes every buffer read from the kernel and every change
+ * of the watch table to a file. ReplayNotify feeds such a recording
+ * through the same decoding.
+ *
  */
 namespace notifycpp {
 
@@ -71,22 +111,134 @@ public:
     Inotify();
     ~Inotify();
     virtual void watchFile(const FileSystemEvent&) override;
+    virtual void watchDirectory(const FileSystemEvent&);
+    virtual void watchPathRecursively(const FileSystemEvent&) override;
+    virtual void watchCriticalPath(const FileSystemEvent&) override;
     virtual void unwatch(const FileSystemEvent&) override;
+    virtual void followPath(const FileSystemEvent&) override;
     virtual TFileSystemEventPtr getNextEvent() override;
     virtual std::uint32_t getEventMask(const Event) const override;
+    virtual WatchStatistics getWatchStatistics() const override;
+
+    void record(const std::filesystem::path&);
+
+protected:
+    struct Watch {
+        WatchTree::NodeId node;
+        //! events requested for this watch
+        Event events;
+        //! new subdirectories are watched as well
+        bool recursive;
+        //! held by watchFile(), watchDirectory() or a recursive watch
+        bool watched = true;
+        //! held by a followed path, the kernel returns one wd per inode
+        bool followed = false;
+    };
+
+    struct WatchCommand {
+        enum class Type { add,
+            remove,
+            follow };
+        Type type;
+        int wd;
+        std::filesystem::path path;
+        Event events;
+        bool recursive;
+        //! watch of the parent directory of a followed path
+        int parent = -1;
+    };
+
+    void attachWatch(int wd, const std::filesystem::path&, Event, bool recursive);
+    void applyWatchCommand(const WatchCommand&);
+    virtual void applyWatchCommands();
+    virtual void watchNewDirectory(const Watch& parent, const std::filesystem::path&);
+    virtual ssize_t readEvents(char* buffer, std::size_t size, const std::chrono::steady_clock::time_point& deadline);
 
 private:
-    std::filesystem::path wdToPath(int wd);
-    void removeWatch(int wd);
+    //! moved_from of a watched entry waiting for its moved_to
+    struct PendingMove {
+        std::uint32_t cookie;
+        WatchTree::NodeId node;
+        bool recursive;
+    };
+
+    //! a path watched by name, see followPath()
+    struct Follow {
+        std::filesystem::path path;
+        Event events;
+        int parent;
+        //! watch of the current file, -1 while the name is missing
+        int wd;
+    };
+
+    struct FollowedDirectory {
+        std::filesystem::path path;
+        std::size_t follows;
+    };
+
+    int addWatch(const std::filesystem::path&, Event, bool recursive, std::uint32_t flags = 0);
+    const Watch* findWatch(int wd) const;
+    void forgetWatch(int wd);
+    void releaseWatch(int wd);
+    void unwatchSubtree(WatchTree::NodeId);
+    void settleMove(const inotify_event&);
+    bool trackMove(const Watch&, const inotify_event&);
+    std::filesystem::path wdToPath(int wd) const;
+    void decodeEvents();
+    void updateWatchStatistics();
+    void followEntry(const inotify_event&);
+    void forgetFollowed(int wd);
+    void attachFollowed(Follow&);
+    void detachFollowed(Follow&);
+    bool unfollow(const std::filesystem::path&);
+    TFileSystemEventPtr nextCritical();
+    TFileSystemEventPtr readCritical();
     void init();
 
     // Member
     int mError;
     std::vector<std::string> mIgnoredDirectories;
     std::vector<std::string> mOnceIgnoredDirectories;
-    std::map<int, std::filesystem::path> mDirectorieMap;
+
+    //! indexed by wd, only accessed by the thread reading events
+    std::vector<Watch> mWatches;
+    std::size_t mWatchCount;
+    WatchTree mWatchTree;
+    PendingMove mPendingMove;
+    bool mHasPendingMove;
+
+    //! followed paths by path and their directories by wd, used by the reading thread
+    std::unordered_map<std::string, Follow> mFollows;
+    std::unordered_map<int, FollowedDirectory> mFollowedDirectories;
+
+    //! pending commands for the reader, guarded by mWatchMutex
+    std::mutex mWatchMutex;
+    std::vector<WatchCommand> mWatchCommands;
+    //! wds added by the commands being applied and not yet attached
+    std::unordered_map<int, std::size_t> mReadded;
+    std::atomic<bool> mHasWatchCommands;
+
+    //! instance of the critical paths, read by the thread reading events, accessed atomically
+    std::shared_ptr<Inotify> mCritical;
+
+    //! set by record(), used by the thread reading events
+    std::unique_ptr<EventRecorder> mRecorder;
+
+    //! written by the reading thread
+    struct {
+        std::atomic<std::size_t> watches { 0 };
+        std::atomic<std::size_t> nodes { 0 };
+        std::atomic<std::size_t> bytes { 0 };
+    } mWatchStatistics;
+
     int mInotifyFd;
     std::atomic<bool> stopped;
+
+    //! events read but not decoded yet, used by the block overflow policy
+    std::vector<char> mBuffer;
+    ssize_t mBufferLength;
+    ssize_t mBufferOffset;
+
     std::function<void(FileSystemEvent)> mOnEventTimeout;
 };
 }
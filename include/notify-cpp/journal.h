@@ -0,0 +1,141 @@
+#pragma once
+
+#include <notify-cpp/event.h>
+#include <notify-cpp/file_system_event.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Append-only binary log of events, split into segments
+ *
+ * Segments are files named by the sequence number of their first
+ * record. A segment starts with a header holding the number of bytes
+ * used and a table of restart points, followed by the records:
+ *
+ *   varint sequence delta, varint zigzag timestamp delta, varint mask,
+ *   varint pid, varint length of the prefix shared with the previous
+ *   path, varint suffix length, suffix
+ *
+ * At a restart point the previous record is taken as empty, so
+ * decoding can start there. A reader seeking a sequence number picks
+ * the segment by name and the restart point from the table and decodes
+ * at most the records between two restart points.
+ */
+struct JournalRecord {
+    std::uint64_t sequence;
+    //! nanoseconds since the epoch
+    std::int64_t timestamp;
+    Event event;
+    std::string path;
+    std::uint32_t pid;
+};
+
+namespace journal {
+    struct RestartPoint {
+        std::uint64_t sequence;
+        std::uint64_t offset;
+    };
+
+    struct SegmentHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t restartCount;
+        std::uint64_t firstSequence;
+        //! bytes of the segment in use, including this header
+        std::uint64_t used;
+        RestartPoint restarts[1022];
+    };
+
+    std::vector<std::filesystem::path> segments(const std::filesystem::path& directory);
+}
+
+/**
+ * @brief Writes the journal through a shared memory mapping of the
+ *        current segment. Records are durable after sync(). Not thread
+ *        safe, meant to be used by the event loop.
+ *
+ * A last segment torn by a crash is repaired when the writer is
+ * created: it is cut after its last complete record, or removed if it
+ * has none.
+ */
+class JournalWriter {
+public:
+    explicit JournalWriter(const std::filesystem::path& directory, std::size_t segmentSize = 64 << 20);
+    ~JournalWriter();
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    std::uint64_t append(const FileSystemEvent&, std::int64_t timestamp);
+    std::uint64_t append(Event, std::string_view path, std::uint32_t pid, std::int64_t timestamp);
+
+    void sync();
+
+    std::uint64_t lastSequence() const;
+
+private:
+    void open();
+    void close();
+    void encode(Event, std::string_view path, std::uint32_t pid, std::int64_t timestamp, bool restart);
+
+    const std::filesystem::path _Directory;
+    const std::size_t _SegmentSize;
+    const std::size_t _RestartInterval;
+
+    int _Fd;
+    char* _Data;
+    journal::SegmentHeader* _Header;
+    std::uint64_t _Offset;
+    std::uint64_t _NextRestart;
+
+    std::uint64_t _Sequence;
+    std::int64_t _Timestamp;
+    std::string _Path;
+    std::string _Record;
+};
+
+/**
+ * @brief Reads the records of a journal in sequence order. Segments
+ *        are read up to the bytes used when they are mapped.
+ */
+class JournalReader {
+public:
+    explicit JournalReader(const std::filesystem::path& directory);
+    ~JournalReader();
+    JournalReader(const JournalReader&) = delete;
+    JournalReader& operator=(const JournalReader&) = delete;
+
+    bool seek(std::uint64_t sequence);
+    bool next(JournalRecord&);
+
+    std::uint64_t lastSequence();
+
+private:
+    friend class JournalWriter;
+
+    std::uint64_t repair();
+    bool map(std::size_t segment);
+    void unmap();
+    bool decode(JournalRecord&);
+
+    std::vector<std::filesystem::path> _Segments;
+    std::size_t _Segment;
+
+    void* _Data;
+    std::size_t _Length;
+    std::uint64_t _Used;
+    std::uint64_t _Offset;
+    std::size_t _Restart;
+
+    JournalRecord _Previous;
+
+    //! record found by seek(), returned by the next call of next()
+    JournalRecord _Peeked;
+    bool _HasPeeked;
+};
+}
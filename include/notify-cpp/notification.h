@@ -2,17 +2,26 @@
 
 #include <notify-cpp/event.h>
 
+#include <cstdint>
+#include <functional>
+#include <string>
+
 namespace notifycpp {
 
 class Notification {
 public:
-    Notification(Event, const std::string&);
+    Notification(Event, const std::string&, std::uint64_t sequence = 0);
 
     std::string getPath() const;
     Event getEvent() const;
+    std::uint64_t getSequence() const;
 
 private:
     Event _Event;
     std::string _Path;
+    //! sequence of the event, 0 if not read by a controller
+    std::uint64_t _Sequence;
 };
+
+using EventObserver = std::function<void(Notification)>;
 }
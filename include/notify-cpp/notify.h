@@ -25,10 +25,13 @@
 #include <notify-cpp/file_system_event.h>
 
 #include <notify-cpp/event.h>
+#include <notify-cpp/event_queue.h>
 
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
-#include <queue>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -37,6 +40,19 @@
  */
 namespace notifycpp {
 
+/**
+ * @brief Size of the watch table of a backend
+ *
+ * watches: watches registered in the kernel
+ * nodes:   path components stored for them
+ * bytes:   memory used by the table
+ */
+struct WatchStatistics {
+    std::size_t watches = 0;
+    std::size_t nodes = 0;
+    std::size_t bytes = 0;
+};
+
 class Notify {
 
 public:
@@ -54,7 +70,15 @@ public:
     void ignore(const std::filesystem::path&);
     void ignoreOnce(const std::filesystem::path&);
 
-    void watchPathRecursively(const FileSystemEvent&);
+    virtual void watchPathRecursively(const FileSystemEvent&);
+    virtual void watchCriticalPath(const FileSystemEvent&);
+    virtual void followPath(const FileSystemEvent&);
+
+    void setReadTimeout(std::chrono::milliseconds);
+
+    void setQueueLimit(std::size_t capacity, OverflowPolicy);
+    QueueStatistics getQueueStatistics() const;
+    virtual WatchStatistics getWatchStatistics() const;
 
 protected:
     bool checkWatchFile(const FileSystemEvent&) const;
@@ -65,15 +89,24 @@ protected:
     bool isStopped() const;
     bool isRunning() const;
 
+    std::chrono::steady_clock::time_point readDeadline() const;
+    bool isTimedOut(const std::chrono::steady_clock::time_point&) const;
+    int pollTimeout(const std::chrono::steady_clock::time_point&) const;
+
+    //! guards _Ignored and _IgnoredOnce, which are read by the reading thread
+    mutable std::mutex _IgnoredMutex;
     std::vector<std::filesystem::path> _Ignored;
     mutable std::vector<std::filesystem::path> _IgnoredOnce;
 
-    std::queue<TFileSystemEventPtr> _Queue;
+    EventQueue _Queue;
 
     std::atomic<bool> _Stopped;
 
     const uint32_t mThreadSleep;
 
+    //! max. time getNextEvent waits in milliseconds, 0 waits until an event arrives
+    std::atomic<std::int64_t> _ReadTimeout;
+
     EventHandler _EventHandler;
 };
 }
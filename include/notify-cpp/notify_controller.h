@@ -1,23 +1,60 @@
 #pragma once
 
+#include <notify-cpp/change_index.h>
+#include <notify-cpp/change_set.h>
+#include <notify-cpp/content_hash_cache.h>
+#include <notify-cpp/cursor.h>
+#include <notify-cpp/event_coalescer.h>
+#include <notify-cpp/event_history.h>
+#include <notify-cpp/journal.h>
 #include <notify-cpp/notification.h>
 #include <notify-cpp/notify.h>
+#include <notify-cpp/path_router.h>
+#include <notify-cpp/remote_notify.h>
+#include <notify-cpp/rename_tracker.h>
+#include <notify-cpp/replay_notify.h>
+#include <notify-cpp/sharded_notify.h>
+#include <notify-cpp/shared_ring_notify.h>
+#include <notify-cpp/stat_cache.h>
+#include <notify-cpp/thread_pool.h>
+#include <notify-cpp/tree_model.h>
+#include <notify-cpp/write_filter.h>
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <filesystem>
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 
 namespace notifycpp {
 
-using EventObserver = std::function<void(Notification)>;
+/**
+ * @brief Where an observer is executed
+ *
+ * immediate:   inline in the thread running the event loop
+ * shared_pool: on a thread pool shared by all observers of the controller,
+ *              notifications can be handled out of order
+ * dedicated:   on a thread owned by the observer, in order
+ *
+ * Observers not executed immediately have a bounded number of queued
+ * notifications, further notifications are dropped and counted.
+ */
+enum class ExecutionPolicy { immediate,
+    shared_pool,
+    dedicated };
 
 class NotifyController {
 public:
     NotifyController(Notify*);
-    NotifyController() = default;
+    NotifyController();
+    NotifyController(const NotifyController&);
+    NotifyController& operator=(const NotifyController&);
+    ~NotifyController();
 
     void run();
 
@@ -27,7 +64,9 @@ public:
 
     NotifyController& watchFile(const FileSystemEvent&);
 
-    NotifyController& watchPathRecursively(const FileSystemEvent&);
+    NotifyController& watchPathRecursively(const FileSystemEvent&, Priority = Priority::normal);
+
+    NotifyController& followPath(const FileSystemEvent&);
 
     NotifyController& unwatch(const std::filesystem::path&);
 
@@ -35,22 +74,182 @@ public:
 
     NotifyController& ignoreOnce(const std::filesystem::path&);
 
-    NotifyController& onEvent(Event event, EventObserver);
+    NotifyController& setQueueLimit(std::size_t capacity, OverflowPolicy);
+
+    NotifyController& coalesce(std::chrono::milliseconds window, CoalesceMode = CoalesceMode::trailing);
+
+    NotifyController& suppressUnchangedWrites(std::size_t capacity = 65536);
+
+    NotifyController& onChangeSet(std::chrono::milliseconds quietPeriod, ChangeSetObserver);
+
+    NotifyController& attachTreeModel(std::shared_ptr<TreeModel>, const std::filesystem::path& snapshot = {});
+
+    NotifyController& persistTreeModel(const std::filesystem::path& snapshot, std::chrono::seconds interval);
+
+    NotifyController& trackChanges();
+
+    NotifyController& attachStatCache(std::shared_ptr<StatCache>);
+
+    NotifyController& attachContentHashCache(std::shared_ptr<ContentHashCache>, const std::filesystem::path& snapshot = {});
+
+    NotifyController& keepHistory(std::size_t capacity);
+
+    bool replaySince(std::uint64_t sequence, EventObserver) const;
+
+    NotifyController& publish(std::shared_ptr<SharedRingPublisher>);
+
+    NotifyController& writeJournal(std::shared_ptr<JournalWriter>,
+        std::chrono::milliseconds syncInterval = std::chrono::milliseconds(1000));
+
+    NotifyController& persistClock(const std::filesystem::path& file);
 
-    NotifyController& onEvents(std::set<Event> event, EventObserver);
+    std::uint64_t getClock() const;
+
+    std::vector<ChangedPath> changedSince(std::uint64_t clock, const std::filesystem::path& root = {}) const;
+
+    NotifyController& onRename(RenameObserver, std::chrono::milliseconds timeout = std::chrono::milliseconds(50));
+
+    QueueStatistics getQueueStatistics() const;
+
+    WatchStatistics getWatchStatistics() const;
+
+    NotifyController& onEvent(Event event, EventObserver,
+        ExecutionPolicy = ExecutionPolicy::immediate, std::size_t queueSize = 1024);
+
+    NotifyController& onEvents(std::set<Event> event, EventObserver,
+        ExecutionPolicy = ExecutionPolicy::immediate, std::size_t queueSize = 1024);
+
+    NotifyController& onPath(const std::string& pattern, Event events, EventObserver,
+        ExecutionPolicy = ExecutionPolicy::immediate, std::size_t queueSize = 1024);
 
     NotifyController& onUnexpectedEvent(EventObserver);
 
+    NotifyController& removeEventObserver(Event event);
+
+    NotifyController& removePathObserver(const std::string& pattern);
+
+    std::size_t getDroppedNotifications() const;
+
+    std::size_t getFailedNotifications() const;
+
 protected:
+    void checkWatch(Event events);
+
     Notify* _Notify;
     //std::unique_ptr<Notify> _Notify;
 
 private:
-    std::vector<std::pair<Event, EventObserver>> findObserver(Event e) const;
+    /**
+     * Immutable set of observers. Registration copies the current set,
+     * modifies the copy and publishes it, so the event loop never sees
+     * a set that is being modified.
+     */
+    struct Observers {
+        // onEvents() shares one observer between its events
+        std::map<Event, std::shared_ptr<const EventObserver>> eventObserver;
+        PathRouter pathRouter;
+        EventObserver unexpectedEventObserver;
+    };
+    using ObserversPtr = std::shared_ptr<const Observers>;
+
+    /**
+     * Pools executing observers, shared by copies. The last copy
+     * destroyed joins them.
+     */
+    struct Pools {
+        ~Pools();
 
-    std::map<Event, EventObserver> mEventObserver;
+        std::mutex mutex;
+        std::vector<std::weak_ptr<ThreadPool>> pools;
+    };
 
-    EventObserver mUnexpectedEventObserver;
+    void updateObservers(const std::function<void(Observers&)>&);
+    std::shared_ptr<ThreadPool> makePool(std::size_t threads, std::size_t capacity);
+    EventObserver makeObserver(EventObserver, ExecutionPolicy, std::size_t queueSize);
+    std::shared_ptr<ThreadPool> sharedPool();
+    const Observers& currentObservers();
+
+    static std::vector<std::pair<Event, EventObserver>> findObserver(const Observers&, Event e, bool coalesced);
+
+    void dispatch(const FileSystemEvent&, bool coalesced = false);
+    void dispatchCoalesced(const std::vector<TFileSystemEventPtr>&, std::chrono::steady_clock::time_point now);
+    void pairRenames(TFileSystemEventPtr, std::chrono::steady_clock::time_point now, std::vector<TFileSystemEventPtr>& ready);
+    void settle(TFileSystemEventPtr, std::chrono::steady_clock::time_point now);
+    void updateReadTimeout();
+    void tick(FileSystemEvent&);
+    bool restore(const std::filesystem::path& snapshot);
+    void persist(bool force);
+    void syncJournal(bool force);
+
+    struct Settle {
+        std::chrono::milliseconds quietPeriod;
+        ChangeSetObserver observer;
+        ChangeSetBuilder builder;
+        std::chrono::steady_clock::time_point lastEvent;
+    };
+
+    struct Persist {
+        std::filesystem::path snapshot;
+        std::chrono::seconds interval;
+        std::chrono::steady_clock::time_point nextSave;
+        std::uint64_t savedClock;
+        std::uint64_t savedHashes;
+    };
+
+    struct ClockMark {
+        //! written before the clock passes reserved
+        std::unique_ptr<Cursor> file;
+        std::uint64_t reserved;
+    };
+
+    struct Journal {
+        std::shared_ptr<JournalWriter> writer;
+        std::chrono::milliseconds syncInterval;
+        std::chrono::steady_clock::time_point nextSync;
+        bool dirty;
+    };
+
+    struct Renames {
+        RenameTracker tracker;
+        RenameObserver observer;
+    };
+
+    //! published set, only accessed through std::atomic_load/std::atomic_compare_exchange
+    ObserversPtr mObservers;
+    std::atomic<std::uint64_t> mObserversVersion;
+
+    //! snapshot used by the thread running the event loop
+    ObserversPtr mCachedObservers;
+    std::uint64_t mCachedVersion;
+
+    //! created with the first shared_pool observer, accessed atomically
+    std::shared_ptr<ThreadPool> mThreadPool;
+    std::shared_ptr<Pools> mPools;
+    std::shared_ptr<std::atomic<std::size_t>> mDroppedNotifications;
+    //! observers executed by a pool which threw
+    std::shared_ptr<std::atomic<std::size_t>> mFailedNotifications;
+
+    //! optional stage between the backend and the observers, used by the event loop only
+    std::shared_ptr<EventCoalescer> mCoalescer;
+    std::shared_ptr<Settle> mSettle;
+    std::shared_ptr<Renames> mRenames;
+    std::shared_ptr<WriteFilter> mWriteFilter;
+    std::shared_ptr<TreeModel> mTreeModel;
+    std::shared_ptr<Persist> mPersist;
+    std::shared_ptr<Journal> mJournal;
+    std::shared_ptr<SharedRingPublisher> mPublisher;
+    std::shared_ptr<StatCache> mStatCache;
+    //! events every watch asked for, checked against the stat cache
+    std::shared_ptr<std::atomic<Event>> mWatchedEvents;
+    std::shared_ptr<ContentHashCache> mHashCache;
+    //! offline changes found in a snapshot, dispatched before any event read
+    std::shared_ptr<std::deque<TFileSystemEventPtr>> mSynthetic;
+
+    //! advanced for every event read, shared by copies
+    std::shared_ptr<std::atomic<std::uint64_t>> mClock;
+    std::shared_ptr<ClockMark> mClockMark;
+    std::shared_ptr<ChangeIndex> mChangeIndex;
+    std::shared_ptr<EventHistory> mHistory;
 };
 
 class FanotifyController : public NotifyController {
@@ -63,5 +262,29 @@ public:
 class InotifyController : public NotifyController {
 public:
     InotifyController();
+
+    NotifyController& watchDirectory(const FileSystemEvent&);
+
+    NotifyController& record(const std::filesystem::path&);
+};
+
+class ShardedController : public NotifyController {
+public:
+    explicit ShardedController(std::size_t shards = std::thread::hardware_concurrency(), bool pinThreads = false);
+};
+
+class SharedRingController : public NotifyController {
+public:
+    explicit SharedRingController(const std::filesystem::path& ring);
+};
+
+class RemoteController : public NotifyController {
+public:
+    explicit RemoteController(const std::filesystem::path& socket);
+};
+
+class ReplayController : public NotifyController {
+public:
+    explicit ReplayController(const std::filesystem::path& recording, ReplaySpeed = ReplaySpeed::original);
 };
 }
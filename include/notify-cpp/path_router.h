@@ -0,0 +1,101 @@
+#pragma once
+
+#include <notify-cpp/event.h>
+#include <notify-cpp/notification.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Routes events to observers by path
+ *
+ * Patterns are split into path components and stored in a radix
+ * tree. A pattern without wildcards is a prefix and matches the
+ * path itself and everything beneath it. A pattern with wildcards
+ * must match the whole path. Supported wildcards are '*', '?',
+ * character classes ('[a-z]', '[!0-9]') inside one component and
+ * '**' for any number of components.
+ *
+ * The lookup walks the tree along the components of the event path,
+ * so the cost depends on the path depth and not on the number of
+ * registered observers.
+ */
+class PathRouter {
+public:
+    struct Route {
+        std::uint32_t id;
+        Event events;
+        EventObserver observer;
+    };
+
+    PathRouter();
+
+    void add(const std::string& pattern, Event, EventObserver);
+    void remove(const std::string& pattern);
+
+    std::vector<const Route*> match(const std::filesystem::path&, Event) const;
+
+    bool empty() const;
+
+private:
+    //! compiled matcher for a single path component
+    class Glob {
+    public:
+        explicit Glob(const std::string&);
+
+        bool match(const std::string&) const;
+        const std::string& pattern() const;
+
+    private:
+        enum class Token : std::uint8_t { literal,
+            any_char,
+            any_string,
+            char_class };
+
+        struct Step {
+            Token token;
+            char c;
+            std::uint16_t cls;
+        };
+
+        bool matchStep(const Step&, char) const;
+
+        std::string _Pattern;
+        std::vector<Step> _Steps;
+        //! character classes as [first, last] ranges, negated flag per class
+        std::vector<std::vector<std::pair<char, char>>> _Classes;
+        std::vector<bool> _Negated;
+    };
+
+    struct Node {
+        std::unordered_map<std::string, std::uint32_t> children;
+        std::vector<std::pair<Glob, std::uint32_t>> globs;
+        std::uint32_t anyDepth = npos;
+        //! routes matching this node and every path beneath it
+        std::vector<Route> prefixRoutes;
+        //! routes matching exactly this node
+        std::vector<Route> routes;
+    };
+
+    static constexpr std::uint32_t npos = ~std::uint32_t(0);
+
+    static bool isGlob(const std::string&);
+    static std::vector<std::string> split(const std::filesystem::path&);
+
+    std::uint32_t child(std::uint32_t, const std::string&);
+    std::uint32_t find(std::uint32_t, const std::string&) const;
+    void walk(std::uint32_t, const std::vector<std::string>&, std::size_t, Event,
+        std::vector<const Route*>&) const;
+    static void collect(const std::vector<Route>&, Event, std::vector<const Route*>&);
+
+    std::vector<Node> _Nodes;
+    std::uint32_t _NextId;
+    std::size_t _Routes;
+};
+}
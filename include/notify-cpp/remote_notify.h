@@ -0,0 +1,48 @@
+#pragma once
+
+#include <notify-cpp/notify.h>
+#include <notify-cpp/remote_protocol.h>
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Backend receiving the events of a watch daemon over a Unix
+ *        domain socket
+ *
+ * Watches are sent to the daemon as subscriptions, the daemon owns the
+ * kernel watches and only sends the events subscribed to. The backend
+ * stops when the daemon closes the connection.
+ */
+class RemoteNotify : public Notify {
+public:
+    explicit RemoteNotify(const std::filesystem::path& socket);
+    ~RemoteNotify();
+
+    virtual void watchFile(const FileSystemEvent&) override;
+    void watchDirectory(const FileSystemEvent&);
+    virtual void watchPathRecursively(const FileSystemEvent&) override;
+    virtual void unwatch(const FileSystemEvent&) override;
+    virtual TFileSystemEventPtr getNextEvent() override;
+    virtual std::uint32_t getEventMask(const Event) const override;
+
+private:
+    void subscribe(const FileSystemEvent&, bool recursive);
+    void send(const std::string&);
+    void decodeFrames();
+
+    int _Fd;
+
+    //! guards the socket for writing and the subscriptions
+    std::mutex _SendMutex;
+    std::uint32_t _NextId;
+    std::vector<remote::Subscription> _Subscriptions;
+
+    //! bytes received but not decoded yet, used by the reading thread
+    std::string _Input;
+};
+}
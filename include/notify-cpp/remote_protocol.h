@@ -0,0 +1,64 @@
+#pragma once
+
+#include <notify-cpp/event.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Framing used between the watch daemon and RemoteNotify
+ *
+ * Every frame is a u32 payload length, a u8 type and the payload.
+ * Integers are in host byte order, both ends run on the same host.
+ *
+ * subscribe:   u32 id, u32 event mask, u8 recursive, path
+ * unsubscribe: u32 id
+ * events:      u32 count, count times u32 event mask, u32 path length, path
+ *
+ * The daemon collects the events of a client and writes them as one
+ * events frame per wakeup.
+ */
+namespace remote {
+    enum class FrameType : std::uint8_t { subscribe = 1,
+        unsubscribe = 2,
+        events = 3 };
+
+    struct Subscription {
+        std::uint32_t id;
+        Event events;
+        bool recursive;
+        std::filesystem::path path;
+    };
+
+    struct RemoteEvent {
+        Event event;
+        std::filesystem::path path;
+    };
+
+    void encodeSubscribe(std::string& out, const Subscription&);
+    void encodeUnsubscribe(std::string& out, std::uint32_t id);
+
+    //! appends an event to a batch, finished by encodeEvents
+    void appendEvent(std::string& batch, Event, const std::filesystem::path&);
+    void encodeEvents(std::string& out, const std::string& batch, std::uint32_t count);
+
+    /**
+     * @brief Takes the next complete frame from the front of input
+     *
+     * @return false if input holds no complete frame
+     */
+    bool decodeFrame(std::string_view& input, FrameType&, std::string_view& payload);
+
+    Subscription decodeSubscribe(std::string_view payload);
+    std::uint32_t decodeUnsubscribe(std::string_view payload);
+    std::vector<RemoteEvent> decodeEvents(std::string_view payload);
+
+    //! true if the subscription wants the event of the path
+    bool matches(const Subscription&, Event, const std::filesystem::path&);
+}
+}
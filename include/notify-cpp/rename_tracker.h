@@ -0,0 +1,63 @@
+#pragma once
+
+#include <notify-cpp/file_system_event.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace notifycpp {
+
+struct Rename {
+    std::filesystem::path from;
+    std::filesystem::path to;
+};
+
+using RenameObserver = std::function<void(const Rename&)>;
+
+/**
+ * @brief Pairs moved_from and moved_to events through their cookie
+ *
+ * A moved_from with a cookie is held back until the moved_to with the
+ * same cookie arrives or the timeout has passed. The kernel queues both
+ * halves of a rename next to each other, so a short timeout is enough.
+ * Unmatched halves are passed on unchanged: a moved_from whose target
+ * is not watched and a moved_to whose source is not watched.
+ *
+ * Events that are held back are delayed relative to later events.
+ */
+class RenameTracker {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    RenameTracker(std::chrono::milliseconds timeout, std::size_t capacity = 1024);
+
+    void push(TFileSystemEventPtr, Clock::time_point now, std::vector<Rename>& renames,
+        std::vector<TFileSystemEventPtr>& ready);
+    void advance(Clock::time_point now, std::vector<TFileSystemEventPtr>& ready);
+    void flush(std::vector<TFileSystemEventPtr>& ready);
+
+    Clock::time_point nextExpiry() const;
+    std::size_t pending() const;
+
+private:
+    struct Expiry {
+        std::uint32_t cookie;
+        Clock::time_point deadline;
+    };
+
+    void expire(const Expiry&, std::vector<TFileSystemEventPtr>& ready);
+
+    const std::chrono::milliseconds _Timeout;
+    const std::size_t _Capacity;
+
+    //! cookie -> held back moved_from
+    std::unordered_map<std::uint32_t, TFileSystemEventPtr> _Pending;
+    //! in order of arrival, deadlines are ascending since the timeout is fixed
+    std::deque<Expiry> _Expiries;
+};
+}
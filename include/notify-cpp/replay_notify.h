@@ -0,0 +1,50 @@
+#pragma once
+
+#include <notify-cpp/event_recording.h>
+#include <notify-cpp/inotify.h>
+
+#include <chrono>
+#include <filesystem>
+
+namespace notifycpp {
+
+/**
+ * @brief Pace of a replay
+ *
+ * original: buffers are returned with the delays they were read with
+ * fastest:  buffers are returned as soon as they are asked for
+ */
+enum class ReplaySpeed { original,
+    fastest };
+
+/**
+ * @brief Backend replaying a recording written by Inotify::record()
+ *
+ * The recorded buffers are decoded like buffers read from the kernel,
+ * the watch table is rebuilt from the recorded watches at the points
+ * they were added. The backend stops itself at the end of the
+ * recording. Watches added by the user are not part of the replay,
+ * critical watches are rejected, a recording has a single queue.
+ */
+class ReplayNotify : public Inotify {
+public:
+    explicit ReplayNotify(const std::filesystem::path& recording, ReplaySpeed = ReplaySpeed::original);
+
+    virtual void watchCriticalPath(const FileSystemEvent&) override;
+
+protected:
+    virtual void applyWatchCommands() override;
+    virtual void watchNewDirectory(const Watch& parent, const std::filesystem::path&) override;
+    virtual ssize_t readEvents(char* buffer, std::size_t size, const std::chrono::steady_clock::time_point& deadline) override;
+
+private:
+    void applyEntry(const RecordedEntry&);
+
+    EventPlayback mPlayback;
+    const ReplaySpeed mSpeed;
+
+    //! time the recording was started at, shifted to the first buffer
+    std::chrono::steady_clock::time_point mStart;
+    bool mStarted;
+};
+}
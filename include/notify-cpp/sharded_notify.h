@@ -0,0 +1,118 @@
+#pragma once
+
+#include <notify-cpp/inotify.h>
+#include <notify-cpp/notify.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Spreads watches across several inotify instances
+ *
+ * Every instance has its own kernel queue and is read and decoded by
+ * a thread of its own, optionally pinned to a core. Paths ignored are
+ * passed on to the instances with the next watch.
+ *
+ * A watched path is placed on the instance chosen by the hash of the
+ * path. A recursively watched directory is split by its subdirectories:
+ * the directory itself is watched on its instance, every subdirectory
+ * with its subtree on the instance chosen by its path. Subdirectories
+ * created, moved or deleted later are placed or removed as the events
+ * of the directory are read. Renames within a subdirectory are seen by
+ * one instance, renames between them as a moved_from and a moved_to of
+ * two instances with the same cookie. A path below a watched directory
+ * is watched on the instance that owns it, so its events are reported
+ * once.
+ *
+ * The decoded events are merged into the queue getNextEvent reads from.
+ * Events of one instance keep their order, events of different
+ * instances are interleaved as they are decoded. Every event carries
+ * the index of its instance and its sequence among the events of that
+ * instance, e.g. to order the halves of a rename between two instances.
+ *
+ * The readers look up the split directories in a snapshot replaced on
+ * every change, only events of entries of a split directory which
+ * change its subdirectories take the lock of the placement. Subtrees
+ * are walked without it.
+ *
+ * Critical paths are watched by an instance of their own, created with
+ * the first critical watch. Its events are kept in a queue of their own
+ * and returned before any other event.
+ */
+class ShardedNotify : public Notify {
+public:
+    explicit ShardedNotify(std::size_t shards = std::thread::hardware_concurrency(), bool pinThreads = false);
+    ~ShardedNotify();
+
+    virtual void watchFile(const FileSystemEvent&) override;
+    virtual void watchPathRecursively(const FileSystemEvent&) override;
+    virtual void watchCriticalPath(const FileSystemEvent&) override;
+    virtual void followPath(const FileSystemEvent&) override;
+    virtual void unwatch(const FileSystemEvent&) override;
+    virtual TFileSystemEventPtr getNextEvent() override;
+    virtual std::uint32_t getEventMask(const Event) const override;
+    virtual WatchStatistics getWatchStatistics() const override;
+
+    std::size_t shards() const;
+
+private:
+    struct Shard {
+        std::unique_ptr<Inotify> notify;
+        std::thread reader;
+        //! events read, only used by the reader
+        std::uint64_t sequence = 0;
+    };
+
+    struct Placement {
+        //! index into _Shards, _Shards.size() for the critical instance
+        std::size_t shard;
+        bool recursive;
+    };
+
+    //! a directory split by its subdirectories
+    struct SplitRoot {
+        //! events requested for the directory
+        Event events;
+        std::size_t shard;
+    };
+    using SplitRoots = std::map<std::filesystem::path, SplitRoot>;
+
+    Shard& shardAt(std::size_t);
+    const Placement* ownerOf(const std::filesystem::path&) const;
+    std::size_t placeOf(const std::filesystem::path&) const;
+    void placeSubdirectory(const std::filesystem::path&, Event);
+    void unplace(const std::filesystem::path&);
+    void updateSplit(const std::filesystem::path&, const SplitRoot*);
+    bool splitEvent(std::size_t index, const SplitRoots&, const FileSystemEvent&);
+    void forwardIgnored();
+    void startReader(Shard&, std::size_t index, bool critical);
+    void read(Shard&, std::size_t index, bool critical);
+    void push(TFileSystemEventPtr);
+
+    std::vector<Shard> _Shards;
+    Shard _Critical;
+    const bool _PinThreads;
+
+    //! shard of every watched path, guarded by _WatchMutex
+    mutable std::mutex _WatchMutex;
+    std::map<std::filesystem::path, Placement> _Placement;
+    //! replaced under _WatchMutex, read by the readers without it
+    std::shared_ptr<const SplitRoots> _Split;
+    std::size_t _ForwardedIgnored;
+
+    //! guards _Queue and _CriticalQueue, which are filled by the shard readers
+    std::mutex _QueueMutex;
+    std::deque<TFileSystemEventPtr> _CriticalQueue;
+    std::condition_variable _NotEmpty;
+    std::condition_variable _NotFull;
+};
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <notify-cpp/file_system_event.h>
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <filesystem>
+
+namespace notifycpp {
+
+/**
+ * @brief Layout of a ring of decoded events in shared memory
+ *
+ * The ring has one writer and any number of readers, each with its own
+ * cursor. An event with sequence number s is stored in slot
+ * s % slotCount. While the slot is written its version is 2s + 1,
+ * afterwards 2s + 2. A reader copies the slot and checks the version
+ * before and after the copy, a changed version means the writer lapped
+ * the reader and the events in between are lost.
+ *
+ * Readers waiting for an event sleep on the wake counter with a futex,
+ * the writer only wakes them if one is waiting.
+ */
+namespace shared_ring {
+    inline constexpr char Magic[8] = { 'N', 'C', 'P', 'P', 'R', 'I', 'N', 'G' };
+    inline constexpr std::uint32_t Version = 1;
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t slotCount;
+        //! sequence number of the next event written
+        std::atomic<std::uint64_t> head;
+        //! futex word, incremented for every event written
+        std::atomic<std::uint32_t> wake;
+        std::atomic<std::uint32_t> waiters;
+    };
+
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> version;
+        std::uint32_t event;
+        std::uint32_t cookie;
+        std::uint32_t pid;
+        std::uint32_t length;
+        char path[PATH_MAX];
+    };
+
+    std::size_t size(std::uint32_t slotCount);
+}
+
+/**
+ * @brief Writes events into a shared ring backed by a memfd. Readers
+ *        in other processes open path() or receive fd(). Not thread
+ *        safe, meant to be used by the event loop.
+ */
+class SharedRingPublisher {
+public:
+    explicit SharedRingPublisher(std::uint32_t slotCount = 1024);
+    ~SharedRingPublisher();
+    SharedRingPublisher(const SharedRingPublisher&) = delete;
+    SharedRingPublisher& operator=(const SharedRingPublisher&) = delete;
+
+    void publish(const FileSystemEvent&);
+
+    int fd() const;
+    std::filesystem::path path() const;
+
+private:
+    int _Fd;
+    std::size_t _Length;
+    shared_ring::Header* _Header;
+    shared_ring::Slot* _Slots;
+};
+}
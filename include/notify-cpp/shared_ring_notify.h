@@ -0,0 +1,59 @@
+#pragma once
+
+#include <notify-cpp/notify.h>
+#include <notify-cpp/shared_ring.h>
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Backend reading the events of a SharedRingPublisher
+ *
+ * Reading starts with the events published after the ring was opened.
+ * Watches select the published events returned, a watched file its
+ * own events and a recursively watched directory the events of
+ * everything below it. Without watches all events are returned.
+ * Events overwritten before they were read are counted as lost and
+ * reported by an Event::overflow with an empty path.
+ */
+class SharedRingNotify : public Notify {
+public:
+    explicit SharedRingNotify(const std::filesystem::path& ring);
+    explicit SharedRingNotify(int fd);
+    ~SharedRingNotify();
+
+    virtual void watchFile(const FileSystemEvent&) override;
+    virtual void watchPathRecursively(const FileSystemEvent&) override;
+    virtual void unwatch(const FileSystemEvent&) override;
+    virtual TFileSystemEventPtr getNextEvent() override;
+    virtual std::uint32_t getEventMask(const Event) const override;
+
+    std::uint64_t getLostEvents() const;
+
+private:
+    struct Subscription {
+        std::filesystem::path path;
+        Event events;
+        bool recursive;
+    };
+
+    void map(int fd);
+    bool isSubscribed(const std::filesystem::path&, Event) const;
+    void wait(std::uint32_t wake, const std::chrono::steady_clock::time_point& deadline);
+
+    std::size_t _Length;
+    shared_ring::Header* _Header;
+    const shared_ring::Slot* _Slots;
+
+    //! sequence number of the next event read
+    std::uint64_t _Cursor;
+    std::atomic<std::uint64_t> _Lost;
+
+    mutable std::mutex _SubscriptionMutex;
+    std::vector<Subscription> _Subscriptions;
+};
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <notify-cpp/file_system_event.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+namespace notifycpp {
+
+class TreeModel;
+
+/**
+ * @brief Metadata of a watched tree saved to and mapped from a file
+ *
+ * The file holds a header, one fixed size record per entry and the
+ * names. Records are in depth-first order, each knows the size of its
+ * subtree, so the children of a directory are found by skipping from
+ * one subtree to the next. Loading maps the file, nothing is parsed.
+ *
+ * diff() compares the snapshot with the file system and returns the
+ * changes as create, delete_sub and modify events. A directory whose
+ * mtime is unchanged still has the same entries, only they are checked
+ * and the directory is not read. Directories are compared in parallel.
+ *
+ * Content hashes of a ContentHashCache can be saved along, they follow
+ * the records. A file whose sizes, subtrees or names don't fit into it
+ * is rejected as invalid when it is mapped.
+ */
+class Snapshot {
+public:
+    struct Record {
+        std::uint64_t inode;
+        std::uint64_t size;
+        //! modification time in nanoseconds since the epoch
+        std::int64_t mtime;
+        //! offset of the name in the string section
+        std::uint32_t name;
+        //! number of records of this entry and everything below it
+        std::uint32_t subtree;
+        std::uint16_t nameLength;
+        //! std::filesystem::file_type
+        std::int8_t type;
+        std::uint8_t reserved[5];
+    };
+
+    struct HashRecord {
+        std::uint64_t device;
+        std::uint64_t inode;
+        std::uint64_t size;
+        std::int64_t mtime;
+        std::uint64_t digest;
+    };
+
+    explicit Snapshot(const std::filesystem::path& file);
+    ~Snapshot();
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    static void save(const TreeModel&, const std::filesystem::path& file,
+        const std::vector<HashRecord>& hashes = {});
+
+    const std::filesystem::path& root() const;
+    std::size_t size() const;
+    const Record& record(std::size_t) const;
+    std::string_view name(std::size_t) const;
+    std::size_t hashCount() const;
+    const HashRecord& hash(std::size_t) const;
+
+    std::vector<FileSystemEvent> diff(std::size_t threads = 0) const;
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t reserved;
+        std::uint64_t count;
+        std::uint64_t stringSize;
+        std::uint64_t rootLength;
+        std::uint64_t hashCount;
+    };
+
+    struct Work {
+        std::size_t index;
+        std::filesystem::path path;
+        std::int64_t mtime;
+    };
+
+    bool valid();
+    void diffDirectory(const Work&, std::vector<Work>& next, std::vector<FileSystemEvent>& events) const;
+    void compare(std::size_t index, const std::filesystem::path&, std::vector<Work>& next,
+        std::vector<FileSystemEvent>& events) const;
+    void removed(std::size_t index, const std::filesystem::path&, std::vector<FileSystemEvent>& events) const;
+    static void created(const std::filesystem::path&, std::vector<FileSystemEvent>& events);
+
+    void* _Data;
+    std::size_t _Length;
+    const Header* _Header;
+    const Record* _Records;
+    const HashRecord* _Hashes;
+    const char* _Strings;
+    std::filesystem::path _Root;
+};
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <notify-cpp/file_system_event.h>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace notifycpp {
+
+//! metadata of a path, times in nanoseconds since the epoch
+struct StatResult {
+    //! 0 or the errno of the lookup, e.g. ENOENT for a missing path
+    int error = 0;
+    std::uint64_t device = 0;
+    std::uint64_t inode = 0;
+    std::uint64_t size = 0;
+    std::uint32_t mode = 0;
+    std::int64_t mtime = 0;
+    std::int64_t ctime = 0;
+};
+
+struct StatCacheStatistics {
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t entries = 0;
+};
+
+/**
+ * @brief Caches the metadata of paths below the watched trees, invalidated
+ *        by the events of a NotifyController
+ *
+ * modify, attrib and close_write drop the path, create, move, delete and
+ * replaced also drop everything below it and its parent directory,
+ * overflow drops everything. Missing paths are cached as well. Symbolic
+ * links are not followed, their target could be outside the watched
+ * trees.
+ *
+ * Paths are compared as spelled, look them up with the spelling of the
+ * watched root. Relative paths are resolved against the working directory
+ * at construction. A change is seen once its event was read, a path
+ * outside the watched trees is never invalidated. Every watch of a
+ * NotifyController the cache is attached to has to ask for
+ * invalidatingEvents(), otherwise changes are missed.
+ */
+class StatCache {
+public:
+    StatCache();
+    StatCache(const StatCache&) = delete;
+    StatCache& operator=(const StatCache&) = delete;
+
+    StatResult stat(const std::filesystem::path&);
+
+    void invalidate(const FileSystemEvent&);
+    void clear();
+
+    static Event invalidatingEvents();
+
+    StatCacheStatistics getStatistics() const;
+
+private:
+    struct Entry {
+        StatResult result;
+        //! set while the lookup of a miss is running
+        bool pending;
+        std::uint64_t token;
+    };
+
+    std::string key(const std::filesystem::path&) const;
+    void erase(const std::string&);
+    void eraseBelow(const std::string&);
+
+    const std::filesystem::path _WorkingDirectory;
+
+    mutable std::shared_mutex _Mutex;
+    std::unordered_map<std::string, Entry> _Entries;
+    //! keys of _Entries in order, for dropping a subtree
+    std::set<std::string> _Paths;
+    std::uint64_t _Token;
+
+    std::atomic<std::size_t> _Hits;
+    std::atomic<std::size_t> _Misses;
+};
+}
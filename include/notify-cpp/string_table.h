@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Interns strings into one arena and refers to them by 32-bit id
+ *
+ * Every distinct string is stored once, back to back in a single
+ * buffer. The index is an open addressing hash table of ids, so an
+ * entry costs the string itself, one offset and about two slots.
+ * Strings are never removed, the table only grows with the number
+ * of distinct strings.
+ */
+class StringTable {
+public:
+    using Id = std::uint32_t;
+    static constexpr Id npos = static_cast<Id>(-1);
+
+    StringTable();
+
+    Id intern(std::string_view);
+    Id find(std::string_view) const;
+    std::string_view get(Id) const;
+
+    std::size_t size() const;
+    std::size_t memoryUsage() const;
+
+private:
+    std::size_t probe(std::string_view, std::size_t hash) const;
+    void grow();
+
+    std::vector<char> _Arena;
+    //! string i is [_Offsets[i], _Offsets[i + 1]) in the arena
+    std::vector<std::uint32_t> _Offsets;
+    //! ids, npos for free slots, the size is a power of two
+    std::vector<Id> _Slots;
+};
+}
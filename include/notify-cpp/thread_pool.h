@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Fixed number of worker threads executing posted tasks
+ *
+ * With a single thread the tasks are executed in the order they
+ * were posted. A capacity of 0 means the queue is unbounded,
+ * otherwise post() refuses new tasks while the queue is full.
+ * Queued tasks are finished before join() or the destructor returns,
+ * tasks posted afterwards are refused.
+ */
+class ThreadPool {
+public:
+    ThreadPool(std::size_t threads, std::size_t capacity = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    bool post(std::function<void()>);
+    void drain();
+    void join();
+    bool isWorker() const;
+
+    std::size_t size() const;
+
+private:
+    void work();
+
+    mutable std::mutex _Mutex;
+    std::condition_variable _Condition;
+    //! signalled when the last task finished
+    std::condition_variable _Idle;
+    std::deque<std::function<void()>> _Tasks;
+    std::size_t _Active;
+    std::vector<std::thread> _Threads;
+    std::vector<std::thread::id> _Workers;
+    const std::size_t _Capacity;
+    bool _Stopped;
+};
+}
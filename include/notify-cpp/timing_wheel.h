@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Hierarchical timing wheel
+ *
+ * Four levels of 64 slots each. A timer is stored in the lowest level
+ * whose slot range covers its expiry and is moved down a level every
+ * time the level below wraps around, so scheduling and expiring a
+ * timer are O(1). Timers further away than 64^4 ticks expire late.
+ */
+class TimingWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TimingWheel(std::chrono::milliseconds tick, Clock::time_point now = Clock::now());
+
+    void schedule(std::uint64_t id, Clock::time_point deadline);
+    void advance(Clock::time_point now, std::vector<std::uint64_t>& expired);
+    void clear(std::vector<std::uint64_t>& expired);
+
+    Clock::time_point nextExpiry() const;
+
+    bool empty() const;
+    std::size_t size() const;
+
+private:
+    static constexpr std::size_t Levels = 4;
+    static constexpr std::size_t SlotBits = 6;
+    static constexpr std::size_t Slots = std::size_t(1) << SlotBits;
+
+    struct Timer {
+        std::uint64_t id;
+        std::uint64_t expiry;
+    };
+
+    std::uint64_t toTick(Clock::time_point) const;
+    Clock::time_point toTimePoint(std::uint64_t) const;
+    void insert(const Timer&);
+    void cascade(std::size_t level);
+
+    std::array<std::array<std::vector<Timer>, Slots>, Levels> _Wheel;
+    const Clock::duration _Tick;
+    const Clock::time_point _Start;
+    std::uint64_t _Current;
+    std::size_t _Size;
+};
+}
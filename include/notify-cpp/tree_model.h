@@ -0,0 +1,120 @@
+#pragma once
+
+#include <notify-cpp/file_system_event.h>
+#include <notify-cpp/string_table.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+namespace notifycpp {
+
+class Snapshot;
+
+/**
+ * @brief In-memory mirror of a watched directory tree
+ *
+ * The tree is read once by scan() and then kept up to date by the
+ * events passed to apply(): created and moved in entries are read
+ * from the file system, deleted and moved out entries are removed, a
+ * rename within the tree relinks the entry and modify/attrib events
+ * update size and modification time. Queries don't touch the file
+ * system.
+ *
+ * The watch feeding the model needs create, delete, move, modify and
+ * attrib events of the whole tree, e.g. watchPathRecursively with
+ * Event::all.
+ *
+ * Nodes are stored in one vector, the children of a directory in a
+ * contiguous range of another vector sorted by interned name id.
+ * apply() may be called by the event loop while other threads query.
+ */
+class TreeModel {
+public:
+    struct Entry {
+        std::string name;
+        std::filesystem::file_type type;
+        std::uint64_t size;
+        //! modification time in nanoseconds since the epoch
+        std::int64_t mtime;
+        std::uint64_t inode;
+    };
+
+    using Visitor = std::function<void(const std::filesystem::path&, const Entry&)>;
+
+    explicit TreeModel(const std::filesystem::path& root);
+
+    void scan();
+    void load(const Snapshot&);
+    void apply(const FileSystemEvent&);
+
+    std::optional<Entry> stat(const std::filesystem::path&) const;
+    std::vector<Entry> list(const std::filesystem::path&) const;
+    std::size_t count(const std::filesystem::path&, bool recursive = false) const;
+    void walk(const std::filesystem::path&, const Visitor&) const;
+
+    const std::filesystem::path& root() const;
+    std::size_t size() const;
+
+private:
+    using NodeId = std::uint32_t;
+    static constexpr NodeId npos = static_cast<NodeId>(-1);
+    static constexpr NodeId rootNode = 0;
+
+    struct Node {
+        NodeId parent;
+        StringTable::Id name;
+        //! range in _Children
+        std::uint32_t children;
+        std::uint32_t childCount;
+        std::uint32_t childCapacity;
+        std::filesystem::file_type type;
+        std::uint64_t size;
+        std::int64_t mtime;
+        std::uint64_t inode;
+    };
+
+    struct Stat {
+        std::filesystem::path relative;
+        std::filesystem::file_type type;
+        std::uint64_t size;
+        std::int64_t mtime;
+        std::uint64_t inode;
+    };
+
+    friend class Snapshot;
+
+    static bool readStat(const std::filesystem::path&, Stat&);
+    std::vector<Stat> read(const std::filesystem::path& relative) const;
+    std::filesystem::path relative(const std::filesystem::path&) const;
+
+    NodeId lookup(const std::filesystem::path& relative) const;
+    NodeId child(NodeId parent, StringTable::Id name) const;
+    NodeId insert(const Stat&);
+    void link(NodeId parent, NodeId);
+    void unlink(NodeId);
+    void erase(NodeId);
+    void compact();
+    void settleMove();
+    Entry entry(NodeId) const;
+
+    const std::filesystem::path _Root;
+
+    std::vector<Node> _Nodes;
+    std::vector<NodeId> _Free;
+    std::vector<NodeId> _Children;
+    //! slots in _Children no longer used by any range
+    std::size_t _Wasted;
+    StringTable _Names;
+
+    //! moved_from waiting for its moved_to
+    NodeId _MovedFrom;
+    std::uint32_t _MovedFromCookie;
+
+    mutable std::shared_mutex _Mutex;
+};
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <notify-cpp/notify_controller.h>
+#include <notify-cpp/remote_protocol.h>
+
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace notifycpp {
+
+/**
+ * @brief Serves the events of one set of kernel watches to clients
+ *        connected over a Unix domain socket
+ *
+ * Clients subscribe to paths with RemoteNotify. The kernel watches are
+ * derived from the subscriptions of all clients: a root is watched while
+ * a subscription needs it and no recursively watched directory, or for
+ * a file the watched directory of its entries, covers it. Events of a
+ * client are
+ * collected by the event loop and written in batches by the serving
+ * thread. A client not reading its events is disconnected once its
+ * unsent events exceed the limit, a client sending more than a frame
+ * of a subscription can take without completing it as well. An overflow, i.e. lost events, is
+ * sent to every client.
+ *
+ * The user and groups of a client are taken from the socket with
+ * SO_PEERCRED. The path of a subscription is resolved, the watch is
+ * added and the events are reported for the resolved path. A
+ * subscription is only added if they may read it and search every
+ * directory above it, other subscriptions are ignored.
+ */
+class WatchServer {
+public:
+    explicit WatchServer(const std::filesystem::path& socket, std::size_t clientBufferLimit = 4 << 20);
+    ~WatchServer();
+    WatchServer(const WatchServer&) = delete;
+    WatchServer& operator=(const WatchServer&) = delete;
+
+    void run();
+    void stop();
+
+    //! number of kernel watch roots, for directories including their subdirectories
+    std::size_t roots() const;
+
+private:
+    //! kernel watch of a subscription
+    enum class RootType { directory,
+        flat,
+        file };
+
+    struct Subscribed {
+        remote::Subscription subscription;
+        RootType root;
+    };
+
+    struct Client {
+        int fd;
+        uid_t uid;
+        //! primary and supplementary groups of the user
+        std::vector<gid_t> groups;
+        std::vector<Subscribed> subscriptions;
+        std::string input;
+        //! events collected by the event loop since the last flush
+        std::string batch;
+        std::uint32_t batchCount;
+        std::string output;
+    };
+
+    void accept();
+    bool receive(Client&);
+    bool flush(Client&);
+    bool mayAccess(const Client&, std::filesystem::path&) const;
+    void subscribe(Client&, remote::Subscription);
+    void release(const Subscribed&);
+    void updateRoots();
+    void onNotification(const Notification&);
+    void wake();
+
+    const std::filesystem::path _Socket;
+    const std::size_t _ClientBufferLimit;
+    int _Listen;
+    int _Wake;
+    std::atomic<bool> _Stopped;
+
+    InotifyController _Controller;
+    std::thread _EventLoop;
+
+    //! guards the clients and roots, shared with the event loop
+    mutable std::mutex _Mutex;
+    std::vector<std::unique_ptr<Client>> _Clients;
+    //! subscriptions of all clients by the root they need
+    std::map<std::pair<std::filesystem::path, RootType>, std::size_t> _Requested;
+    //! roots watched by the kernel
+    std::map<std::filesystem::path, RootType> _Roots;
+};
+}
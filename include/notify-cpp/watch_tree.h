@@ -0,0 +1,78 @@
+#pragma once
+
+#include <notify-cpp/string_table.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Paths of watched files and directories as a tree of nodes
+ *
+ * Every node stores the id of its interned name and a link to its
+ * parent, the path of a node is built by walking up to the root.
+ * Common prefixes and repeated names are stored once and renaming a
+ * directory relinks a single node, all nodes below it report the new
+ * path without being touched.
+ *
+ * Nodes are reference counted by the watches using them and removed
+ * with the last watch unless they still have children.
+ */
+class WatchTree {
+public:
+    using NodeId = std::uint32_t;
+    static constexpr NodeId npos = static_cast<NodeId>(-1);
+    static constexpr NodeId root = 0;
+
+    WatchTree();
+
+    NodeId insert(const std::filesystem::path&);
+    void release(NodeId);
+
+    NodeId find(const std::filesystem::path&) const;
+    NodeId child(NodeId parent, std::string_view name) const;
+
+    void move(NodeId, NodeId parent, std::string_view name);
+    void detach(NodeId);
+
+    std::filesystem::path path(NodeId) const;
+    bool isAncestor(NodeId ancestor, NodeId) const;
+
+    //! watch descriptor attached to the node, -1 if none
+    int watch(NodeId) const;
+    void setWatch(NodeId, int wd);
+
+    std::size_t size() const;
+    std::size_t memoryUsage() const;
+
+private:
+    struct Node {
+        NodeId parent;
+        StringTable::Id name;
+        //! watches using this node
+        std::uint32_t refs;
+        //! nodes linked below this node
+        std::uint32_t children;
+        int wd;
+    };
+
+    std::size_t hash(NodeId parent, StringTable::Id name) const;
+    std::size_t probe(NodeId parent, StringTable::Id name) const;
+    void grow();
+
+    void link(NodeId);
+    void unlink(NodeId);
+    void collect(NodeId);
+
+    std::vector<Node> _Nodes;
+    std::vector<NodeId> _Free;
+    StringTable _Names;
+
+    //! (parent, name) -> node, open addressing, the size is a power of two
+    std::vector<NodeId> _Slots;
+    std::size_t _Linked;
+};
+}
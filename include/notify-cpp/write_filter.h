@@ -0,0 +1,55 @@
+#pragma once
+
+#include <notify-cpp/file_system_event.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Recognizes close_write and moved_to events of files rewritten
+ *        with the content they had before
+ *
+ * The fingerprint of a file is its size and the digest of three sampled
+ * blocks, which covers small files completely. If both match the last
+ * fingerprint of a larger file the whole file is hashed, a rewrite is
+ * recognized once that digest is known. The first event of a path is
+ * never suppressed.
+ *
+ * Fingerprints are kept in a fixed table of 4-way sets, indexed by the
+ * digest of the path, the least recently used one of a set is replaced.
+ * Used by the thread running the event loop only.
+ */
+class WriteFilter {
+public:
+    explicit WriteFilter(std::size_t capacity = 65536);
+
+    bool unchanged(const FileSystemEvent&);
+
+    std::size_t getSuppressed() const;
+
+private:
+    struct Slot {
+        //! digest of the path, 0 for an empty slot
+        std::uint64_t key;
+        std::uint64_t size;
+        std::uint64_t sample;
+        std::uint64_t full;
+        std::uint32_t stamp;
+        std::uint32_t hasFull;
+    };
+
+    Slot* find(std::uint64_t key);
+    Slot& insert(std::uint64_t key);
+    bool sample(int fd, std::uint64_t size, std::uint64_t& digest);
+    bool digest(int fd, std::uint64_t offset, std::uint64_t length, std::uint64_t& digest);
+
+    std::vector<Slot> _Slots;
+    std::size_t _SetMask;
+    std::uint32_t _Stamp;
+    std::size_t _Suppressed;
+    std::vector<char> _Buffer;
+};
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace notifycpp {
+
+/**
+ * @brief XXH64 of a byte stream, fed in pieces of any size
+ *
+ * Processes 32 bytes per round in four independent lanes, which the
+ * compiler keeps in registers, and gives the same digest as the
+ * reference implementation.
+ */
+class XXHash64 {
+public:
+    explicit XXHash64(std::uint64_t seed = 0);
+
+    void update(const void* data, std::size_t length);
+    std::uint64_t digest() const;
+
+    static std::uint64_t hash(const void* data, std::size_t length, std::uint64_t seed = 0);
+
+private:
+    std::uint64_t _Lanes[4];
+    std::uint64_t _Seed;
+    std::uint64_t _Length;
+    unsigned char _Buffer[32];
+    std::size_t _Buffered;
+};
+}
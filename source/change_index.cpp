@@ -0,0 +1,84 @@
+#include <notify-cpp/change_index.h>
+
+#include <algorithm>
+#include <mutex>
+
+namespace notifycpp {
+
+ChangeIndex::ChangeIndex()
+    : _Oldest(StringTable::npos)
+    , _Newest(StringTable::npos)
+{
+}
+
+/**
+ * @brief Marks the path as changed at the clock, which must not be
+ *        older than the last recorded one.
+ */
+void ChangeIndex::record(std::string_view path, std::uint64_t clock)
+{
+    std::unique_lock<std::shared_mutex> lock(_Mutex);
+
+    const auto id = _Paths.intern(path);
+    if (id == _Entries.size()) {
+        _Entries.push_back({ clock, _Newest, StringTable::npos });
+    }
+    else {
+        auto& entry = _Entries[id];
+        entry.clock = clock;
+        if (id == _Newest)
+            return;
+
+        // unlink
+        if (entry.previous != StringTable::npos)
+            _Entries[entry.previous].next = entry.next;
+        else
+            _Oldest = entry.next;
+        _Entries[entry.next].previous = entry.previous;
+
+        entry.previous = _Newest;
+        entry.next = StringTable::npos;
+    }
+
+    if (_Newest != StringTable::npos)
+        _Entries[_Newest].next = id;
+    else
+        _Oldest = id;
+    _Newest = id;
+}
+
+bool ChangeIndex::isBelow(std::string_view path, std::string_view root)
+{
+    if (root.empty())
+        return true;
+    if (path.size() < root.size() || path.compare(0, root.size(), root) != 0)
+        return false;
+    return path.size() == root.size() || root.back() == '/' || path[root.size()] == '/';
+}
+
+/**
+ * @brief Paths below the root changed after the clock, oldest change
+ *        first. An empty root matches every path.
+ */
+std::vector<ChangedPath> ChangeIndex::changedSince(std::uint64_t clock, const std::filesystem::path& root) const
+{
+    std::shared_lock<std::shared_mutex> lock(_Mutex);
+
+    std::vector<ChangedPath> changes;
+    const auto& rootString = root.native();
+    for (auto id = _Newest; id != StringTable::npos && _Entries[id].clock > clock; id = _Entries[id].previous) {
+        const auto path = _Paths.get(id);
+        if (isBelow(path, rootString))
+            changes.push_back({ std::filesystem::path(path), _Entries[id].clock });
+    }
+
+    std::reverse(std::begin(changes), std::end(changes));
+    return changes;
+}
+
+std::size_t ChangeIndex::size() const
+{
+    std::shared_lock<std::shared_mutex> lock(_Mutex);
+    return _Entries.size();
+}
+}
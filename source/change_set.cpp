@@ -0,0 +1,188 @@
+#include <notify-cpp/change_set.h>
+
+namespace notifycpp {
+
+ChangeSetBuilder::ChangeSetBuilder()
+    : _MovedFromCookie(0)
+    , _HasMovedFrom(false)
+{
+}
+
+ChangeSetBuilder::Entry& ChangeSetBuilder::entry(const std::string& path, Existence before)
+{
+    const auto found = _Entries.find(path);
+    if (found != std::end(_Entries))
+        return found->second;
+
+    const bool present = before == Existence::present;
+    return _Entries.emplace(path, Entry { before, present, false, present, false, {} }).first->second;
+}
+
+/**
+ * @brief The content moved to this entry is gone, so its original path
+ *        has to be reported as removed instead of renamed.
+ */
+void ChangeSetBuilder::release(Entry& e)
+{
+    if (e.origin.empty())
+        return;
+    const auto found = _Entries.find(e.origin);
+    if (found != std::end(_Entries))
+        found->second.movedAway = false;
+    e.origin.clear();
+}
+
+void ChangeSetBuilder::create(const std::string& path)
+{
+    auto& e = entry(path, Existence::absent);
+    release(e);
+    e.exists = true;
+    e.modified = true;
+    e.original = false;
+}
+
+void ChangeSetBuilder::remove(const std::string& path)
+{
+    auto& e = entry(path, Existence::present);
+    release(e);
+    e.exists = false;
+    e.modified = false;
+    e.original = false;
+}
+
+void ChangeSetBuilder::modify(const std::string& path)
+{
+    auto& e = entry(path, Existence::present);
+    e.exists = true;
+    e.modified = true;
+}
+
+void ChangeSetBuilder::moveIn(const std::string& path)
+{
+    auto& e = entry(path, Existence::unknown);
+    release(e);
+    e.exists = true;
+    e.modified = true;
+    e.original = false;
+}
+
+void ChangeSetBuilder::rename(const std::string& from, const std::string& to)
+{
+    if (from == to)
+        return;
+
+    auto& source = entry(from, Existence::present);
+    std::string origin = !source.origin.empty() ? source.origin : (source.original ? from : std::string());
+    const bool modified = source.modified;
+    source.exists = false;
+    source.modified = false;
+    source.original = false;
+    source.origin.clear();
+
+    auto& target = entry(to, Existence::unknown);
+    release(target);
+    target.exists = true;
+    target.modified = modified;
+    target.original = false;
+
+    if (origin == to) {
+        // moved back to where it was
+        target.original = true;
+        target.movedAway = false;
+        origin.clear();
+    }
+    target.origin = origin;
+
+    if (!origin.empty())
+        _Entries.at(origin).movedAway = true;
+}
+
+/**
+ * @brief A moved_from not followed by a moved_to left the watched tree.
+ */
+void ChangeSetBuilder::flushMove()
+{
+    if (!_HasMovedFrom)
+        return;
+    _HasMovedFrom = false;
+    remove(_MovedFrom);
+}
+
+void ChangeSetBuilder::add(const FileSystemEvent& fse)
+{
+    const auto path = fse.getPath().string();
+    const Event event = fse.getEvent();
+
+    if (event == Event::moved_to && _HasMovedFrom && fse.getCookie() == _MovedFromCookie) {
+        _HasMovedFrom = false;
+        rename(_MovedFrom, path);
+        return;
+    }
+    flushMove();
+
+    switch (event) {
+    case Event::create:
+        create(path);
+        break;
+    case Event::delete_sub:
+    case Event::delete_self:
+    case Event::move_self:
+        remove(path);
+        break;
+    case Event::modify:
+    case Event::attrib:
+    case Event::close_write:
+        modify(path);
+        break;
+    case Event::moved_from:
+        _MovedFrom = path;
+        _MovedFromCookie = fse.getCookie();
+        _HasMovedFrom = true;
+        break;
+    case Event::moved_to:
+        moveIn(path);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Computes the net changes and starts a new change set.
+ */
+ChangeSet ChangeSetBuilder::take()
+{
+    flushMove();
+
+    ChangeSet changes;
+    for (const auto& pathEntry : _Entries) {
+        const auto& path = pathEntry.first;
+        const auto& e = pathEntry.second;
+
+        if (e.exists) {
+            if (!e.origin.empty()) {
+                changes.push_back({ ChangeType::renamed, path, e.origin });
+                if (e.modified)
+                    changes.push_back({ ChangeType::modified, path, {} });
+            }
+            else if (e.before == Existence::absent) {
+                changes.push_back({ ChangeType::created, path, {} });
+            }
+            else if (e.modified) {
+                changes.push_back({ ChangeType::modified, path, {} });
+            }
+        }
+        else if (!e.movedAway && e.before != Existence::absent) {
+            changes.push_back({ ChangeType::removed, path, {} });
+        }
+    }
+
+    _Entries.clear();
+    return changes;
+}
+
+bool ChangeSetBuilder::empty() const
+{
+    return _Entries.empty() && !_HasMovedFrom;
+}
+}
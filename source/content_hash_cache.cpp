@@ -0,0 +1,367 @@
+#include <notify-cpp/content_hash_cache.h>
+#include <notify-cpp/xxhash.h>
+
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace notifycpp {
+
+namespace {
+    const std::size_t ReadSize = 1 << 20;
+    //! unpaired moved_from entries kept at most
+    const std::size_t MovedLimit = 256;
+
+    std::runtime_error hashError(const std::string& what, const std::filesystem::path& file)
+    {
+        std::stringstream errorStream;
+        errorStream << what << " " << strerror(errno) << ". Path: " << file;
+        return std::runtime_error(errorStream.str());
+    }
+
+    std::int64_t nanoseconds(const struct timespec& time)
+    {
+        return time.tv_sec * 1000000000LL + time.tv_nsec;
+    }
+
+    FileIdentity identityOf(const struct stat& st)
+    {
+        FileIdentity identity;
+        identity.device = st.st_dev;
+        identity.inode = st.st_ino;
+        identity.size = static_cast<std::uint64_t>(st.st_size);
+        identity.mtime = nanoseconds(st.st_mtim);
+        return identity;
+    }
+
+    /**
+     * @brief Granularity of the mtime of the file, two writes within one
+     *        tick can leave the same mtime behind
+     */
+    std::int64_t mtimeTick(const struct stat& st)
+    {
+        // whole seconds, e.g. FAT, HFS+ and some network filesystems
+        if (st.st_mtim.tv_nsec == 0)
+            return 2000000000LL;
+        // local filesystems take the mtime from the coarse clock
+        static const std::int64_t coarse = []() {
+            struct timespec resolution;
+            return clock_getres(CLOCK_REALTIME_COARSE, &resolution) == 0 ? nanoseconds(resolution) : 10000000LL;
+        }();
+        return coarse;
+    }
+
+    //! reads the open file to its end
+    std::uint64_t digestOf(int fd, const std::filesystem::path& file)
+    {
+        thread_local std::vector<char> buffer(ReadSize);
+        XXHash64 state;
+        off_t offset = 0;
+        while (true) {
+            const auto length = pread(fd, buffer.data(), buffer.size(), offset);
+            if (length == -1 && errno == EINTR)
+                continue;
+            if (length == -1)
+                throw hashError("Can't read file!", file);
+            if (length == 0)
+                return state.digest();
+            state.update(buffer.data(), static_cast<std::size_t>(length));
+            offset += length;
+        }
+    }
+}
+
+bool FileIdentity::operator==(const FileIdentity& other) const
+{
+    return device == other.device && inode == other.inode && size == other.size && mtime == other.mtime;
+}
+
+std::size_t ContentHashCache::IdentityHash::operator()(const FileIdentity& identity) const
+{
+    const std::uint64_t values[] = { identity.device, identity.inode, identity.size,
+        static_cast<std::uint64_t>(identity.mtime) };
+    return static_cast<std::size_t>(XXHash64::hash(values, sizeof(values)));
+}
+
+ContentHashCache::ContentHashCache(std::size_t threads)
+    : _WorkingDirectory(std::filesystem::current_path())
+    , _Token(0)
+    , _Generation(0)
+    , _Hits(0)
+    , _Hashed(0)
+{
+    if (threads > 0)
+        _Pool = std::make_unique<ThreadPool>(threads, 4096);
+}
+
+ContentHashCache::~ContentHashCache()
+{
+    _Pool.reset();
+}
+
+/**
+ * @brief Returns the digest of the content of the file, reads the file
+ *        if this version of it was not hashed before
+ */
+std::uint64_t ContentHashCache::hash(const std::filesystem::path& file)
+{
+    const auto name = key(file);
+    const int fd = open(name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        throw hashError("Can't open file!", file);
+
+    struct stat before;
+    if (fstat(fd, &before) == -1) {
+        const auto error = hashError("Can't read file!", file);
+        close(fd);
+        throw error;
+    }
+    if (!S_ISREG(before.st_mode)) {
+        close(fd);
+        throw std::runtime_error("Can't hash file! Not a regular file. Path: " + file.string());
+    }
+    const auto identity = identityOf(before);
+
+    {
+        std::shared_lock<std::shared_mutex> lock(_Mutex);
+        const auto found = _Hashes.find(identity);
+        const auto path = _Paths.find(name);
+        if (found != _Hashes.end() && path != _Paths.end() && !path->second.pending && path->second.identity == identity) {
+            close(fd);
+            _Hits.fetch_add(1, std::memory_order_relaxed);
+            return found->second;
+        }
+    }
+
+    // an event for the path while the file is read drops the pending
+    // entry, the digest is then returned but not cached
+    std::uint64_t token;
+    {
+        std::unique_lock<std::shared_mutex> lock(_Mutex);
+        auto& path = _Paths[name];
+        if (!path.pending && !(path.identity == identity))
+            _Hashes.erase(path.identity);
+
+        const auto found = _Hashes.find(identity);
+        if (found != _Hashes.end()) {
+            // renamed, or loaded from a snapshot
+            path = PathEntry { identity, false, 0 };
+            close(fd);
+            _Hits.fetch_add(1, std::memory_order_relaxed);
+            return found->second;
+        }
+        path = PathEntry { identity, true, token = ++_Token };
+    }
+
+    // a write within the tick of the mtime after this is not seen in the
+    // identity, the digest of such a racily clean file is not cached
+    struct timespec started;
+    clock_gettime(CLOCK_REALTIME, &started);
+    const bool racy = identity.mtime >= nanoseconds(started) - mtimeTick(before);
+
+    std::uint64_t digest;
+    struct stat after;
+    try {
+        digest = digestOf(fd, file);
+        if (fstat(fd, &after) == -1)
+            throw hashError("Can't read file!", file);
+    } catch (...) {
+        close(fd);
+        std::unique_lock<std::shared_mutex> lock(_Mutex);
+        const auto path = _Paths.find(name);
+        if (path != _Paths.end() && path->second.token == token)
+            _Paths.erase(path);
+        throw;
+    }
+    close(fd);
+    _Hashed.fetch_add(1, std::memory_order_relaxed);
+
+    std::unique_lock<std::shared_mutex> lock(_Mutex);
+    const auto path = _Paths.find(name);
+    if (path == _Paths.end() || !path->second.pending || path->second.token != token)
+        return digest;
+    if (racy || !(identityOf(after) == identity)) {
+        _Paths.erase(path);
+        return digest;
+    }
+    path->second.pending = false;
+    _Hashes[identity] = digest;
+    _Generation.fetch_add(1, std::memory_order_release);
+    return digest;
+}
+
+void ContentHashCache::invalidate(const FileSystemEvent& fse)
+{
+    const Event event = fse.getEvent();
+    if (intersects(event, Event::overflow)) {
+        clear();
+        return;
+    }
+    if (!intersects(event, Event::modify | Event::close_write | Event::move | Event::delete_sub | Event::delete_self | Event::replaced))
+        return;
+
+    const auto path = fse.getPath();
+    const auto name = key(path);
+    {
+        std::unique_lock<std::shared_mutex> lock(_Mutex);
+        if (intersects(event, Event::moved_from)) {
+            // the content moves along, its digest stays valid
+            const auto found = _Paths.find(name);
+            if (found != _Paths.end()) {
+                if (fse.getCookie() != 0 && !found->second.pending) {
+                    if (_Moved.size() >= MovedLimit)
+                        _Moved.clear();
+                    _Moved[fse.getCookie()] = found->second;
+                }
+                _Paths.erase(found);
+            }
+            return;
+        }
+
+        // moved_to replaces the file at the path
+        forget(name);
+
+        if (intersects(event, Event::moved_to)) {
+            const auto moved = _Moved.find(fse.getCookie());
+            if (moved != _Moved.end()) {
+                _Paths[name] = moved->second;
+                _Moved.erase(moved);
+                return;
+            }
+        }
+    }
+
+    if (intersects(event, Event::close_write | Event::moved_to | Event::replaced))
+        schedule(path);
+}
+
+void ContentHashCache::clear()
+{
+    std::unique_lock<std::shared_mutex> lock(_Mutex);
+    _Hashes.clear();
+    _Paths.clear();
+    _Moved.clear();
+    _Generation.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief Adds the digests saved with the snapshot of the files the
+ *        snapshot contains, under their paths. The events of files
+ *        changed or deleted since, e.g. the differences queued by
+ *        NotifyController::attachTreeModel(), drop them again.
+ */
+void ContentHashCache::load(const Snapshot& snapshot)
+{
+    std::unordered_multimap<std::uint64_t, const Snapshot::HashRecord*> byInode;
+    for (std::size_t i = 0; i < snapshot.hashCount(); ++i)
+        byInode.emplace(snapshot.hash(i).inode, &snapshot.hash(i));
+
+    std::unique_lock<std::shared_mutex> lock(_Mutex);
+    // directories whose subtree is still being read: path and end of the subtree
+    std::vector<std::pair<std::filesystem::path, std::size_t>> parents;
+    for (std::size_t index = 0; index < snapshot.size(); ++index) {
+        while (!parents.empty() && index >= parents.back().second)
+            parents.pop_back();
+
+        const auto& record = snapshot.record(index);
+        const auto path = parents.empty() ? snapshot.root() : parents.back().first / snapshot.name(index);
+        if (record.subtree > 1 || index == 0)
+            parents.emplace_back(path, index + record.subtree);
+        if (static_cast<std::filesystem::file_type>(record.type) != std::filesystem::file_type::regular)
+            continue;
+
+        const auto range = byInode.equal_range(record.inode);
+        for (auto it = range.first; it != range.second; ++it) {
+            const auto& hash = *it->second;
+            if (hash.size != record.size || hash.mtime != record.mtime)
+                continue;
+
+            FileIdentity identity;
+            identity.device = hash.device;
+            identity.inode = hash.inode;
+            identity.size = hash.size;
+            identity.mtime = hash.mtime;
+            _Hashes.emplace(identity, hash.digest);
+            _Paths[key(path)] = PathEntry { identity, false, 0 };
+            break;
+        }
+    }
+    _Generation.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @return digests of the files with a known path, once per file
+ */
+std::vector<Snapshot::HashRecord> ContentHashCache::records() const
+{
+    std::shared_lock<std::shared_mutex> lock(_Mutex);
+    std::vector<Snapshot::HashRecord> records;
+    std::unordered_set<FileIdentity, IdentityHash> saved;
+    for (const auto& path : _Paths) {
+        if (path.second.pending)
+            continue;
+        const auto found = _Hashes.find(path.second.identity);
+        if (found == _Hashes.end() || !saved.insert(found->first).second)
+            continue;
+        records.push_back({ found->first.device, found->first.inode, found->first.size, found->first.mtime, found->second });
+    }
+    return records;
+}
+
+std::uint64_t ContentHashCache::generation() const
+{
+    return _Generation.load(std::memory_order_acquire);
+}
+
+ContentHashStatistics ContentHashCache::getStatistics() const
+{
+    ContentHashStatistics statistics;
+    statistics.hits = _Hits.load(std::memory_order_relaxed);
+    statistics.hashed = _Hashed.load(std::memory_order_relaxed);
+    std::shared_lock<std::shared_mutex> lock(_Mutex);
+    statistics.entries = _Hashes.size();
+    return statistics;
+}
+
+std::string ContentHashCache::key(const std::filesystem::path& path) const
+{
+    if (path.is_absolute())
+        return path.native();
+    return (_WorkingDirectory / path).native();
+}
+
+void ContentHashCache::forget(const std::string& name)
+{
+    const auto found = _Paths.find(name);
+    if (found == _Paths.end())
+        return;
+    if (!found->second.pending && _Hashes.erase(found->second.identity))
+        _Generation.fetch_add(1, std::memory_order_release);
+    _Paths.erase(found);
+}
+
+/**
+ * @brief Hashes the file in the background, a full queue leaves it to
+ *        the next call of hash()
+ */
+void ContentHashCache::schedule(const std::filesystem::path& file)
+{
+    if (!_Pool)
+        return;
+    _Pool->post([this, file]() {
+        try {
+            hash(file);
+        } catch (const std::runtime_error&) {
+            // removed again or not a regular file
+        }
+    });
+}
+}
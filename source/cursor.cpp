@@ -0,0 +1,118 @@
+#include <notify-cpp/cursor.h>
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace notifycpp {
+
+namespace {
+    const std::uint64_t CursorCheck = 0x4e43505043555253; // "NCPPCURS"
+
+    struct CursorSlot {
+        std::uint64_t sequence;
+        std::uint64_t check;
+    };
+
+    std::runtime_error cursorError(const std::string& what, const std::filesystem::path& file)
+    {
+        std::stringstream errorStream;
+        errorStream << what << " " << strerror(errno) << ". Path: " << file;
+        return std::runtime_error(errorStream.str());
+    }
+}
+
+Cursor::Cursor(const std::filesystem::path& file, std::chrono::milliseconds syncInterval)
+    : _File(file)
+    , _SyncInterval(syncInterval)
+    , _Position(0)
+    , _Written(0)
+    , _Slot(0)
+    , _NextSync(std::chrono::steady_clock::now())
+{
+    _Fd = open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (_Fd == -1)
+        throw cursorError("Can't open cursor!", file);
+
+    CursorSlot slots[2] = {};
+    const auto length = pread(_Fd, slots, sizeof(slots), 0);
+    for (unsigned i = 0; length > 0 && i < static_cast<std::size_t>(length) / sizeof(CursorSlot); ++i) {
+        if ((slots[i].sequence ^ CursorCheck) != slots[i].check || slots[i].sequence < _Position)
+            continue;
+        _Position = slots[i].sequence;
+        // overwrite the other, older slot first
+        _Slot = 1 - i;
+    }
+    _Written = _Position;
+}
+
+Cursor::~Cursor()
+{
+    try {
+        flush();
+    } catch (const std::runtime_error&) {
+    }
+    close(_Fd);
+}
+
+std::uint64_t Cursor::position() const
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    return _Position;
+}
+
+/**
+ * @brief Marks all events up to the sequence as processed, smaller
+ *        sequences than the position are ignored.
+ */
+void Cursor::ack(std::uint64_t sequence)
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    if (sequence <= _Position)
+        return;
+
+    _Position = sequence;
+    if (std::chrono::steady_clock::now() >= _NextSync)
+        write();
+}
+
+/**
+ * @brief Moves the position to the sequence, also backwards, and writes
+ *        it at once. Used after a rescan, when the events after the
+ *        position could not be replayed.
+ */
+void Cursor::reset(std::uint64_t sequence)
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    _Position = sequence;
+    // both slots, the larger position of the other one would win
+    write();
+    write();
+}
+
+void Cursor::flush()
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    if (_Position != _Written)
+        write();
+}
+
+/**
+ * @brief Writes the position to the next slot and syncs it. Called
+ *        with _Mutex held.
+ */
+void Cursor::write()
+{
+    const CursorSlot slot { _Position, _Position ^ CursorCheck };
+    if (pwrite(_Fd, &slot, sizeof(slot), static_cast<off_t>(_Slot * sizeof(slot))) != sizeof(slot)
+        || fdatasync(_Fd) == -1)
+        throw cursorError("Can't write cursor!", _File);
+
+    _Written = _Position;
+    _Slot = 1 - _Slot;
+    _NextSync = std::chrono::steady_clock::now() + _SyncInterval;
+}
+}
@@ -83,6 +83,8 @@ EventHandler::getInotifyEvent(const Event e) const
     case Event::all:
         return IN_ALL_EVENTS;
     case Event::none:
+    case Event::overflow:
+    case Event::replaced:
         return 0;
     }
     return 0;
@@ -123,6 +125,10 @@ EventHandler::getFanotifyEvent(const Event e) const
     case Event::none:
         assert(!"None existing event");
         return 0;
+
+    case Event::overflow:
+    case Event::replaced:
+        return 0;
     }
     assert(!"None existing event");
     return 0;
@@ -165,6 +171,10 @@ toString(const Event event)
             return std::string("all");
         case Event::none:
             return std::string("none");
+        case Event::overflow:
+            return std::string("overflow");
+        case Event::replaced:
+            return std::string("replaced");
         }
         assert(!"None existing event");
         return std::string("ERROR");
@@ -190,6 +200,12 @@ std::ostream& operator<<(std::ostream& stream, const Event& event)
     return stream;
 }
 
+bool intersects(const Event lhs, const Event rhs)
+{
+    using underlying = std::underlying_type<Event>::type;
+    return static_cast<underlying>(lhs & rhs) != 0;
+}
+
 Event EventHandler::getInotify(std::uint32_t e) const
 {
     switch (e) {
@@ -298,8 +314,9 @@ Event EventHandler::getFanotify(std::uint32_t e) const
          return Event::open;
         case FAN_CLOSE:
          return Event::close;
-        /* TODO
         case FAN_Q_OVERFLOW:
+         return Event::overflow;
+        /* TODO
         case FAN_OPEN_PERM:
         case FAN_ONDIR:
         case FAN_EVENT_ON_CHILD:
@@ -0,0 +1,89 @@
+#include <notify-cpp/event_coalescer.h>
+
+namespace notifycpp {
+
+EventCoalescer::EventCoalescer(std::chrono::milliseconds window, CoalesceMode mode)
+    : _Window(window)
+    , _Mode(mode)
+    , _Timers(std::max(window / 64, std::chrono::milliseconds(1)))
+{
+}
+
+void EventCoalescer::push(const FileSystemEvent& fse, Clock::time_point now, std::vector<TFileSystemEventPtr>& ready)
+{
+    const auto event = static_cast<std::uint32_t>(fse.getEvent());
+    const auto path = fse.getPath().string();
+
+    const auto found = _Index.find(path);
+    if (found != std::end(_Index)) {
+        _Pending[found->second].events |= event;
+        _Pending[found->second].sequence = fse.getSequence();
+        return;
+    }
+
+    std::uint32_t slot;
+    if (_Free.empty()) {
+        slot = static_cast<std::uint32_t>(_Pending.size());
+        _Pending.emplace_back();
+    }
+    else {
+        slot = _Free.back();
+        _Free.pop_back();
+    }
+
+    _Pending[slot] = { path, event, fse.getSequence() };
+    if (_Mode == CoalesceMode::leading) {
+        ready.push_back(std::make_shared<FileSystemEvent>(fse));
+        _Pending[slot].events = 0;
+    }
+
+    _Index.emplace(path, slot);
+    _Timers.schedule(slot, now + _Window);
+}
+
+void EventCoalescer::emit(std::uint32_t slot, std::vector<TFileSystemEventPtr>& ready)
+{
+    auto& pending = _Pending[slot];
+    if (pending.events != 0) {
+        auto merged = std::make_shared<FileSystemEvent>(pending.path, static_cast<Event>(pending.events));
+        merged->setSequence(pending.sequence);
+        ready.push_back(std::move(merged));
+    }
+
+    _Index.erase(pending.path);
+    pending.path.clear();
+    _Free.push_back(slot);
+}
+
+/**
+ * @brief Passes on the merged events of all windows which have passed.
+ */
+void EventCoalescer::advance(Clock::time_point now, std::vector<TFileSystemEventPtr>& ready)
+{
+    std::vector<std::uint64_t> expired;
+    _Timers.advance(now, expired);
+    for (const auto slot : expired)
+        emit(static_cast<std::uint32_t>(slot), ready);
+}
+
+/**
+ * @brief Passes on all pending events regardless of their window.
+ */
+void EventCoalescer::flush(std::vector<TFileSystemEventPtr>& ready)
+{
+    std::vector<std::uint64_t> expired;
+    _Timers.clear(expired);
+    for (const auto slot : expired)
+        emit(static_cast<std::uint32_t>(slot), ready);
+}
+
+EventCoalescer::Clock::time_point EventCoalescer::nextExpiry() const
+{
+    return _Timers.nextExpiry();
+}
+
+std::size_t EventCoalescer::pending() const
+{
+    return _Index.size();
+}
+}
@@ -0,0 +1,62 @@
+#include <notify-cpp/event_history.h>
+
+#include <stdexcept>
+
+namespace notifycpp {
+
+EventHistory::EventHistory(std::size_t capacity, std::uint64_t base)
+    : _Ring(capacity)
+    , _Next(0)
+    , _Size(0)
+    , _Last(base)
+{
+    if (capacity == 0)
+        throw std::invalid_argument("The history needs a capacity of at least one event");
+}
+
+void EventHistory::push(const FileSystemEvent& fse)
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    auto& entry = _Ring[_Next];
+    entry.sequence = fse.getSequence();
+    entry.event = fse.getEvent();
+    entry.path = fse.getPath().string();
+
+    _Last = entry.sequence;
+    _Next = (_Next + 1) % _Ring.size();
+    if (_Size < _Ring.size())
+        ++_Size;
+}
+
+/**
+ * @brief Copies the entries with a sequence number after the given one
+ *
+ * @return false if entries after the sequence were overwritten already,
+ *         or the sequence is not from this history, e.g. it is newer
+ *         than the last event or older than the base
+ */
+bool EventHistory::since(std::uint64_t sequence, std::vector<HistoryEntry>& entries) const
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    const auto first = (_Next + _Ring.size() - _Size) % _Ring.size();
+    for (std::size_t i = 0; i < _Size; ++i) {
+        const auto& entry = _Ring[(first + i) % _Ring.size()];
+        if (entry.sequence > sequence)
+            entries.push_back(entry);
+    }
+
+    const auto oldest = _Size == 0 ? _Last : _Ring[first].sequence - 1;
+    return sequence >= oldest && sequence <= _Last;
+}
+
+std::size_t EventHistory::size() const
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    return _Size;
+}
+
+std::size_t EventHistory::capacity() const
+{
+    return _Ring.size();
+}
+}
@@ -0,0 +1,210 @@
+#include <notify-cpp/event_queue.h>
+
+#include <algorithm>
+
+namespace notifycpp {
+
+EventQueue::EventQueue()
+    : _QueuedByPriority {}
+    , _Capacity(0)
+    , _Policy(OverflowPolicy::drop_oldest)
+    , _Overflowed(false)
+    , _Enqueued(0)
+    , _Dropped(0)
+    , _Coalesced(0)
+    , _Blocked(0)
+    , _HighWatermark(0)
+{
+}
+
+/**
+ * @param capacity max. number of queued events, 0 for unbounded
+ * @param policy applied when an event is pushed into a full queue
+ */
+void EventQueue::setLimit(std::size_t capacity, OverflowPolicy policy)
+{
+    _Capacity = capacity;
+    _Policy = policy;
+}
+
+std::size_t EventQueue::priority(Event event)
+{
+    switch (event) {
+    case Event::access:
+    case Event::open:
+    case Event::close_nowrite:
+        return 0;
+    case Event::modify:
+    case Event::close_write:
+        return 2;
+    case Event::moved_from:
+    case Event::moved_to:
+    case Event::create:
+    case Event::delete_sub:
+    case Event::delete_self:
+    case Event::move_self:
+        return 3;
+    default:
+        return 1;
+    }
+}
+
+bool EventQueue::empty() const
+{
+    return _Queue.empty();
+}
+
+bool EventQueue::full() const
+{
+    const std::size_t capacity = _Capacity;
+    return capacity != 0 && queued() >= capacity;
+}
+
+/**
+ * @return number of queued events, the overflow marker isn't counted
+ */
+std::size_t EventQueue::queued() const
+{
+    return _Queue.size() - (_Overflowed ? 1 : 0);
+}
+
+std::size_t EventQueue::size() const
+{
+    return _Queue.size();
+}
+
+/**
+ * @brief Drops a queued event other than the overflow marker
+ */
+void EventQueue::remove(std::deque<TFileSystemEventPtr>::iterator it)
+{
+    --_QueuedByPriority[priority((*it)->getEvent())];
+    _Queue.erase(it);
+}
+
+bool EventQueue::dropLowestPriority(Event event)
+{
+    const auto incoming = priority(event);
+    for (std::size_t p = 0; p < incoming; ++p) {
+        if (_QueuedByPriority[p] == 0)
+            continue;
+        const auto found = std::find_if(std::begin(_Queue), std::end(_Queue), [p](const TFileSystemEventPtr& queued) {
+            return queued->getEvent() != Event::overflow && priority(queued->getEvent()) == p;
+        });
+        remove(found);
+        return true;
+    }
+    return false;
+}
+
+bool EventQueue::coalesce(const FileSystemEvent& event)
+{
+    return std::any_of(std::begin(_Queue), std::end(_Queue), [&event](const TFileSystemEventPtr& queued) {
+        return queued->getEvent() == event.getEvent() && queued->getPath() == event.getPath()
+            && queued->getCookie() == event.getCookie();
+    });
+}
+
+/**
+ * @brief Counts a dropped event and queues the overflow marker
+ */
+void EventQueue::dropped()
+{
+    ++_Dropped;
+    if (_Overflowed)
+        return;
+    _Queue.push_back(std::make_shared<FileSystemEvent>(std::filesystem::path {}, Event::overflow));
+    _Overflowed = true;
+    if (_Queue.size() > _HighWatermark)
+        _HighWatermark = _Queue.size();
+}
+
+/**
+ * @brief Has to be checked by the reader before an event is decoded.
+ *        An empty queue accepts the event even if it exceeds the
+ *        capacity, so the reader doesn't block forever.
+ *
+ * @param events max. number of events pushed for the decoded event
+ * @return false if the queue has no room for the events and the reader
+ *         should block, the event has to stay in the kernel buffer
+ */
+bool EventQueue::accept(std::size_t events)
+{
+    const std::size_t capacity = _Capacity;
+    if (_Policy == OverflowPolicy::block && capacity != 0 && queued() != 0 && queued() + events > capacity) {
+        ++_Blocked;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Adds an event and applies the overflow policy if the queue
+ *        is full.
+ */
+void EventQueue::push(TFileSystemEventPtr event)
+{
+    if (event->getEvent() == Event::overflow) {
+        // events were lost in the kernel already, one marker is enough
+        if (!_Overflowed) {
+            _Queue.push_back(std::move(event));
+            _Overflowed = true;
+            ++_Enqueued;
+        }
+        return;
+    }
+
+    if (full()) {
+        switch (_Policy.load()) {
+        case OverflowPolicy::block:
+            // more than accept() was asked for
+            dropped();
+            return;
+        case OverflowPolicy::drop_oldest:
+            // the marker is not counted, so another event is queued
+            remove(std::find_if(std::begin(_Queue), std::end(_Queue),
+                [](const TFileSystemEventPtr& queued) { return queued->getEvent() != Event::overflow; }));
+            dropped();
+            break;
+        case OverflowPolicy::drop_newest:
+            dropped();
+            return;
+        case OverflowPolicy::drop_lowest_priority:
+            dropped();
+            if (!dropLowestPriority(event->getEvent()))
+                return;
+            break;
+        case OverflowPolicy::coalesce:
+            if (coalesce(*event))
+                ++_Coalesced;
+            else
+                dropped();
+            return;
+        }
+    }
+
+    ++_QueuedByPriority[priority(event->getEvent())];
+    _Queue.push_back(std::move(event));
+    ++_Enqueued;
+    if (_Queue.size() > _HighWatermark)
+        _HighWatermark = _Queue.size();
+}
+
+TFileSystemEventPtr EventQueue::pop()
+{
+    if (_Queue.empty())
+        return nullptr;
+    auto event = std::move(_Queue.front());
+    _Queue.pop_front();
+    if (event->getEvent() == Event::overflow)
+        _Overflowed = false;
+    else
+        --_QueuedByPriority[priority(event->getEvent())];
+    return event;
+}
+
+QueueStatistics EventQueue::getStatistics() const
+{
+    return { _Enqueued, _Dropped, _Coalesced, _Blocked, _HighWatermark };
+}
+}
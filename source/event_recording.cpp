@@ -0,0 +1,148 @@
+#include <notify-cpp/event_recording.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace notifycpp {
+
+namespace {
+    const char RecordingMagic[8] = { 'N', 'C', 'P', 'P', 'R', 'E', 'C', '1' };
+
+    template <typename T>
+    void put(std::ofstream& stream, T value)
+    {
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    bool get(std::ifstream& stream, T& value)
+    {
+        return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(value)));
+    }
+}
+
+EventRecorder::EventRecorder(const std::filesystem::path& file)
+    : _Stream(file, std::ios::binary | std::ios::trunc)
+    , _Start(std::chrono::steady_clock::now())
+{
+    if (!_Stream)
+        throw std::runtime_error("Can't create recording! Path: " + file.string());
+    _Stream.write(RecordingMagic, sizeof(RecordingMagic));
+}
+
+void EventRecorder::writeHeader(RecordedEntry::Type type)
+{
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - _Start);
+    put(_Stream, static_cast<std::uint8_t>(type));
+    put(_Stream, static_cast<std::int64_t>(elapsed.count()));
+}
+
+void EventRecorder::writePath(const std::filesystem::path& path)
+{
+    put(_Stream, static_cast<std::uint32_t>(path.native().size()));
+    _Stream.write(path.native().data(), path.native().size());
+}
+
+void EventRecorder::read(const char* buffer, std::size_t length)
+{
+    writeHeader(RecordedEntry::Type::read);
+    put(_Stream, static_cast<std::uint32_t>(length));
+    _Stream.write(buffer, length);
+}
+
+void EventRecorder::watch(int wd, const std::filesystem::path& path, Event events, bool recursive, bool command)
+{
+    writeHeader(RecordedEntry::Type::watch);
+    put(_Stream, static_cast<std::int32_t>(wd));
+    put(_Stream, static_cast<std::uint32_t>(events));
+    put(_Stream, static_cast<std::uint8_t>(recursive));
+    put(_Stream, static_cast<std::uint8_t>(command));
+    writePath(path);
+}
+
+void EventRecorder::unwatch(const std::filesystem::path& path)
+{
+    writeHeader(RecordedEntry::Type::unwatch);
+    writePath(path);
+}
+
+EventPlayback::EventPlayback(const std::filesystem::path& file)
+    : _Stream(file, std::ios::binary)
+    , _File(file)
+    , _HasEntry(false)
+{
+    char magic[sizeof(RecordingMagic)];
+    if (!_Stream.read(magic, sizeof(magic)) || std::memcmp(magic, RecordingMagic, sizeof(magic)) != 0)
+        throw std::runtime_error("Invalid recording! Path: " + file.string());
+}
+
+bool EventPlayback::readEntry()
+{
+    std::uint8_t type;
+    if (!get(_Stream, type))
+        return false;
+
+    const auto corrupt = [this]() {
+        return std::runtime_error("Corrupt recording! Path: " + _File.string());
+    };
+
+    _Entry.type = static_cast<RecordedEntry::Type>(type);
+    if (!get(_Stream, _Entry.timestamp))
+        throw corrupt();
+
+    const auto readPath = [&]() {
+        std::uint32_t length;
+        std::string path;
+        if (!get(_Stream, length))
+            throw corrupt();
+        path.resize(length);
+        if (!_Stream.read(&path[0], length))
+            throw corrupt();
+        _Entry.path = path;
+    };
+
+    switch (_Entry.type) {
+    case RecordedEntry::Type::read: {
+        std::uint32_t length;
+        if (!get(_Stream, length))
+            throw corrupt();
+        _Entry.data.resize(length);
+        if (!_Stream.read(_Entry.data.data(), length))
+            throw corrupt();
+        break;
+    }
+    case RecordedEntry::Type::watch: {
+        std::int32_t wd;
+        std::uint32_t events;
+        std::uint8_t recursive, command;
+        if (!get(_Stream, wd) || !get(_Stream, events) || !get(_Stream, recursive) || !get(_Stream, command))
+            throw corrupt();
+        _Entry.wd = wd;
+        _Entry.events = static_cast<Event>(events);
+        _Entry.recursive = recursive != 0;
+        _Entry.command = command != 0;
+        readPath();
+        break;
+    }
+    case RecordedEntry::Type::unwatch:
+        readPath();
+        break;
+    default:
+        throw corrupt();
+    }
+    return true;
+}
+
+const RecordedEntry* EventPlayback::peek()
+{
+    if (!_HasEntry)
+        _HasEntry = readEntry();
+    return _HasEntry ? &_Entry : nullptr;
+}
+
+void EventPlayback::pop()
+{
+    _HasEntry = false;
+}
+}
@@ -37,6 +37,7 @@
 #include <sys/signalfd.h>
 #include <sys/stat.h>
 
+#include <bitset>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -46,6 +47,7 @@ namespace notifycpp {
 
 Fanotify::Fanotify()
     : Notify()
+    , _Buffer(_fanotify_buffer_size)
 {
     initFanotify();
 }
@@ -142,6 +144,7 @@ void Fanotify::unwatch(const FileSystemEvent& fse)
  */
 TFileSystemEventPtr Fanotify::getNextEvent()
 {
+    const auto deadline = readDeadline();
     struct pollfd fds[FD_POLL_MAX];
     /* Setup polling */
     fds[FD_POLL_FANOTIFY].fd = _FanotifyFd;
@@ -149,8 +152,17 @@ TFileSystemEventPtr Fanotify::getNextEvent()
 
     /* Now loop */
     while (_Queue.empty() && isRunning()) {
+        if (_BufferOffset < _BufferLength) {
+            decodeEvents();
+            continue;
+        }
+
+        if (isTimedOut(deadline)) {
+            return nullptr;
+        }
+
         /* Block until there is something to be read */
-        if (poll(fds, FD_POLL_MAX, mThreadSleep) < 0) {
+        if (poll(fds, FD_POLL_MAX, pollTimeout(deadline)) < 0) {
             std::stringstream errorStream;
             errorStream << "Couldn't poll(): " << strerror(errno) << ".";
             throw std::runtime_error(errorStream.str());
@@ -162,28 +174,11 @@ TFileSystemEventPtr Fanotify::getNextEvent()
 
         /* fanotify event received? */
         if (fds[FD_POLL_FANOTIFY].revents & POLLIN) {
-            char buffer[_fanotify_buffer_size];
-            ssize_t length;
-
             /* Read from the FD. It will read all events available up to
              * the given buffer size. */
-            if ((length = read(fds[FD_POLL_FANOTIFY].fd, buffer, _fanotify_buffer_size)) > 0) {
-
-                auto metadata = reinterpret_cast<fanotify_event_metadata*>(buffer);
-
-                while (FAN_EVENT_OK(metadata, length) && isRunning()) {
-
-                    const std::string filename = getFilePath(metadata->fd);
-                    const std::filesystem::path path(filename);
-                    if (!filename.empty() && !isIgnoredOnce(path)) {
-                        for (const Event event : _EventHandler.getFanotifyEvents(static_cast<uint32_t>(metadata->mask)))
-                            if (event != Event::none)
-                                _Queue.push(std::make_shared<FileSystemEvent>(path , event));
-                        close(metadata->fd);
-                    }
-                    metadata = FAN_EVENT_NEXT(metadata, length);
-                }
-            }
+            _BufferOffset = 0;
+            _BufferLength = read(fds[FD_POLL_FANOTIFY].fd, _Buffer.data(), _Buffer.size());
+            decodeEvents();
         }
     }
 
@@ -192,9 +187,37 @@ TFileSystemEventPtr Fanotify::getNextEvent()
     }
 
     // Return next event
-    auto event = _Queue.front();
-    _Queue.pop();
-    return event;
+    return _Queue.pop();
+}
+
+/**
+ * @brief Decodes the read buffer into the event queue. Stops early if
+ *        the queue is full and configured to block, the rest of the
+ *        buffer is decoded by the next call.
+ */
+void Fanotify::decodeEvents()
+{
+    ssize_t length = _BufferLength - _BufferOffset;
+    auto metadata = reinterpret_cast<fanotify_event_metadata*>(_Buffer.data() + _BufferOffset);
+
+    // one event is pushed per flag of the mask at most
+    while (FAN_EVENT_OK(metadata, length) && isRunning()
+        && _Queue.accept(std::bitset<64>(metadata->mask).count())) {
+        const std::string filename = getFilePath(metadata->fd);
+        const std::filesystem::path path(filename);
+        if (metadata->mask & FAN_Q_OVERFLOW)
+            _Queue.push(std::make_shared<FileSystemEvent>(path, Event::overflow));
+        else if (!filename.empty() && !isIgnoredOnce(path)) {
+            for (const Event event : _EventHandler.getFanotifyEvents(static_cast<uint32_t>(metadata->mask)))
+                if (event != Event::none)
+                    _Queue.push(std::make_shared<FileSystemEvent>(path, event, 0, static_cast<std::uint32_t>(metadata->pid)));
+        }
+        if (metadata->fd >= 0)
+            close(metadata->fd);
+        metadata = FAN_EVENT_NEXT(metadata, length);
+    }
+
+    _BufferOffset = FAN_EVENT_OK(metadata, length) ? _BufferLength - length : _BufferLength;
 }
 
 
@@ -0,0 +1,195 @@
+#include <notify-cpp/file_follower.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace notifycpp {
+
+namespace {
+    const Event FollowEvents = Event::modify | Event::close_write;
+
+    /**
+     * @brief Key and path of a followed file, the same file given as
+     *        relative or unnormalized path is followed once
+     */
+    std::filesystem::path normalize(const std::filesystem::path& path)
+    {
+        return std::filesystem::absolute(path).lexically_normal();
+    }
+
+    /**
+     * @brief Pattern routing the events of exactly the path, glob
+     *        characters in file names are matched literally
+     */
+    std::string literalPattern(const std::filesystem::path& path)
+    {
+        std::string pattern;
+        for (const char c : path.string()) {
+            if (c == '*' || c == '?' || c == '[' || c == '\\')
+                pattern += '\\';
+            pattern += c;
+        }
+        return pattern;
+    }
+}
+
+FileFollower::FileFollower(NotifyController& controller, ChunkObserver observer, std::size_t bufferSize)
+    : _Controller(controller)
+    , _Observer(std::move(observer))
+    , _Buffer(bufferSize)
+{
+    if (bufferSize == 0)
+        throw std::invalid_argument("The follower needs a buffer of at least one byte");
+}
+
+FileFollower::~FileFollower()
+{
+    std::vector<std::filesystem::path> files;
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        for (const auto& file : _Files)
+            files.emplace_back(file.first);
+    }
+    for (const auto& file : files)
+        unfollow(file);
+}
+
+/**
+ * @brief Watches the file and reads everything appended after the
+ *        offset. The bytes already behind the offset are read at once.
+ *
+ * @param offset where reading starts, end for the current size
+ */
+FileFollower& FileFollower::follow(const std::filesystem::path& file, std::uint64_t offset)
+{
+    const auto path = normalize(file);
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        std::stringstream errorStream;
+        errorStream << "Can't follow file! " << strerror(errno) << ". Path: " << path;
+        throw std::runtime_error(errorStream.str());
+    }
+
+    struct stat st;
+    if (offset == end) {
+        offset = fstat(fd, &st) == 0 ? static_cast<std::uint64_t>(st.st_size) : 0;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        if (!_Files.emplace(path.native(), File { path, fd, offset }).second) {
+            close(fd);
+            return *this;
+        }
+    }
+
+    // watched before reading, nothing appended in between is missed
+    _Controller.followPath({ path, FollowEvents });
+    _Controller.onPath(literalPattern(path), FollowEvents | Event::replaced, [this](Notification notification) {
+        if (notification.getEvent() == Event::replaced)
+            reopen(notification.getPath());
+        else
+            read(notification.getPath());
+    });
+    read(path);
+    return *this;
+}
+
+FileFollower& FileFollower::unfollow(const std::filesystem::path& file)
+{
+    const auto path = normalize(file);
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        const auto found = _Files.find(path.native());
+        if (found == _Files.end())
+            return *this;
+        if (found->second.fd != -1)
+            close(found->second.fd);
+        _Files.erase(found);
+    }
+    _Controller.removePathObserver(literalPattern(path));
+    _Controller.unwatch(path);
+    return *this;
+}
+
+/**
+ * @brief Offset of the next byte read from the file, e.g. to follow
+ *        it from there after a restart
+ */
+std::uint64_t FileFollower::offset(const std::filesystem::path& path) const
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    const auto found = _Files.find(normalize(path).native());
+    return found == _Files.end() ? 0 : found->second.offset;
+}
+
+/**
+ * @brief Passes the bytes appended since the last read to the observer,
+ *        called for the events of the file.
+ */
+void FileFollower::read(const std::filesystem::path& path)
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    const auto found = _Files.find(normalize(path).native());
+    if (found != _Files.end())
+        readLocked(found->second);
+}
+
+/**
+ * @brief Reads the rest of the old file and continues with the file now
+ *        at the path, called for its replaced events.
+ */
+void FileFollower::reopen(const std::filesystem::path& path)
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    const auto found = _Files.find(normalize(path).native());
+    if (found == _Files.end())
+        return;
+
+    auto& file = found->second;
+    readLocked(file);
+    if (file.fd != -1)
+        close(file.fd);
+    // gone again, the next replaced event opens it
+    file.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    file.offset = 0;
+    readLocked(file, true);
+}
+
+void FileFollower::readLocked(File& file, bool restarted)
+{
+    struct stat st;
+    if (file.fd == -1 || fstat(file.fd, &st) == -1)
+        return;
+
+    bool truncated = restarted;
+    if (static_cast<std::uint64_t>(st.st_size) < file.offset) {
+        file.offset = 0;
+        truncated = true;
+    }
+
+    while (true) {
+        const auto length = pread(file.fd, _Buffer.data(), _Buffer.size(), static_cast<off_t>(file.offset));
+        if (length == -1 && errno == EINTR)
+            continue;
+        if (length <= 0)
+            break;
+
+        _Observer({ file.path, file.offset, std::string_view(_Buffer.data(), static_cast<std::size_t>(length)), truncated });
+        file.offset += static_cast<std::uint64_t>(length);
+        truncated = false;
+        // a short read ends at the end of the file
+        if (static_cast<std::size_t>(length) < _Buffer.size())
+            break;
+    }
+
+    if (truncated)
+        _Observer({ file.path, 0, {}, true });
+}
+}
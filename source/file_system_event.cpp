@@ -28,6 +28,12 @@ namespace notifycpp {
 FileSystemEvent::FileSystemEvent(const std::filesystem::path& p)
     : _Event(Event::open)
     , _Path(p)
+    , _Cookie(0)
+    , _Pid(0)
+    , _Priority(Priority::normal)
+    , _Sequence(0)
+    , _Shard(0)
+    , _ShardSequence(0)
 {
 }
 
@@ -35,6 +41,25 @@ FileSystemEvent::FileSystemEvent(const std::filesystem::path& p,
     const Event event)
     : _Event(event)
     , _Path(p)
+    , _Cookie(0)
+    , _Pid(0)
+    , _Priority(Priority::normal)
+    , _Sequence(0)
+    , _Shard(0)
+    , _ShardSequence(0)
+{
+}
+
+FileSystemEvent::FileSystemEvent(const std::filesystem::path& p,
+    const Event event, std::uint32_t cookie, std::uint32_t pid)
+    : _Event(event)
+    , _Path(p)
+    , _Cookie(cookie)
+    , _Pid(pid)
+    , _Priority(Priority::normal)
+    , _Sequence(0)
+    , _Shard(0)
+    , _ShardSequence(0)
 {
 }
 
@@ -52,4 +77,50 @@ FileSystemEvent::getPath() const
 {
     return _Path;
 }
+
+std::uint32_t FileSystemEvent::getCookie() const
+{
+    return _Cookie;
+}
+
+std::uint32_t FileSystemEvent::getPid() const
+{
+    return _Pid;
+}
+
+Priority FileSystemEvent::getPriority() const
+{
+    return _Priority;
+}
+
+void FileSystemEvent::setPriority(Priority priority)
+{
+    _Priority = priority;
+}
+
+std::uint64_t FileSystemEvent::getSequence() const
+{
+    return _Sequence;
+}
+
+void FileSystemEvent::setSequence(std::uint64_t sequence)
+{
+    _Sequence = sequence;
+}
+
+std::uint32_t FileSystemEvent::getShard() const
+{
+    return _Shard;
+}
+
+std::uint64_t FileSystemEvent::getShardSequence() const
+{
+    return _ShardSequence;
+}
+
+void FileSystemEvent::setShard(std::uint32_t shard, std::uint64_t sequence)
+{
+    _Shard = shard;
+    _ShardSequence = sequence;
+}
 }
@@ -8,14 +8,28 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 namespace notifycpp {
+
+namespace {
+    //! events of the directory of a followed path, see followEntry()
+    const std::uint32_t FollowDirectoryMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+}
+
 Inotify::Inotify()
     : mError(0)
+    , mWatchCount(0)
+    , mPendingMove { 0, WatchTree::npos, false }
+    , mHasPendingMove(false)
+    , mHasWatchCommands(false)
     , mInotifyFd(0)
+    , mBuffer(EVENT_BUF_LEN)
+    , mBufferLength(0)
+    , mBufferOffset(0)
 {
     // Initialize inotify
     init();
@@ -41,23 +55,21 @@ void Inotify::init()
 }
 
 /**
- * @brief Adds a single file/directorie to the list of
- *        watches. Path and corresponding watchdescriptor
- *        will be stored in the directorieMap. This is done
- *        because events on watches just return this
- *        watchdescriptor.
- *
- * @param path that will be watched
+ * @brief Adds the watch to the kernel. Watches added by other threads
+ *        than the reader have to hold mWatchMutex until the add
+ *        command is queued.
  *
+ * @return watchdescriptor
  */
-void Inotify::watchFile(const FileSystemEvent& fse)
+int Inotify::addWatch(const std::filesystem::path& path, Event events, bool recursive, std::uint32_t flags)
 {
-    if (!checkWatchFile(fse))
-        return;
+    std::uint32_t mask = getEventMask(events) | flags;
+    if (recursive)
+        mask |= IN_CREATE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
 
     mError = 0;
     int wd = 0;
-    wd = inotify_add_watch(mInotifyFd, fse.getPath().c_str(), getEventMask(fse.getEvent()));
+    wd = inotify_add_watch(mInotifyFd, path.c_str(), mask);
 
     if (wd == -1) {
         mError = errno;
@@ -69,46 +81,586 @@ void Inotify::watchFile(const FileSystemEvent& fse)
             throw std::runtime_error(errorStream.str());
         }
 
-        errorStream << "Failed to watch! " << strerror(mError) << ". Path: " << fse.getPath();
+        errorStream << "Failed to watch! " << strerror(mError) << ". Path: " << path;
         throw std::runtime_error(errorStream.str());
     }
 
-    mDirectorieMap.emplace(wd, fse.getPath());
+    return wd;
+}
+
+/**
+ * @brief Adds a watch to the table used for decoding. A wd returned
+ *        again for the same inode replaces the old entry. Only called
+ *        by the reading thread.
+ */
+void Inotify::attachWatch(int wd, const std::filesystem::path& path, Event events, bool recursive)
+{
+    // the add replaced the mask of a followed file, the follow keeps its events
+    const auto* existing = findWatch(wd);
+    const bool followed = existing && existing->followed;
+    if (followed) {
+        events = events | existing->events;
+        inotify_add_watch(mInotifyFd, path.c_str(), getEventMask(existing->events) | IN_MASK_ADD);
+    }
+    // and so did the add of a directory with followed paths
+    if (mFollowedDirectories.count(wd))
+        inotify_add_watch(mInotifyFd, path.c_str(), FollowDirectoryMask | IN_MASK_ADD);
+    forgetWatch(wd);
+
+    // wds are small integers handed out in ascending order
+    if (static_cast<std::size_t>(wd) >= mWatches.size())
+        mWatches.resize(std::max<std::size_t>(wd + 1, mWatches.size() * 2), { WatchTree::npos, Event::none, false });
+
+    const auto node = mWatchTree.insert(path);
+    mWatches[wd] = { node, events, recursive, true, followed };
+    mWatchTree.setWatch(node, wd);
+    ++mWatchCount;
+    updateWatchStatistics();
+}
+
+/**
+ * @return the watch or nullptr if the wd is unknown
+ */
+const Inotify::Watch* Inotify::findWatch(int wd) const
+{
+    if (wd < 0 || static_cast<std::size_t>(wd) >= mWatches.size() || mWatches[wd].node == WatchTree::npos)
+        return nullptr;
+    return &mWatches[wd];
+}
+
+/**
+ * @brief Publishes the size of the watch table. Only called by the
+ *        reading thread.
+ */
+void Inotify::updateWatchStatistics()
+{
+    mWatchStatistics.watches = mWatchCount;
+    mWatchStatistics.nodes = mWatchTree.size();
+    mWatchStatistics.bytes = mWatchTree.memoryUsage() + mWatches.capacity() * sizeof(Watch);
+}
+
+/**
+ * @brief Size of the watch table as of the last change applied by the
+ *        reading thread.
+ */
+WatchStatistics Inotify::getWatchStatistics() const
+{
+    WatchStatistics statistics;
+    statistics.watches = mWatchStatistics.watches;
+    statistics.nodes = mWatchStatistics.nodes;
+    statistics.bytes = mWatchStatistics.bytes;
+    if (auto critical = std::atomic_load(&mCritical)) {
+        const auto criticalStatistics = critical->getWatchStatistics();
+        statistics.watches += criticalStatistics.watches;
+        statistics.nodes += criticalStatistics.nodes;
+        statistics.bytes += criticalStatistics.bytes;
+    }
+    return statistics;
+}
+
+/**
+ * @brief Adds a single file/directorie to the list of
+ *        watches. Path and corresponding watchdescriptor
+ *        will be stored in the directorieMap. This is done
+ *        because events on watches just return this
+ *        watchdescriptor.
+ *
+ * @param path that will be watched
+ *
+ */
+void Inotify::watchFile(const FileSystemEvent& fse)
+{
+    if (!checkWatchFile(fse))
+        return;
+
+    // An event for the new wd can be read before this returns. The flag
+    // is set before the syscall, so the reader waits for the lock held
+    // across it and decodes the event after the add command.
+    std::lock_guard<std::mutex> lock(mWatchMutex);
+    mHasWatchCommands = true;
+
+    const int wd = addWatch(fse.getPath(), fse.getEvent(), false);
+    mWatchCommands.push_back({WatchCommand::Type::add, wd, fse.getPath(), fse.getEvent(), false});
+}
+
+/**
+ * @brief Watches a directory. Events for entries of the directory
+ *        are reported with the path of the entry. This is not done
+ *        recursively!
+ *
+ * @param path of the directory that will be watched
+ */
+void Inotify::watchDirectory(const FileSystemEvent& fse)
+{
+    if (!checkWatchDirectory(fse))
+        return;
+
+    // set before the syscall, see watchFile()
+    std::lock_guard<std::mutex> lock(mWatchMutex);
+    mHasWatchCommands = true;
+
+    const int wd = addWatch(fse.getPath(), fse.getEvent(), false);
+    mWatchCommands.push_back({WatchCommand::Type::add, wd, fse.getPath(), fse.getEvent(), false});
+}
+
+/**
+ * @brief Watches the directory and all subdirectories. Directories
+ *        created later are watched as soon as their create event is
+ *        read. Ignored directories are skipped with their subtree.
+ *
+ * @param path of the directory that will be watched recursively
+ */
+void Inotify::watchPathRecursively(const FileSystemEvent& fse)
+{
+    if (!checkWatchDirectory(fse))
+        return;
+
+    // set before the first syscall, the commands queued before an
+    // error are applied as well
+    std::lock_guard<std::mutex> lock(mWatchMutex);
+    mHasWatchCommands = true;
+
+    const auto add = [&](const std::filesystem::path& path) {
+        const int wd = addWatch(path, fse.getEvent(), true);
+        mWatchCommands.push_back({WatchCommand::Type::add, wd, path, fse.getEvent(), true});
+    };
+
+    add(fse.getPath());
+    for (auto it = std::filesystem::recursive_directory_iterator(fse.getPath());
+         it != std::filesystem::recursive_directory_iterator(); ++it) {
+        if (!it->is_directory())
+            continue;
+        if (isIgnored(it->path())) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        add(it->path());
+    }
+}
+
+/**
+ * @brief Watches a directory created in or moved into a recursively
+ *        watched directory, including its subdirectories. Only called
+ *        by the reading thread, errors are ignored because the
+ *        directory can be gone already.
+ */
+void Inotify::watchNewDirectory(const Watch& parent, const std::filesystem::path& path)
+{
+    if (isIgnored(path))
+        return;
+
+    std::vector<std::filesystem::path> directories { path };
+    std::error_code error;
+    for (auto it = std::filesystem::recursive_directory_iterator(path, error);
+         !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+        if (!it->is_directory(error))
+            continue;
+        if (isIgnored(it->path()))
+            it.disable_recursion_pending();
+        else
+            directories.push_back(it->path());
+    }
+
+    for (const auto& directory : directories) {
+        try {
+            const int wd = addWatch(directory, parent.events, true);
+            if (mRecorder)
+                mRecorder->watch(wd, directory, parent.events, true, false);
+            attachWatch(wd, directory, parent.events, true);
+        } catch (const std::runtime_error&) {
+        }
+    }
 }
 
+/**
+ * @brief Unwatches the path. The watch is removed by the reading
+ *        thread, which knows the current path of every watch.
+ */
 void Inotify::unwatch(const FileSystemEvent& fse)
 {
-    auto const itFound = std::find_if(
-        std::begin(mDirectorieMap),
-        std::end(mDirectorieMap),
-        [&](std::pair<int, std::string> const& KeyString) { return KeyString.second == fse.getPath(); });
+    if (auto critical = std::atomic_load(&mCritical))
+        critical->unwatch(fse);
 
-    if (itFound != std::end(mDirectorieMap))
-        removeWatch(itFound->first);
+    std::lock_guard<std::mutex> lock(mWatchMutex);
+    mWatchCommands.push_back({WatchCommand::Type::remove, -1, fse.getPath(), Event::none, false});
+    mHasWatchCommands = true;
 }
 
 /**
- * @brief Removes watch from set of watches. This
- *        is not done recursively!
+ * @brief Watches the directory recursively on the critical instance,
+ *        which is created with the first critical watch.
+ */
+void Inotify::watchCriticalPath(const FileSystemEvent& fse)
+{
+    auto critical = std::atomic_load(&mCritical);
+    if (!critical) {
+        auto created = std::make_shared<Inotify>();
+        if (std::atomic_compare_exchange_strong(&mCritical, &critical, created))
+            critical = created;
+    }
+
+    {
+        std::scoped_lock lock(_IgnoredMutex, critical->_IgnoredMutex);
+        critical->_Ignored = _Ignored;
+    }
+    critical->watchPathRecursively(fse);
+}
+
+/**
+ * @brief Watches the file by its path, also across log rotation and
+ *        atomic replace. The file does not need to exist yet, its
+ *        parent directory does.
  *
- * @param wd watchdescriptor
+ * @param path of the file and the events that will be watched
+ */
+void Inotify::followPath(const FileSystemEvent& fse)
+{
+    const auto path = fse.getPath().lexically_normal();
+    if (isIgnored(path))
+        return;
+
+    const auto directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+
+    std::lock_guard<std::mutex> lock(mWatchMutex);
+    mHasWatchCommands = true;
+    const int parent = addWatch(directory, Event::none, false, FollowDirectoryMask | IN_MASK_ADD);
+
+    int wd = -1;
+    std::error_code error;
+    if (std::filesystem::is_regular_file(path, error)) {
+        try {
+            wd = addWatch(path, fse.getEvent(), false, IN_MASK_ADD);
+        } catch (const std::runtime_error&) {
+            // gone again, watched when it reappears
+        }
+    }
+    mWatchCommands.push_back({ WatchCommand::Type::follow, wd, path, fse.getEvent(), false, parent });
+}
+
+/**
+ * @brief Follows a followed name to the new file when it appears again,
+ *        drops the watch of the old file when it disappears. Only called
+ *        by the reading thread.
+ */
+void Inotify::followEntry(const inotify_event& event)
+{
+    const auto directory = mFollowedDirectories.find(event.wd);
+    if (directory == mFollowedDirectories.end())
+        return;
+    const auto found = mFollows.find((directory->second.path / event.name).native());
+    if (found == mFollows.end())
+        return;
+
+    auto& follow = found->second;
+    if (event.mask & (IN_DELETE | IN_MOVED_FROM)) {
+        detachFollowed(follow);
+        return;
+    }
+    if (!(event.mask & (IN_CREATE | IN_MOVED_TO)) || (event.mask & IN_ISDIR))
+        return;
+
+    // moved_to can replace a file which is still there
+    detachFollowed(follow);
+    try {
+        follow.wd = addWatch(follow.path, follow.events, false, IN_MASK_ADD);
+    } catch (const std::runtime_error&) {
+        return;
+    }
+    if (mRecorder)
+        mRecorder->watch(follow.wd, follow.path, follow.events, false, false);
+    attachFollowed(follow);
+
+    if (!isIgnoredOnce(follow.path))
+        _Queue.push(std::make_shared<FileSystemEvent>(follow.path, Event::replaced));
+}
+
+/**
+ * @brief Adds the watch of the file a followed name refers to. A wd the
+ *        file is watched with already is shared, its events are joined.
+ *        Only called by the reading thread.
+ */
+void Inotify::attachFollowed(Follow& follow)
+{
+    if (findWatch(follow.wd)) {
+        auto& watch = mWatches[follow.wd];
+        watch.events = watch.events | follow.events;
+        watch.followed = true;
+        return;
+    }
+    attachWatch(follow.wd, follow.path, follow.events, false);
+    mWatches[follow.wd].watched = false;
+    mWatches[follow.wd].followed = true;
+}
+
+/**
+ * @brief Removes the watch of the file a followed name referred to,
+ *        unless the file is watched as well. Only called by the reading
+ *        thread.
+ */
+void Inotify::detachFollowed(Follow& follow)
+{
+    if (follow.wd == -1)
+        return;
+    const auto* watch = findWatch(follow.wd);
+    if (watch && watch->watched) {
+        mWatches[follow.wd].followed = false;
+    }
+    else {
+        forgetWatch(follow.wd);
+        inotify_rm_watch(mInotifyFd, follow.wd);
+    }
+    follow.wd = -1;
+}
+
+/**
+ * @brief Updates the followed paths for a watch removed by the kernel.
+ *        Only called by the reading thread.
+ */
+void Inotify::forgetFollowed(int wd)
+{
+    if (mFollowedDirectories.erase(wd)) {
+        for (auto it = mFollows.begin(); it != mFollows.end();) {
+            if (it->second.parent == wd) {
+                detachFollowed(it->second);
+                it = mFollows.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        return;
+    }
+
+    const auto* watch = findWatch(wd);
+    if (!watch)
+        return;
+    const auto found = mFollows.find(mWatchTree.path(watch->node).native());
+    if (found != mFollows.end() && found->second.wd == wd)
+        found->second.wd = -1;
+}
+
+/**
+ * @brief Stops following the path, the directory is unwatched with its
+ *        last followed path unless it is watched itself. Only called by
+ *        the reading thread.
  *
+ * @return false if the path is not followed
  */
-void Inotify::removeWatch(int wd)
+bool Inotify::unfollow(const std::filesystem::path& path)
 {
-    int result = inotify_rm_watch(mInotifyFd, wd);
-    if (result == -1) {
-        mError = errno;
-        std::stringstream errorStream;
-        errorStream << "Failed to remove watch! " << strerror(mError) << ".";
-        throw std::runtime_error(errorStream.str());
+    const auto found = mFollows.find(path.lexically_normal().native());
+    if (found == mFollows.end())
+        return false;
+
+    const int parent = found->second.parent;
+    detachFollowed(found->second);
+    mFollows.erase(found);
+
+    const auto directory = mFollowedDirectories.find(parent);
+    if (directory != mFollowedDirectories.end() && --directory->second.follows == 0) {
+        mFollowedDirectories.erase(directory);
+        if (!findWatch(parent))
+            inotify_rm_watch(mInotifyFd, parent);
+    }
+    return true;
+}
+
+/**
+ * @brief Forgets a watch removed by the kernel, e.g. because the
+ *        watched file was deleted. Only called by the reading thread.
+ */
+void Inotify::forgetWatch(int wd)
+{
+    const auto* watch = findWatch(wd);
+    if (!watch)
+        return;
+
+    const auto node = watch->node;
+    if (mWatchTree.watch(node) == wd)
+        mWatchTree.setWatch(node, -1);
+    mWatches[wd].node = WatchTree::npos;
+    --mWatchCount;
+    mWatchTree.release(node);
+    updateWatchStatistics();
+}
+
+/**
+ * @brief Removes all watches of a directory moved out of the watched
+ *        tree. Only called by the reading thread.
+ */
+void Inotify::unwatchSubtree(WatchTree::NodeId node)
+{
+    std::vector<int> descriptors;
+    for (std::size_t wd = 0; wd < mWatches.size(); ++wd)
+        if (mWatches[wd].node != WatchTree::npos && mWatchTree.isAncestor(node, mWatches[wd].node))
+            descriptors.push_back(static_cast<int>(wd));
+
+    for (const int wd : descriptors)
+        releaseWatch(wd);
+}
+
+/**
+ * @brief Removes a watch of the user, the wd stays while a followed
+ *        path or the directory of one holds it, or while it is added
+ *        again. Only called by the reading thread.
+ */
+void Inotify::releaseWatch(int wd)
+{
+    if (mWatches[wd].followed) {
+        mWatches[wd].watched = false;
+        return;
+    }
+    // added again by a later command of the batch
+    if (mReadded.count(wd)) {
+        forgetWatch(wd);
+        return;
+    }
+    const auto directory = mFollowedDirectories.find(wd);
+    if (directory != mFollowedDirectories.end()) {
+        // back to the events of the follows
+        forgetWatch(wd);
+        inotify_add_watch(mInotifyFd, directory->second.path.c_str(), FollowDirectoryMask);
+        return;
+    }
+    forgetWatch(wd);
+    inotify_rm_watch(mInotifyFd, wd);
+}
+
+/**
+ * @brief A remembered moved_from not directly followed by its moved_to
+ *        left the watched tree. Only called by the reading thread.
+ */
+void Inotify::settleMove(const inotify_event& event)
+{
+    if (!mHasPendingMove || ((event.mask & IN_MOVED_TO) && event.cookie == mPendingMove.cookie))
+        return;
+
+    mHasPendingMove = false;
+    if (mPendingMove.recursive)
+        unwatchSubtree(mPendingMove.node);
+}
+
+/**
+ * @brief Keeps the watch tree in sync with renames. A moved_from of a
+ *        watched entry is remembered, the moved_to with the same cookie
+ *        relinks it. Only called by the reading thread.
+ *
+ * @return true if the event completed a rename of a watched entry
+ */
+bool Inotify::trackMove(const Watch& watch, const inotify_event& event)
+{
+    if (event.len == 0)
+        return false;
+
+    if (event.mask & IN_MOVED_FROM) {
+        const auto node = mWatchTree.child(watch.node, event.name);
+        if (node != WatchTree::npos) {
+            mPendingMove = { event.cookie, node, watch.recursive };
+            mHasPendingMove = true;
+        }
+        return false;
+    }
+
+    if ((event.mask & IN_MOVED_TO) && mHasPendingMove) {
+        mHasPendingMove = false;
+        mWatchTree.move(mPendingMove.node, watch.node, event.name);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Applies watches added or removed by other threads to the
+ *        table used for decoding. Only called by the reading thread.
+ */
+void Inotify::applyWatchCommands()
+{
+    if (!mHasWatchCommands)
+        return;
+
+    // Applied under the lock: an add of the inode of a watch being
+    // removed returns its wd, it is either queued in this batch or
+    // issued after the wd was removed.
+    std::lock_guard<std::mutex> lock(mWatchMutex);
+    for (const auto& command : mWatchCommands)
+        if (command.type != WatchCommand::Type::remove && command.wd != -1)
+            ++mReadded[command.wd];
+
+    for (const auto& command : mWatchCommands) {
+        applyWatchCommand(command);
+        if (command.type != WatchCommand::Type::remove && command.wd != -1 && --mReadded[command.wd] == 0)
+            mReadded.erase(command.wd);
+    }
+    mWatchCommands.clear();
+    mHasWatchCommands = false;
+}
+
+void Inotify::applyWatchCommand(const WatchCommand& command)
+{
+    if (command.type == WatchCommand::Type::follow) {
+        if (command.wd != -1 && mRecorder)
+            mRecorder->watch(command.wd, command.path, command.events, false, true);
+        auto existing = mFollows.find(command.path.native());
+        if (existing != mFollows.end()) {
+            existing->second.events = command.events;
+            existing->second.wd = command.wd;
+            if (command.wd != -1)
+                attachFollowed(existing->second);
+            return;
+        }
+        existing = mFollows.emplace(command.path.native(), Follow { command.path, command.events, command.parent, command.wd }).first;
+        if (command.wd != -1)
+            attachFollowed(existing->second);
+        auto& directory = mFollowedDirectories[command.parent];
+        directory.path = command.path.has_parent_path() ? command.path.parent_path() : std::filesystem::path(".");
+        ++directory.follows;
+        return;
+    }
+
+    if (command.type == WatchCommand::Type::add) {
+        if (mRecorder)
+            mRecorder->watch(command.wd, command.path, command.events, command.recursive, true);
+        attachWatch(command.wd, command.path, command.events, command.recursive);
+        return;
+    }
+
+    if (mRecorder)
+        mRecorder->unwatch(command.path);
+    if (unfollow(command.path))
+        return;
+    const auto node = mWatchTree.find(command.path);
+    const int wd = mWatchTree.watch(node);
+    if (wd == -1)
+        return;
+    // the subdirectories were watched with the root
+    if (mWatches[wd].recursive)
+        unwatchSubtree(node);
+    else
+        releaseWatch(wd);
+}
+
+/**
+ * @brief Starts recording the raw event stream to the file, beginning
+ *        with the watches already known to the reader. Has to be called
+ *        before events are read.
+ */
+void Inotify::record(const std::filesystem::path& file)
+{
+    mRecorder = std::make_unique<EventRecorder>(file);
+    for (std::size_t wd = 0; wd < mWatches.size(); ++wd) {
+        const auto& watch = mWatches[wd];
+        if (watch.node != WatchTree::npos)
+            mRecorder->watch(static_cast<int>(wd), mWatchTree.path(watch.node), watch.events, watch.recursive, true);
     }
 }
 
 std::filesystem::path
-Inotify::wdToPath(int wd)
+Inotify::wdToPath(int wd) const
 {
-    return mDirectorieMap.at(wd);
+    const auto* watch = findWatch(wd);
+    if (!watch)
+        return {};
+    return mWatchTree.path(watch->node);
 }
 
 /**
@@ -122,44 +674,39 @@ Inotify::wdToPath(int wd)
  */
 TFileSystemEventPtr Inotify::getNextEvent()
 {
-    int length = 0;
-    char buffer[EVENT_BUF_LEN];
+    const auto deadline = readDeadline();
+
+    if (auto event = nextCritical())
+        return event;
 
     // Read Events from fd into buffer
     while (_Queue.empty() && isRunning()) {
-        length = 0;
-        memset(buffer, '\0', sizeof(buffer));
-        while (length <= 0 && !stopped && isRunning()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(mThreadSleep));
+        while (mBufferOffset >= mBufferLength && !stopped && isRunning()) {
+            if (auto event = nextCritical())
+                return event;
 
-            length = read(mInotifyFd, buffer, EVENT_BUF_LEN);
-            if (length == -1) {
+            if (isTimedOut(deadline)) {
+                // e.g. an unwatch, whose watches send nothing to read
+                applyWatchCommands();
+                return nullptr;
+            }
+
+            mBufferOffset = 0;
+            mBufferLength = readEvents(mBuffer.data(), mBuffer.size(), deadline);
+            if (mBufferLength == -1) {
                 mError = errno;
-                if (mError != EINTR) {
-                    continue;
-                }
+                continue;
             }
+            if (mBufferLength > 0 && mRecorder)
+                mRecorder->read(mBuffer.data(), static_cast<std::size_t>(mBufferLength));
         }
 
         if (isStopped()) {
             return nullptr;
         }
 
-        int i = 0;
-        while (i < length && isRunning()) {
-
-            const auto* event = reinterpret_cast<inotify_event*>(&buffer[i]);
-            if (!event)
-                return nullptr;
-
-            const auto path = wdToPath(event->wd);
-            if (!isIgnoredOnce(path)) {
-                _Queue.push(std::make_shared<FileSystemEvent>(path,
-                                                              _EventHandler.getInotify(
-                                                                      static_cast<uint32_t>(event->mask))));
-            }
-            i += EVENT_SIZE + event->len;
-        }
+        applyWatchCommands();
+        decodeEvents();
     }
 
     if (isStopped() || _Queue.empty()) {
@@ -167,11 +714,125 @@ TFileSystemEventPtr Inotify::getNextEvent()
     }
 
     // Return next event
-    auto event = _Queue.front();
-    _Queue.pop();
+    return _Queue.pop();
+}
+
+/**
+ * @brief Waits until the inotify descriptor is readable or the
+ *        deadline has passed and reads the available events.
+ *
+ * @return bytes read, 0 if nothing was read, -1 on error
+ */
+ssize_t Inotify::readEvents(char* buffer, std::size_t size, const std::chrono::steady_clock::time_point& deadline)
+{
+    // the critical instance wakes the reader as well, it is read by nextCritical
+    struct pollfd fds[2] = { { mInotifyFd, POLLIN, 0 }, { -1, POLLIN, 0 } };
+    if (auto critical = std::atomic_load(&mCritical))
+        fds[1].fd = critical->mInotifyFd;
+
+    // Block until there is something to be read
+    if (poll(fds, 2, pollTimeout(deadline)) <= 0 || !(fds[0].revents & POLLIN))
+        return 0;
+
+    return read(mInotifyFd, buffer, size);
+}
+
+/**
+ * @return next event of the critical instance, nullptr if there is none
+ *         or no critical path is watched
+ */
+TFileSystemEventPtr Inotify::nextCritical()
+{
+    auto critical = std::atomic_load(&mCritical);
+    if (!critical)
+        return nullptr;
+    return critical->readCritical();
+}
+
+/**
+ * @brief Returns the next event of the critical instance without
+ *        waiting. Called by the thread reading the main instance.
+ */
+TFileSystemEventPtr Inotify::readCritical()
+{
+    applyWatchCommands();
+
+    if (_Queue.empty() && mBufferOffset >= mBufferLength) {
+        mBufferOffset = 0;
+        // the descriptor doesn't block
+        mBufferLength = read(mInotifyFd, mBuffer.data(), mBuffer.size());
+        if (mBufferLength == -1) {
+            if (errno != EAGAIN)
+                mError = errno;
+            mBufferLength = 0;
+        }
+    }
+    decodeEvents();
+
+    if (_Queue.empty())
+        return nullptr;
+
+    auto event = _Queue.pop();
+    event->setPriority(Priority::critical);
     return event;
 }
 
+/**
+ * @brief Decodes the read buffer into the event queue. Stops early if
+ *        the queue is full and configured to block, the rest of the
+ *        buffer is decoded by the next call.
+ */
+void Inotify::decodeEvents()
+{
+    // a followed path can report a replaced event as well
+    const std::size_t pushes = mFollowedDirectories.empty() ? 1 : 2;
+    while (mBufferOffset < mBufferLength && isRunning() && _Queue.accept(pushes)) {
+        const auto* event = reinterpret_cast<inotify_event*>(&mBuffer[mBufferOffset]);
+        mBufferOffset += EVENT_SIZE + event->len;
+
+        if (event->mask & IN_IGNORED) {
+            forgetFollowed(event->wd);
+            forgetWatch(event->wd);
+            continue;
+        }
+
+        // overflow has no watch, it concerns every path
+        if (event->mask & IN_Q_OVERFLOW) {
+            _Queue.push(std::make_shared<FileSystemEvent>(std::filesystem::path{}, Event::overflow));
+            continue;
+        }
+
+        if (!mFollowedDirectories.empty() && event->len > 0)
+            followEntry(*event);
+
+        settleMove(*event);
+
+        // events of removed watches have no path anymore
+        const auto* found = findWatch(event->wd);
+        if (!found)
+            continue;
+
+        const Watch watch = *found;
+        const auto directory = mWatchTree.path(watch.node);
+        const auto path = event->len > 0 ? directory / event->name : directory;
+        const std::uint32_t mask = event->mask & ~IN_ISDIR;
+
+        const bool relinked = trackMove(watch, *event);
+
+        if (watch.recursive && !relinked && (event->mask & IN_ISDIR) && (mask & (IN_CREATE | IN_MOVED_TO)))
+            watchNewDirectory(watch, path);
+
+        // create and moved_to can be watched for subdirectories only
+        const Event e = _EventHandler.getInotify(mask);
+        if (!intersects(watch.events, e))
+            continue;
+
+        if (!isIgnoredOnce(path)) {
+            _Queue.push(std::make_shared<FileSystemEvent>(path, e, event->cookie));
+        }
+    }
+}
+
 std::uint32_t
 Inotify::getEventMask(const Event event) const
 {
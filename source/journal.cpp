@@ -0,0 +1,498 @@
+#include <notify-cpp/journal.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace notifycpp {
+
+namespace {
+    const char JournalMagic[8] = { 'N', 'C', 'P', 'P', 'J', 'R', 'N', 'L' };
+    const std::uint32_t JournalVersion = 1;
+    const std::uint32_t MaxRestarts = sizeof(journal::SegmentHeader::restarts) / sizeof(journal::RestartPoint);
+    const char* const SegmentExtension = ".journal";
+
+    std::runtime_error journalError(const std::string& what, const std::filesystem::path& file)
+    {
+        std::stringstream errorStream;
+        errorStream << what << " " << strerror(errno) << ". Path: " << file;
+        return std::runtime_error(errorStream.str());
+    }
+
+    void putVarint(std::string& out, std::uint64_t value)
+    {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    bool getVarint(const char*& current, const char* end, std::uint64_t& value)
+    {
+        value = 0;
+        for (unsigned shift = 0; current < end && shift < 64; shift += 7) {
+            const auto byte = static_cast<std::uint8_t>(*current++);
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    std::uint64_t zigzag(std::int64_t value)
+    {
+        return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+    }
+
+    std::int64_t unzigzag(std::uint64_t value)
+    {
+        return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+    }
+
+    std::uint64_t firstSequence(const std::filesystem::path& segment)
+    {
+        return std::stoull(segment.stem().string());
+    }
+}
+
+/**
+ * @return segment files of the journal ordered by their first sequence
+ */
+std::vector<std::filesystem::path> journal::segments(const std::filesystem::path& directory)
+{
+    std::vector<std::filesystem::path> result;
+    std::error_code error;
+    for (auto it = std::filesystem::directory_iterator(directory, error);
+         !error && it != std::filesystem::directory_iterator(); it.increment(error)) {
+        const auto& path = it->path();
+        const auto stem = path.stem().string();
+        if (path.extension() == SegmentExtension && !stem.empty()
+            && std::all_of(std::begin(stem), std::end(stem), [](char c) { return c >= '0' && c <= '9'; }))
+            result.push_back(path);
+    }
+    // names have a fixed width
+    std::sort(std::begin(result), std::end(result));
+    return result;
+}
+
+JournalWriter::JournalWriter(const std::filesystem::path& directory, std::size_t segmentSize)
+    : _Directory(directory)
+    , _SegmentSize(segmentSize)
+    , _RestartInterval((segmentSize - sizeof(journal::SegmentHeader)) / MaxRestarts)
+    , _Fd(-1)
+    , _Data(nullptr)
+    , _Header(nullptr)
+    , _Offset(0)
+    , _NextRestart(0)
+    , _Timestamp(0)
+{
+    if (segmentSize < (1 << 16))
+        throw std::invalid_argument("Journal segments have to be at least 64 KiB");
+
+    std::filesystem::create_directories(directory);
+    JournalReader reader(directory);
+    _Sequence = reader.repair();
+}
+
+JournalWriter::~JournalWriter()
+{
+    close();
+}
+
+/**
+ * @brief Starts a new segment named by the next sequence number.
+ */
+void JournalWriter::open()
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020llu", static_cast<unsigned long long>(_Sequence + 1));
+    const auto file = _Directory / (std::string(name) + SegmentExtension);
+
+    _Fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (_Fd == -1)
+        throw journalError("Can't create journal segment!", file);
+
+    if (ftruncate(_Fd, static_cast<off_t>(_SegmentSize)) == -1) {
+        const auto error = journalError("Can't create journal segment!", file);
+        ::close(_Fd);
+        _Fd = -1;
+        throw error;
+    }
+
+    void* data = mmap(nullptr, _SegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, _Fd, 0);
+    if (data == MAP_FAILED) {
+        const auto error = journalError("Can't map journal segment!", file);
+        ::close(_Fd);
+        _Fd = -1;
+        throw error;
+    }
+
+    _Data = static_cast<char*>(data);
+    _Header = reinterpret_cast<journal::SegmentHeader*>(_Data);
+    std::memcpy(_Header->magic, JournalMagic, sizeof(JournalMagic));
+    _Header->version = JournalVersion;
+    _Header->restartCount = 0;
+    _Header->firstSequence = _Sequence + 1;
+    _Offset = sizeof(journal::SegmentHeader);
+    _NextRestart = _Offset;
+    __atomic_store_n(&_Header->used, _Offset, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Unmaps the segment and cuts the file to the bytes used.
+ */
+void JournalWriter::close()
+{
+    if (!_Data)
+        return;
+
+    munmap(_Data, _SegmentSize);
+    if (ftruncate(_Fd, static_cast<off_t>(_Offset)) == 0)
+        fsync(_Fd);
+    ::close(_Fd);
+    _Data = nullptr;
+    _Header = nullptr;
+    _Fd = -1;
+}
+
+void JournalWriter::encode(Event event, std::string_view path, std::uint32_t pid, std::int64_t timestamp, bool restart)
+{
+    const std::uint64_t previousSequence = restart ? 0 : _Sequence;
+    const std::int64_t previousTimestamp = restart ? 0 : _Timestamp;
+    const std::string_view previousPath = restart ? std::string_view() : std::string_view(_Path);
+
+    const auto shared = static_cast<std::size_t>(std::mismatch(std::begin(path), std::end(path),
+                                                      std::begin(previousPath), std::end(previousPath))
+                                                      .first
+        - std::begin(path));
+
+    _Record.clear();
+    putVarint(_Record, _Sequence + 1 - previousSequence);
+    putVarint(_Record, zigzag(timestamp - previousTimestamp));
+    putVarint(_Record, static_cast<std::uint32_t>(event));
+    putVarint(_Record, pid);
+    putVarint(_Record, shared);
+    putVarint(_Record, path.size() - shared);
+    _Record.append(path.substr(shared));
+}
+
+/**
+ * @brief Appends a record, the sequence number is the one after the
+ *        last record of the journal.
+ *
+ * @return sequence number of the record
+ */
+std::uint64_t JournalWriter::append(Event event, std::string_view path, std::uint32_t pid, std::int64_t timestamp)
+{
+    bool restart = !_Data || (_Offset >= _NextRestart && _Header->restartCount < MaxRestarts);
+    encode(event, path, pid, timestamp, restart);
+
+    if (!_Data || _Offset + _Record.size() > _SegmentSize) {
+        close();
+        open();
+        if (!restart)
+            encode(event, path, pid, timestamp, true);
+        restart = true;
+    }
+
+    const std::uint64_t sequence = ++_Sequence;
+    std::memcpy(_Data + _Offset, _Record.data(), _Record.size());
+    if (restart) {
+        _Header->restarts[_Header->restartCount] = { sequence, _Offset };
+        ++_Header->restartCount;
+        _NextRestart = _Offset + _RestartInterval;
+    }
+    _Offset += _Record.size();
+    __atomic_store_n(&_Header->used, _Offset, __ATOMIC_RELEASE);
+
+    _Timestamp = timestamp;
+    _Path.assign(path);
+    return sequence;
+}
+
+std::uint64_t JournalWriter::append(const FileSystemEvent& fse, std::int64_t timestamp)
+{
+    return append(fse.getEvent(), fse.getPath().native(), fse.getPid(), timestamp);
+}
+
+/**
+ * @brief Writes the records appended so far to disk.
+ */
+void JournalWriter::sync()
+{
+    if (_Data && msync(_Data, _Offset, MS_SYNC) == -1)
+        throw journalError("Can't sync journal segment!", _Directory);
+}
+
+std::uint64_t JournalWriter::lastSequence() const
+{
+    return _Sequence;
+}
+
+JournalReader::JournalReader(const std::filesystem::path& directory)
+    : _Segments(journal::segments(directory))
+    , _Segment(0)
+    , _Data(nullptr)
+    , _Length(0)
+    , _Used(0)
+    , _Offset(0)
+    , _Restart(0)
+    , _Previous { 0, 0, Event::none, {}, 0 }
+    , _HasPeeked(false)
+{
+}
+
+JournalReader::~JournalReader()
+{
+    unmap();
+}
+
+void JournalReader::unmap()
+{
+    if (_Data)
+        munmap(_Data, _Length);
+    _Data = nullptr;
+}
+
+bool JournalReader::map(std::size_t segment)
+{
+    unmap();
+    if (segment >= _Segments.size())
+        return false;
+
+    const int fd = ::open(_Segments[segment].c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        throw journalError("Can't open journal segment!", _Segments[segment]);
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || static_cast<std::size_t>(st.st_size) < sizeof(journal::SegmentHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    _Length = static_cast<std::size_t>(st.st_size);
+    void* data = mmap(nullptr, _Length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        throw journalError("Can't map journal segment!", _Segments[segment]);
+
+    const auto* header = static_cast<const journal::SegmentHeader*>(data);
+    if (std::memcmp(header->magic, JournalMagic, sizeof(JournalMagic)) != 0 || header->version != JournalVersion) {
+        munmap(data, _Length);
+        throw std::runtime_error("Invalid journal segment! Path: " + _Segments[segment].string());
+    }
+
+    _Data = data;
+    _Segment = segment;
+    _Used = std::min<std::uint64_t>(__atomic_load_n(&header->used, __ATOMIC_ACQUIRE), _Length);
+    _Offset = sizeof(journal::SegmentHeader);
+    _Restart = 0;
+    return true;
+}
+
+bool JournalReader::decode(JournalRecord& record)
+{
+    const auto* header = static_cast<const journal::SegmentHeader*>(_Data);
+    if (_Offset >= _Used)
+        _Used = std::min<std::uint64_t>(__atomic_load_n(&header->used, __ATOMIC_ACQUIRE), _Length);
+    if (_Offset >= _Used)
+        return false;
+
+    if (_Restart < header->restartCount && header->restarts[_Restart].offset == _Offset) {
+        _Previous = { 0, 0, Event::none, {}, 0 };
+        ++_Restart;
+    }
+
+    const char* current = static_cast<const char*>(_Data) + _Offset;
+    const char* end = static_cast<const char*>(_Data) + _Used;
+    std::uint64_t sequence, timestamp, mask, pid, shared, suffix;
+    if (!getVarint(current, end, sequence) || !getVarint(current, end, timestamp) || !getVarint(current, end, mask)
+        || !getVarint(current, end, pid) || !getVarint(current, end, shared) || !getVarint(current, end, suffix)
+        || sequence == 0 || shared > _Previous.path.size() || suffix > static_cast<std::uint64_t>(end - current))
+        throw std::runtime_error("Corrupt journal segment! Path: " + _Segments[_Segment].string());
+
+    record.sequence = _Previous.sequence + sequence;
+    record.timestamp = _Previous.timestamp + unzigzag(timestamp);
+    record.event = static_cast<Event>(mask);
+    record.pid = static_cast<std::uint32_t>(pid);
+    record.path.assign(_Previous.path, 0, shared);
+    record.path.append(current, suffix);
+
+    _Offset = static_cast<std::uint64_t>(current + suffix - static_cast<const char*>(_Data));
+    _Previous = record;
+    return true;
+}
+
+/**
+ * @brief Reads the next record, records appended after the end was
+ *        reached are returned by later calls.
+ *
+ * @return false if there is no further record
+ */
+bool JournalReader::next(JournalRecord& record)
+{
+    if (_HasPeeked) {
+        record = std::move(_Peeked);
+        _HasPeeked = false;
+        return true;
+    }
+
+    if (!_Data && !map(_Segment))
+        return false;
+
+    while (!decode(record)) {
+        if (_Segment + 1 >= _Segments.size()) {
+            // the writer may have started a new segment
+            const auto directory = _Segments[_Segment].parent_path();
+            const auto segments = journal::segments(directory);
+            if (segments.size() <= _Segments.size())
+                return false;
+            _Segments = segments;
+        }
+        if (!map(_Segment + 1))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Positions the reader at the first record with a sequence
+ *        number not less than the given one.
+ *
+ * @return false if there is no such record
+ */
+bool JournalReader::seek(std::uint64_t sequence)
+{
+    _HasPeeked = false;
+    if (_Segments.empty())
+        return false;
+
+    auto segment = std::upper_bound(std::begin(_Segments), std::end(_Segments), sequence,
+        [](std::uint64_t s, const std::filesystem::path& path) { return s < firstSequence(path); });
+    if (segment != std::begin(_Segments))
+        --segment;
+    if (!map(static_cast<std::size_t>(segment - std::begin(_Segments))))
+        return false;
+
+    const auto* header = static_cast<const journal::SegmentHeader*>(_Data);
+    const auto* restarts = header->restarts;
+    const auto count = std::min(header->restartCount, MaxRestarts);
+    const auto restart = std::upper_bound(restarts, restarts + count, sequence,
+        [](std::uint64_t s, const journal::RestartPoint& point) { return s < point.sequence; });
+    if (restart != restarts) {
+        _Restart = static_cast<std::size_t>(restart - restarts) - 1;
+        _Offset = restarts[_Restart].offset;
+    }
+
+    while (next(_Peeked)) {
+        if (_Peeked.sequence >= sequence) {
+            _HasPeeked = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @return sequence number of the last record, 0 for an empty journal
+ */
+std::uint64_t JournalReader::lastSequence()
+{
+    _HasPeeked = false;
+    for (auto segment = _Segments.size(); segment > 0; --segment) {
+        if (!map(segment - 1))
+            continue;
+
+        const auto* header = static_cast<const journal::SegmentHeader*>(_Data);
+        const auto count = std::min(header->restartCount, MaxRestarts);
+        if (count == 0)
+            continue;
+        _Restart = count - 1;
+        _Offset = header->restarts[_Restart].offset;
+
+        JournalRecord record;
+        std::uint64_t last = 0;
+        while (decode(record))
+            last = record.sequence;
+        return last;
+    }
+    return 0;
+}
+
+/**
+ * @brief Cuts the last segment after its last complete record, removes
+ *        it if it has none or its header is invalid and repairs the one
+ *        before. A crash can leave it like this.
+ *
+ * @return sequence number of the last record, 0 for an empty journal
+ */
+std::uint64_t JournalReader::repair()
+{
+    if (_Segments.empty())
+        return 0;
+
+    const auto last = _Segments.back();
+    std::uint64_t sequence = 0;
+    std::uint64_t end = sizeof(journal::SegmentHeader);
+    bool torn = false;
+    try {
+        if (map(_Segments.size() - 1)) {
+            // from the start, the restart points may be torn as well
+            JournalRecord record;
+            try {
+                while (decode(record)) {
+                    sequence = record.sequence;
+                    end = _Offset;
+                }
+            } catch (const std::runtime_error&) {
+                torn = true;
+            }
+            torn = torn || _Used != end;
+        }
+    } catch (const std::runtime_error&) {
+        // a header which was not written completely
+    }
+    unmap();
+
+    if (sequence == 0) {
+        if (::unlink(last.c_str()) == -1 && errno != ENOENT)
+            throw journalError("Can't remove torn journal segment!", last);
+        _Segments.pop_back();
+        return repair();
+    }
+    if (!torn)
+        return sequence;
+
+    const int fd = ::open(last.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd == -1)
+        throw journalError("Can't repair journal segment!", last);
+
+    journal::SegmentHeader header;
+    bool repaired = pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header));
+    if (repaired) {
+        header.restartCount = std::min(header.restartCount, MaxRestarts);
+        while (header.restartCount > 0 && header.restarts[header.restartCount - 1].offset >= end)
+            --header.restartCount;
+        header.used = end;
+        repaired = pwrite(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header))
+            && ftruncate(fd, static_cast<off_t>(end)) == 0 && fsync(fd) == 0;
+    }
+    if (!repaired) {
+        const auto error = journalError("Can't repair journal segment!", last);
+        ::close(fd);
+        throw error;
+    }
+    ::close(fd);
+    return sequence;
+}
+}
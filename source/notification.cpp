@@ -25,9 +25,10 @@
 
 namespace notifycpp {
 
-Notification::Notification(Event event, const std::string& path)
+Notification::Notification(Event event, const std::string& path, std::uint64_t sequence)
     : _Event(event)
     , _Path(path)
+    , _Sequence(sequence)
 {
 }
 
@@ -40,4 +41,9 @@ Event Notification::getEvent() const
 {
     return _Event;
 }
+
+std::uint64_t Notification::getSequence() const
+{
+    return _Sequence;
+}
 }
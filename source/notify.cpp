@@ -37,6 +37,7 @@
 #include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -45,19 +46,80 @@ namespace notifycpp {
 Notify::Notify()
     : _Stopped(false)
     , mThreadSleep(250)
+    , _ReadTimeout(0)
 {
 }
 
+/**
+ * @brief Limits the time getNextEvent waits for an event. If no event
+ *        arrived in time getNextEvent returns a nullptr.
+ *
+ * @param timeout 0 waits until an event arrives or Notify is stopped
+ */
+void Notify::setReadTimeout(std::chrono::milliseconds timeout)
+{
+    _ReadTimeout = timeout.count();
+}
+
+std::chrono::steady_clock::time_point Notify::readDeadline() const
+{
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(_ReadTimeout);
+}
+
+bool Notify::isTimedOut(const std::chrono::steady_clock::time_point& deadline) const
+{
+    return _ReadTimeout != 0 && std::chrono::steady_clock::now() >= deadline;
+}
+
+/**
+ * @return timeout for poll(2) in milliseconds, the stop flag is
+ *         checked at least every mThreadSleep milliseconds
+ */
+int Notify::pollTimeout(const std::chrono::steady_clock::time_point& deadline) const
+{
+    if (_ReadTimeout == 0)
+        return static_cast<int>(mThreadSleep);
+
+    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now())
+                               .count();
+    return static_cast<int>(std::clamp<std::int64_t>(remaining + 1, 0, mThreadSleep));
+}
+
 void Notify::ignore(const std::filesystem::path& p)
 {
+    std::lock_guard<std::mutex> lock(_IgnoredMutex);
     _Ignored.push_back(p);
 }
 
 void Notify::ignoreOnce(const std::filesystem::path& p)
 {
+    std::lock_guard<std::mutex> lock(_IgnoredMutex);
     _IgnoredOnce.push_back(p);
 }
 
+/**
+ * @brief Limits the number of decoded events waiting for getNextEvent.
+ *        Has to be called before the event loop is started.
+ *
+ * @param capacity max. number of queued events, 0 for unbounded
+ * @param policy applied when the queue is full
+ */
+void Notify::setQueueLimit(std::size_t capacity, OverflowPolicy policy)
+{
+    _Queue.setLimit(capacity, policy);
+}
+
+QueueStatistics Notify::getQueueStatistics() const
+{
+    return _Queue.getStatistics();
+}
+
+WatchStatistics Notify::getWatchStatistics() const
+{
+    return {};
+}
+
 void Notify::stop()
 {
     _Stopped = true;
@@ -70,6 +132,7 @@ bool Notify::hasStopped()
 
 bool Notify::isIgnoredOnce(const std::filesystem::path& p) const
 {
+    std::lock_guard<std::mutex> lock(_IgnoredMutex);
     auto found = std::find(std::begin(_IgnoredOnce), std::end(_IgnoredOnce), p);
     if (found != std::end(_IgnoredOnce)) {
         _IgnoredOnce.erase(found);
@@ -80,6 +143,7 @@ bool Notify::isIgnoredOnce(const std::filesystem::path& p) const
 
 bool Notify::isIgnored(const std::filesystem::path& p) const
 {
+    std::lock_guard<std::mutex> lock(_IgnoredMutex);
     return std::any_of(std::begin(_Ignored), std::end(_Ignored),
         [&p](const std::filesystem::path& ip) { return p == ip; });
 }
@@ -128,6 +192,8 @@ void Notify::watchPathRecursively(const FileSystemEvent& fse)
         return;
 
     for(auto& p: std::filesystem::recursive_directory_iterator(fse.getPath())) {
+        if (!p.is_regular_file())
+            continue;
         const FileSystemEvent tmp_fse(p);
         if (checkWatchFile(tmp_fse)) {
             watchFile(tmp_fse);
@@ -135,6 +201,28 @@ void Notify::watchPathRecursively(const FileSystemEvent& fse)
     }
 }
 
+/**
+ * @brief Watches the directory recursively with critical priority.
+ *        Backends without a kernel queue of their own for critical
+ *        watches can't keep its events apart and reject it.
+ */
+void Notify::watchCriticalPath(const FileSystemEvent& fse)
+{
+    std::stringstream errorStream;
+    errorStream << "Critical watches need a backend with a queue of their own, e.g. InotifyController. Path: "
+                << fse.getPath();
+    throw std::invalid_argument(errorStream.str());
+}
+
+/**
+ * @brief Watches the file by its path. Backends which can't watch a
+ *        name for a new file watch the current file only.
+ */
+void Notify::followPath(const FileSystemEvent& fse)
+{
+    watchFile(fse);
+}
+
 /**
  * @return true if Notify has stopped, otherwise false
  */
@@ -24,9 +24,38 @@
 #include <notify-cpp/fanotify.h>
 #include <notify-cpp/inotify.h>
 #include <notify-cpp/notify_controller.h>
+#include <notify-cpp/snapshot.h>
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
 
 namespace notifycpp {
 
+namespace {
+    //! sequence numbers reserved by one write of the clock mark
+    const std::uint64_t ClockReservation = 1 << 16;
+
+    /**
+     * @brief Destroys the pools whose last reference was dropped by one
+     *        of their own workers, which can't join itself. Never
+     *        destroyed, its thread ends with the process.
+     */
+    ThreadPool& reaper()
+    {
+        static ThreadPool* pool = new ThreadPool(1);
+        return *pool;
+    }
+}
+
+NotifyController::Pools::~Pools()
+{
+    for (const auto& weak : pools)
+        if (auto pool = weak.lock())
+            pool->join();
+}
+
 FanotifyController::FanotifyController()
     : NotifyController(new Fanotify)
 {
@@ -43,22 +72,160 @@ InotifyController::InotifyController()
 {
 }
 
+/**
+ * @brief Watches the entries of the directory, not its subdirectories
+ */
+NotifyController& InotifyController::watchDirectory(const FileSystemEvent& fse)
+{
+    checkWatch(fse.getEvent());
+    static_cast<Inotify*>(_Notify)->watchDirectory(fse);
+    return *this;
+}
+
+NotifyController& InotifyController::record(const std::filesystem::path& recording)
+{
+    static_cast<Inotify*>(_Notify)->record(recording);
+    return *this;
+}
+
+ShardedController::ShardedController(std::size_t shards, bool pinThreads)
+    : NotifyController(new ShardedNotify(shards, pinThreads))
+{
+}
+
+SharedRingController::SharedRingController(const std::filesystem::path& ring)
+    : NotifyController(new SharedRingNotify(ring))
+{
+}
+
+RemoteController::RemoteController(const std::filesystem::path& socket)
+    : NotifyController(new RemoteNotify(socket))
+{
+}
+
+ReplayController::ReplayController(const std::filesystem::path& recording, ReplaySpeed speed)
+    : NotifyController(new ReplayNotify(recording, speed))
+{
+}
+
 NotifyController::NotifyController(Notify* n)
     : _Notify(n)
+    , mObservers(std::make_shared<const Observers>())
+    , mObserversVersion(1)
+    , mCachedVersion(0)
+    , mPools(std::make_shared<Pools>())
+    , mDroppedNotifications(std::make_shared<std::atomic<std::size_t>>(0))
+    , mFailedNotifications(std::make_shared<std::atomic<std::size_t>>(0))
+    , mWatchedEvents(std::make_shared<std::atomic<Event>>(Event::all))
+    , mSynthetic(std::make_shared<std::deque<TFileSystemEventPtr>>())
+    , mClock(std::make_shared<std::atomic<std::uint64_t>>(0))
+{
+}
+
+NotifyController::NotifyController()
+    : NotifyController(nullptr)
+{
+}
+
+NotifyController::NotifyController(const NotifyController& other)
+    : _Notify(other._Notify)
+    , mObservers(std::atomic_load(&other.mObservers))
+    , mObserversVersion(1)
+    , mCachedVersion(0)
+    , mThreadPool(std::atomic_load(&other.mThreadPool))
+    , mPools(other.mPools)
+    , mDroppedNotifications(other.mDroppedNotifications)
+    , mFailedNotifications(other.mFailedNotifications)
+    , mCoalescer(other.mCoalescer)
+    , mSettle(other.mSettle)
+    , mRenames(other.mRenames)
+    , mWriteFilter(other.mWriteFilter)
+    , mTreeModel(other.mTreeModel)
+    , mPersist(other.mPersist)
+    , mJournal(other.mJournal)
+    , mPublisher(other.mPublisher)
+    , mStatCache(other.mStatCache)
+    , mWatchedEvents(other.mWatchedEvents)
+    , mHashCache(other.mHashCache)
+    , mSynthetic(other.mSynthetic)
+    , mClock(other.mClock)
+    , mClockMark(other.mClockMark)
+    , mChangeIndex(other.mChangeIndex)
+    , mHistory(other.mHistory)
+{
+}
+
+NotifyController& NotifyController::operator=(const NotifyController& other)
+{
+    if (this != &other) {
+        _Notify = other._Notify;
+        std::atomic_store(&mObservers, std::atomic_load(&other.mObservers));
+        mObserversVersion.fetch_add(1, std::memory_order_release);
+        std::atomic_store(&mThreadPool, std::atomic_load(&other.mThreadPool));
+        mPools = other.mPools;
+        mDroppedNotifications = other.mDroppedNotifications;
+        mFailedNotifications = other.mFailedNotifications;
+        mCoalescer = other.mCoalescer;
+        mSettle = other.mSettle;
+        mRenames = other.mRenames;
+        mWriteFilter = other.mWriteFilter;
+        mTreeModel = other.mTreeModel;
+        mPersist = other.mPersist;
+        mJournal = other.mJournal;
+        mPublisher = other.mPublisher;
+        mStatCache = other.mStatCache;
+        mWatchedEvents = other.mWatchedEvents;
+        mHashCache = other.mHashCache;
+        mSynthetic = other.mSynthetic;
+        mClock = other.mClock;
+        mClockMark = other.mClockMark;
+        mChangeIndex = other.mChangeIndex;
+        mHistory = other.mHistory;
+    }
+    return *this;
+}
+
+/**
+ * @brief The last copy finishes the queued notifications before the
+ *        observers and what they captured are gone
+ */
+NotifyController::~NotifyController()
 {
 }
 
 NotifyController&
 NotifyController::watchFile(const FileSystemEvent& fse)
 {
+    checkWatch(fse.getEvent());
     _Notify->watchFile(fse);
     return *this;
 }
 
+/**
+ * @brief Watches the directory and all subdirectories. Events of
+ *        critical watches bypass rename pairing, coalescing and change
+ *        sets and are dispatched as soon as they are read.
+ */
 NotifyController&
-NotifyController::watchPathRecursively(const FileSystemEvent& fse)
+NotifyController::watchPathRecursively(const FileSystemEvent& fse, Priority priority)
 {
-    _Notify->watchPathRecursively(fse);
+    checkWatch(fse.getEvent());
+    if (priority == Priority::critical)
+        _Notify->watchCriticalPath(fse);
+    else
+        _Notify->watchPathRecursively(fse);
+    return *this;
+}
+
+/**
+ * @brief Watches the file by its path, a replaced event is dispatched
+ *        when the path refers to a new file after log rotation or an
+ *        atomic replace.
+ */
+NotifyController& NotifyController::followPath(const FileSystemEvent& fse)
+{
+    checkWatch(fse.getEvent());
+    _Notify->followPath(fse);
     return *this;
 }
 
@@ -79,47 +246,758 @@ NotifyController& NotifyController::ignoreOnce(const std::filesystem::path& p)
     return *this;
 }
 
-NotifyController& NotifyController::onEvent(Event event, EventObserver eventObserver)
+NotifyController& NotifyController::setQueueLimit(std::size_t capacity, OverflowPolicy policy)
 {
-    mEventObserver[event] = eventObserver;
+    _Notify->setQueueLimit(capacity, policy);
     return *this;
 }
 
-NotifyController& NotifyController::onEvents(std::set<Event> events, EventObserver eventObserver)
+QueueStatistics NotifyController::getQueueStatistics() const
+{
+    return _Notify->getQueueStatistics();
+}
+
+WatchStatistics NotifyController::getWatchStatistics() const
 {
-    for (auto event : events)
-        mEventObserver[event] = eventObserver;
+    return _Notify->getWatchStatistics();
+}
+
+/**
+ * @brief Merges events for the same path within the window before they
+ *        are passed to the observers. Has to be set before the event
+ *        loop is started.
+ *
+ * @param window time events of a path are merged, 0 disables merging
+ * @param mode whether the first event is passed on immediately
+ */
+NotifyController& NotifyController::coalesce(std::chrono::milliseconds window, CoalesceMode mode)
+{
+    if (window.count() == 0)
+        mCoalescer.reset();
+    else
+        mCoalescer = std::make_shared<EventCoalescer>(window, mode);
+    return *this;
+}
+
+/**
+ * @brief Drops close_write and moved_to events of files whose content
+ *        did not change since their previous event. The files are read
+ *        by the thread running the event loop. Has to be set before the
+ *        event loop is started.
+ *
+ * @param capacity number of files whose fingerprint is kept
+ */
+NotifyController& NotifyController::suppressUnchangedWrites(std::size_t capacity)
+{
+    mWriteFilter = std::make_shared<WriteFilter>(capacity);
+    return *this;
+}
+
+/**
+ * @brief Accumulates all events until no event arrived for the quiet
+ *        period and passes their net effect to the observer. The
+ *        other observers are notified as before. Has to be set before
+ *        the event loop is started.
+ *
+ * @param quietPeriod time without events after which the change set is passed on
+ * @param observer receives the change set, it is not called for an empty set
+ */
+NotifyController& NotifyController::onChangeSet(std::chrono::milliseconds quietPeriod, ChangeSetObserver observer)
+{
+    mSettle = std::make_shared<Settle>();
+    mSettle->quietPeriod = quietPeriod;
+    mSettle->observer = observer;
+    return *this;
+}
+
+/**
+ * @brief Keeps the model up to date with the events read, before they
+ *        are passed to any observer. The model is scanned here, so the
+ *        tree should be watched before. Has to be set before the event
+ *        loop is started.
+ *
+ * @param snapshot if it exists the model is loaded from it instead of
+ *        scanned, changes made since it was saved are dispatched as
+ *        events when the event loop starts
+ */
+NotifyController& NotifyController::attachTreeModel(std::shared_ptr<TreeModel> model, const std::filesystem::path& snapshot)
+{
+    mTreeModel = model;
+    if (snapshot.empty() || !restore(snapshot))
+        model->scan();
+    return *this;
+}
+
+/**
+ * @brief Loads the model from the snapshot and queues the differences
+ *        to the file system.
+ *
+ * @return false if there is no usable snapshot
+ */
+bool NotifyController::restore(const std::filesystem::path& snapshot)
+{
+    std::error_code error;
+    if (!std::filesystem::exists(snapshot, error))
+        return false;
+
+    std::vector<FileSystemEvent> changes;
+    try {
+        Snapshot loaded(snapshot);
+        if (loaded.root() != mTreeModel->root())
+            return false;
+        mTreeModel->load(loaded);
+        changes = loaded.diff();
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+
+    // a created directory is read with everything below it
+    std::filesystem::path created;
+    for (const auto& change : changes) {
+        const auto& path = change.getPath();
+        const bool below = !created.empty() && std::mismatch(created.begin(), created.end(), path.begin(), path.end()).first == created.end();
+        if (!(below && change.getEvent() == Event::create))
+            mTreeModel->apply(change);
+        if (change.getEvent() == Event::create && !below)
+            created = path;
+        mSynthetic->push_back(std::make_shared<FileSystemEvent>(change));
+    }
+    return true;
+}
+
+/**
+ * @brief Saves the attached model to the snapshot whenever it changed
+ *        and the interval has passed, and when the event loop ends.
+ */
+NotifyController& NotifyController::persistTreeModel(const std::filesystem::path& snapshot, std::chrono::seconds interval)
+{
+    if (!mTreeModel)
+        throw std::runtime_error("No tree model attached, call attachTreeModel() first");
+
+    mPersist = std::make_shared<Persist>(Persist { snapshot, interval,
+        std::chrono::steady_clock::now() + interval, std::numeric_limits<std::uint64_t>::max(),
+        std::numeric_limits<std::uint64_t>::max() });
+    return *this;
+}
+
+void NotifyController::persist(bool force)
+{
+    const auto clock = getClock();
+    const auto hashes = mHashCache ? mHashCache->generation() : 0;
+    if (clock == mPersist->savedClock && hashes == mPersist->savedHashes)
+        return;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (!force && now < mPersist->nextSave)
+        return;
+
+    if (mHashCache)
+        Snapshot::save(*mTreeModel, mPersist->snapshot, mHashCache->records());
+    else
+        Snapshot::save(*mTreeModel, mPersist->snapshot);
+    mPersist->savedClock = clock;
+    mPersist->savedHashes = hashes;
+    mPersist->nextSave = now + mPersist->interval;
+}
+
+/**
+ * @brief Appends every event read to the journal. Appended records are
+ *        synced at most once per interval and when the event loop ends.
+ *        Has to be set before the event loop is started.
+ *
+ * The clock continues at the last sequence of the journal, so sequence
+ * numbers of the events match their records and survive a restart.
+ */
+NotifyController& NotifyController::writeJournal(std::shared_ptr<JournalWriter> writer,
+    std::chrono::milliseconds syncInterval)
+{
+    const auto clock = std::max(getClock(), writer->lastSequence());
+    mClock->store(clock, std::memory_order_release);
+    if (mHistory)
+        mHistory = std::make_shared<EventHistory>(mHistory->capacity(), clock);
+    mJournal = std::make_shared<Journal>(Journal { std::move(writer), syncInterval,
+        std::chrono::steady_clock::now() + syncInterval, false });
+    return *this;
+}
+
+/**
+ * @brief Keeps a high-water mark of the clock in the file, so sequence
+ *        numbers survive a restart without a journal. The clock
+ *        continues above the mark, which is written ahead of the
+ *        sequence numbers handed out. Has to be set before the event
+ *        loop is started.
+ */
+NotifyController& NotifyController::persistClock(const std::filesystem::path& file)
+{
+    auto mark = std::make_shared<ClockMark>(ClockMark { std::make_unique<Cursor>(file, std::chrono::milliseconds(0)), 0 });
+    const auto clock = std::max(getClock(), mark->file->position());
+    mClock->store(clock, std::memory_order_release);
+    if (mHistory)
+        mHistory = std::make_shared<EventHistory>(mHistory->capacity(), clock);
+    mark->reserved = clock;
+    mClockMark = std::move(mark);
+    return *this;
+}
+
+void NotifyController::syncJournal(bool force)
+{
+    if (!mJournal->dirty)
+        return;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (!force && now < mJournal->nextSync)
+        return;
+
+    mJournal->writer->sync();
+    mJournal->dirty = false;
+    mJournal->nextSync = now + mJournal->syncInterval;
+}
+
+/**
+ * @brief Writes every event read into the shared ring, so processes
+ *        on the same host can read them with a SharedRingNotify.
+ */
+NotifyController& NotifyController::publish(std::shared_ptr<SharedRingPublisher> publisher)
+{
+    mPublisher = std::move(publisher);
+    return *this;
+}
+
+/**
+ * @brief Invalidates the cache with every event read, before the event
+ *        is dispatched. Has to be set before the event loop is started.
+ *        Every watch has to ask for StatCache::invalidatingEvents(),
+ *        a watch without them is rejected.
+ */
+NotifyController& NotifyController::attachStatCache(std::shared_ptr<StatCache> cache)
+{
+    const auto required = StatCache::invalidatingEvents();
+    if ((mWatchedEvents->load() & required) != required)
+        throw std::runtime_error("A watch misses the events invalidating the stat cache, see StatCache::invalidatingEvents()");
+    mStatCache = std::move(cache);
+    return *this;
+}
+
+/**
+ * @brief Invalidates the cache with every event read. The digests are
+ *        saved with the snapshot of persistTreeModel().
+ *
+ * @param snapshot if it exists the digests saved with it are loaded
+ */
+NotifyController& NotifyController::attachContentHashCache(std::shared_ptr<ContentHashCache> cache,
+    const std::filesystem::path& snapshot)
+{
+    std::error_code error;
+    if (!snapshot.empty() && std::filesystem::exists(snapshot, error)) {
+        try {
+            cache->load(Snapshot(snapshot));
+        } catch (const std::runtime_error&) {
+            // hashed again when asked for
+        }
+    }
+    mHashCache = std::move(cache);
+    return *this;
+}
+
+/**
+ * @brief Records the last change of every path, so changedSince() can
+ *        be asked. Has to be set before the event loop is started.
+ */
+NotifyController& NotifyController::trackChanges()
+{
+    if (!mChangeIndex)
+        mChangeIndex = std::make_shared<ChangeIndex>();
+    return *this;
+}
+
+/**
+ * @brief Logical clock, advanced by one for every event read. Changes
+ *        up to the returned value are recorded. Starts at the last
+ *        sequence of the journal, see writeJournal(), above the mark of
+ *        persistClock(), or at 0. Positions of durable cursors need one
+ *        of them to stay valid across restarts.
+ */
+std::uint64_t NotifyController::getClock() const
+{
+    return mClock->load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Paths below root changed after the clock, oldest change
+ *        first. Takes time proportional to the number of changes
+ *        since then.
+ *
+ * @param clock value returned by getClock() when the caller last looked
+ * @param root only paths below, all paths if empty
+ */
+std::vector<ChangedPath> NotifyController::changedSince(std::uint64_t clock, const std::filesystem::path& root) const
+{
+    if (!mChangeIndex)
+        throw std::runtime_error("Changes are not tracked, call trackChanges() first");
+    return mChangeIndex->changedSince(clock, root);
+}
+
+/**
+ * @brief Keeps the last events read, so a subscriber can catch up with
+ *        replaySince(). Has to be set before the event loop is started.
+ *
+ * @param capacity number of events kept
+ */
+NotifyController& NotifyController::keepHistory(std::size_t capacity)
+{
+    mHistory = std::make_shared<EventHistory>(capacity, getClock());
+    return *this;
+}
+
+/**
+ * @brief Passes the events read after the sequence to the observer,
+ *        e.g. the position of a Cursor of a restarted subscriber.
+ *
+ * @return false if some of the events are not kept anymore, or the
+ *         sequence is from an earlier process or newer than the clock.
+ *         The subscriber has to rescan, e.g. with a snapshot diff, and
+ *         continue at getClock(), see Cursor::reset(). Sequences of an
+ *         earlier process are only recognized with writeJournal() or
+ *         persistClock().
+ */
+bool NotifyController::replaySince(std::uint64_t sequence, EventObserver observer) const
+{
+    if (!mHistory)
+        throw std::runtime_error("No history kept, call keepHistory() first");
+
+    std::vector<HistoryEntry> entries;
+    const bool complete = mHistory->since(sequence, entries);
+    for (const auto& entry : entries)
+        observer({ entry.event, entry.path, entry.sequence });
+    return complete;
+}
+
+/**
+ * @brief Advances the clock, after the change has been recorded.
+ */
+void NotifyController::tick(FileSystemEvent& fileSystemEvent)
+{
+    const auto clock = mClock->load(std::memory_order_relaxed) + 1;
+    if (mClockMark && clock > mClockMark->reserved) {
+        mClockMark->reserved = clock + ClockReservation;
+        mClockMark->file->ack(mClockMark->reserved);
+    }
+    fileSystemEvent.setSequence(clock);
+    if (mHistory)
+        mHistory->push(fileSystemEvent);
+    if (mChangeIndex)
+        mChangeIndex->record(fileSystemEvent.getPath().native(), clock);
+    mClock->store(clock, std::memory_order_release);
+}
+
+/**
+ * @brief Keeps the events every watch asked for. Rejects a watch that
+ *        would leave the attached stat cache stale.
+ */
+void NotifyController::checkWatch(Event events)
+{
+    const auto required = StatCache::invalidatingEvents();
+    if (mStatCache && (events & required) != required) {
+        std::stringstream errorStream;
+        errorStream << "The watch misses events invalidating the stat cache, see StatCache::invalidatingEvents(). Events: "
+                    << events;
+        throw std::invalid_argument(errorStream.str());
+    }
+
+    auto watched = mWatchedEvents->load();
+    while (!mWatchedEvents->compare_exchange_weak(watched, watched & events)) {
+    }
+}
+
+/**
+ * @brief Pairs the moved_from and moved_to events of a rename and
+ *        passes them to the observer as one rename instead of to the
+ *        event observers. Halves without a partner within the timeout
+ *        are dispatched as usual. Has to be set before the event loop
+ *        is started.
+ *
+ * @param timeout time a moved_from waits for its moved_to
+ */
+NotifyController& NotifyController::onRename(RenameObserver observer, std::chrono::milliseconds timeout)
+{
+    mRenames = std::make_shared<Renames>(Renames { RenameTracker(timeout), observer });
+    return *this;
+}
+
+/**
+ * @brief Publishes a modified copy of the observer set. Writers don't
+ *        block each other or the event loop, a concurrent update just
+ *        retries on the newer set.
+ */
+void NotifyController::updateObservers(const std::function<void(Observers&)>& update)
+{
+    auto current = std::atomic_load(&mObservers);
+    ObserversPtr next;
+    do {
+        auto copy = std::make_shared<Observers>(*current);
+        update(*copy);
+        next = std::move(copy);
+    } while (!std::atomic_compare_exchange_weak(&mObservers, &current, next));
+    mObserversVersion.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief Observer set for the event loop. The published set is only
+ *        loaded again after an update, otherwise this is a single
+ *        atomic load of the version.
+ */
+const NotifyController::Observers& NotifyController::currentObservers()
+{
+    const auto version = mObserversVersion.load(std::memory_order_acquire);
+    if (version != mCachedVersion) {
+        mCachedObservers = std::atomic_load(&mObservers);
+        mCachedVersion = version;
+    }
+    return *mCachedObservers;
+}
+
+/**
+ * @brief Creates a pool joined with the controller. A pool released by
+ *        one of its own workers is destroyed by the reaper.
+ */
+std::shared_ptr<ThreadPool> NotifyController::makePool(std::size_t threads, std::size_t capacity)
+{
+    std::shared_ptr<ThreadPool> pool(new ThreadPool(threads, capacity), [](ThreadPool* pool) {
+        if (pool->isWorker())
+            reaper().post([pool]() { delete pool; });
+        else
+            delete pool;
+    });
+
+    std::lock_guard<std::mutex> lock(mPools->mutex);
+    auto& pools = mPools->pools;
+    pools.erase(std::remove_if(pools.begin(), pools.end(),
+                    [](const std::weak_ptr<ThreadPool>& weak) { return weak.expired(); }),
+        pools.end());
+    pools.push_back(pool);
+    return pool;
+}
+
+std::shared_ptr<ThreadPool> NotifyController::sharedPool()
+{
+    auto pool = std::atomic_load(&mThreadPool);
+    if (pool)
+        return pool;
+
+    auto created = makePool(std::thread::hardware_concurrency(), 0);
+    if (std::atomic_compare_exchange_strong(&mThreadPool, &pool, created))
+        return created;
+    return pool;
+}
+
+/**
+ * @brief Wraps the observer so that it is executed according to the
+ *        policy. The returned observer only queues the notification.
+ */
+EventObserver NotifyController::makeObserver(EventObserver eventObserver, ExecutionPolicy policy, std::size_t queueSize)
+{
+    auto dropped = mDroppedNotifications;
+    auto failed = mFailedNotifications;
+    switch (policy) {
+    case ExecutionPolicy::immediate:
+        return eventObserver;
+
+    case ExecutionPolicy::shared_pool: {
+        auto pool = sharedPool();
+        auto queued = std::make_shared<std::atomic<std::size_t>>(0);
+        return [pool, queued, dropped, failed, queueSize, eventObserver](Notification notification) {
+            if (queued->fetch_add(1) >= queueSize) {
+                queued->fetch_sub(1);
+                dropped->fetch_add(1);
+                return;
+            }
+            pool->post([queued, failed, eventObserver, notification]() {
+                try {
+                    eventObserver(notification);
+                } catch (...) {
+                    failed->fetch_add(1);
+                }
+                queued->fetch_sub(1);
+            });
+        };
+    }
+
+    case ExecutionPolicy::dedicated: {
+        auto thread = makePool(1, queueSize);
+        return [thread, dropped, failed, eventObserver](Notification notification) {
+            const bool queued = thread->post([failed, eventObserver, notification]() {
+                try {
+                    eventObserver(notification);
+                } catch (...) {
+                    failed->fetch_add(1);
+                }
+            });
+            if (!queued)
+                dropped->fetch_add(1);
+        };
+    }
+    }
+    return eventObserver;
+}
+
+/**
+ * @return number of notifications dropped because the queue of a
+ *         shared_pool or dedicated observer was full
+ */
+std::size_t NotifyController::getDroppedNotifications() const
+{
+    return *mDroppedNotifications;
+}
+
+/**
+ * @return number of notifications whose shared_pool or dedicated
+ *         observer threw, the exception is not passed on
+ */
+std::size_t NotifyController::getFailedNotifications() const
+{
+    return *mFailedNotifications;
+}
+
+NotifyController& NotifyController::onEvent(Event event, EventObserver eventObserver,
+    ExecutionPolicy policy, std::size_t queueSize)
+{
+    auto observer = std::make_shared<const EventObserver>(makeObserver(eventObserver, policy, queueSize));
+    updateObservers([&](Observers& observers) { observers.eventObserver[event] = observer; });
+    return *this;
+}
+
+NotifyController& NotifyController::onEvents(std::set<Event> events, EventObserver eventObserver,
+    ExecutionPolicy policy, std::size_t queueSize)
+{
+    // all events share one queue
+    auto observer = std::make_shared<const EventObserver>(makeObserver(eventObserver, policy, queueSize));
+    updateObservers([&](Observers& observers) {
+        for (auto event : events)
+            observers.eventObserver[event] = observer;
+    });
+    return *this;
+}
+
+/**
+ * @brief Registers an observer for events below a path. A pattern
+ *        without wildcards matches the path and everything beneath
+ *        it, e.g. "/srv/b/config". Patterns with wildcards have to
+ *        match the whole path, e.g. "/srv/b/config/[a-z]*.yaml".
+ *        A "**" component matches any number of directories.
+ *
+ * @param pattern path prefix or glob
+ * @param events the observer is interested in
+ * @param policy where the observer is executed
+ * @param queueSize max. queued notifications if not executed immediately
+ */
+NotifyController& NotifyController::onPath(const std::string& pattern, Event events, EventObserver eventObserver,
+    ExecutionPolicy policy, std::size_t queueSize)
+{
+    auto observer = makeObserver(eventObserver, policy, queueSize);
+    updateObservers([&](Observers& observers) { observers.pathRouter.add(pattern, events, observer); });
     return *this;
 }
 
 NotifyController&
 NotifyController::onUnexpectedEvent(EventObserver eventObserver)
 {
-    mUnexpectedEventObserver = eventObserver;
+    updateObservers([&](Observers& observers) { observers.unexpectedEventObserver = eventObserver; });
+    return *this;
+}
+
+NotifyController& NotifyController::removeEventObserver(Event event)
+{
+    updateObservers([&](Observers& observers) { observers.eventObserver.erase(event); });
+    return *this;
+}
+
+NotifyController& NotifyController::removePathObserver(const std::string& pattern)
+{
+    updateObservers([&](Observers& observers) { observers.pathRouter.remove(pattern); });
     return *this;
 }
 
 void NotifyController::runOnce()
 {
-    auto fileSystemEvent = _Notify->getNextEvent();
-    if (!fileSystemEvent) {
+    TFileSystemEventPtr fileSystemEvent;
+    if (!mSynthetic->empty()) {
+        // already applied to the model
+        fileSystemEvent = mSynthetic->front();
+        mSynthetic->pop_front();
+        tick(*fileSystemEvent);
+    }
+    else {
+        fileSystemEvent = _Notify->getNextEvent();
+        if (fileSystemEvent) {
+            tick(*fileSystemEvent);
+            if (mTreeModel)
+                mTreeModel->apply(*fileSystemEvent);
+        }
+    }
+
+    // before any observer looks at the path again
+    if (mStatCache && fileSystemEvent)
+        mStatCache->invalidate(*fileSystemEvent);
+    if (mHashCache && fileSystemEvent)
+        mHashCache->invalidate(*fileSystemEvent);
+
+    // not held back by journal syncs, persisting or hashing
+    const bool critical = fileSystemEvent && fileSystemEvent->getPriority() == Priority::critical;
+    if (critical)
+        dispatch(*fileSystemEvent);
+
+    if (mPublisher && fileSystemEvent)
+        mPublisher->publish(*fileSystemEvent);
+
+    if (mJournal) {
+        if (fileSystemEvent) {
+            const auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch());
+            mJournal->writer->append(*fileSystemEvent, timestamp.count());
+            mJournal->dirty = true;
+        }
+        syncJournal(false);
+    }
+
+    if (mPersist)
+        persist(false);
+
+    // the other stages still advance their timers
+    if (critical)
+        fileSystemEvent = nullptr;
+
+    if (mWriteFilter && fileSystemEvent && mWriteFilter->unchanged(*fileSystemEvent))
+        fileSystemEvent = nullptr;
+
+    if (!mCoalescer && !mSettle && !mRenames && !mPersist && !mJournal) {
+        if (fileSystemEvent)
+            dispatch(*fileSystemEvent);
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    std::vector<TFileSystemEventPtr> ready;
+    if (mRenames)
+        pairRenames(fileSystemEvent, now, ready);
+    else if (fileSystemEvent)
+        ready.push_back(fileSystemEvent);
+
+    if (mCoalescer)
+        dispatchCoalesced(ready, now);
+    else
+        for (const auto& event : ready)
+            dispatch(*event);
+
+    if (mSettle)
+        settle(fileSystemEvent, now);
+
+    updateReadTimeout();
+}
+
+/**
+ * @brief Passes paired renames to the rename observer. Unpaired halves
+ *        and all other events are returned in ready.
+ */
+void NotifyController::pairRenames(TFileSystemEventPtr fileSystemEvent, std::chrono::steady_clock::time_point now,
+    std::vector<TFileSystemEventPtr>& ready)
+{
+    std::vector<Rename> renames;
+    if (fileSystemEvent)
+        mRenames->tracker.push(fileSystemEvent, now, renames, ready);
+    mRenames->tracker.advance(now, ready);
+
+    for (const auto& rename : renames)
+        mRenames->observer(rename);
+}
+
+/**
+ * @brief Passes the events to the coalescer and dispatches all events
+ *        whose window has passed.
+ */
+void NotifyController::dispatchCoalesced(const std::vector<TFileSystemEventPtr>& fileSystemEvents,
+    std::chrono::steady_clock::time_point now)
+{
+    std::vector<TFileSystemEventPtr> ready;
+    for (const auto& event : fileSystemEvents)
+        mCoalescer->push(*event, now, ready);
+    mCoalescer->advance(now, ready);
+
+    for (const auto& event : ready)
+        dispatch(*event, true);
+}
+
+/**
+ * @brief Adds the event to the change set and passes the set on once
+ *        the quiet period has passed.
+ */
+void NotifyController::settle(TFileSystemEventPtr fileSystemEvent, std::chrono::steady_clock::time_point now)
+{
+    if (fileSystemEvent) {
+        mSettle->builder.add(*fileSystemEvent);
+        mSettle->lastEvent = now;
         return;
     }
 
-    const Event event = fileSystemEvent->getEvent();
-    const auto observers = findObserver(event);
+    if (mSettle->builder.empty() || now - mSettle->lastEvent < mSettle->quietPeriod)
+        return;
 
-    if (observers.empty()) {
-        if (mUnexpectedEventObserver) {
-            mUnexpectedEventObserver({event, fileSystemEvent->getPath()});
+    const auto changes = mSettle->builder.take();
+    if (!changes.empty() && mSettle->observer)
+        mSettle->observer(changes);
+}
+
+/**
+ * @brief Limits the backend wait to the next coalescing window or
+ *        quiet period ending.
+ */
+void NotifyController::updateReadTimeout()
+{
+    auto next = std::chrono::steady_clock::time_point::max();
+    if (mCoalescer)
+        next = std::min(next, mCoalescer->nextExpiry());
+    if (mRenames)
+        next = std::min(next, mRenames->tracker.nextExpiry());
+    if (mSettle && !mSettle->builder.empty())
+        next = std::min(next, mSettle->lastEvent + mSettle->quietPeriod);
+    if (mPersist && getClock() != mPersist->savedClock)
+        next = std::min(next, mPersist->nextSave);
+    if (mJournal && mJournal->dirty)
+        next = std::min(next, mJournal->nextSync);
+
+    if (next == std::chrono::steady_clock::time_point::max()) {
+        _Notify->setReadTimeout(std::chrono::milliseconds(0));
+        return;
+    }
+
+    const auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+        next - std::chrono::steady_clock::now());
+    _Notify->setReadTimeout(std::max(timeout, std::chrono::milliseconds(1)));
+}
+
+/**
+ * @param coalesced the event was merged by the coalescer and may carry
+ *        several events
+ */
+void NotifyController::dispatch(const FileSystemEvent& fileSystemEvent, bool coalesced)
+{
+    const Event event = fileSystemEvent.getEvent();
+    const Observers& current = currentObservers();
+    const auto observers = findObserver(current, event, coalesced);
+    const auto routes = current.pathRouter.match(fileSystemEvent.getPath(), event);
+
+    if (observers.empty() && routes.empty()) {
+        if (current.unexpectedEventObserver) {
+            current.unexpectedEventObserver({event, fileSystemEvent.getPath(), fileSystemEvent.getSequence()});
         }
     }
     else {
         for (const auto& observerEvent : observers) {
             /* handle observed processes */
             auto eventObserver = observerEvent.second;
-            eventObserver({observerEvent.first, fileSystemEvent->getPath()});
+            eventObserver({observerEvent.first, fileSystemEvent.getPath(), fileSystemEvent.getSequence()});
         }
+        for (const auto* route : routes)
+            route->observer({event, fileSystemEvent.getPath(), fileSystemEvent.getSequence()});
     }
 }
 
@@ -127,20 +1005,77 @@ void NotifyController::run()
 {
     while (!_Notify->hasStopped())
         runOnce();
+
+    std::vector<TFileSystemEventPtr> pending;
+    if (mRenames)
+        mRenames->tracker.flush(pending);
+
+    if (mCoalescer) {
+        std::vector<TFileSystemEventPtr> ready;
+        const auto now = std::chrono::steady_clock::now();
+        for (const auto& event : pending)
+            mCoalescer->push(*event, now, ready);
+        mCoalescer->flush(ready);
+        pending.swap(ready);
+    }
+
+    for (const auto& event : pending)
+        dispatch(*event, mCoalescer != nullptr);
+
+    if (mSettle && !mSettle->builder.empty()) {
+        const auto changes = mSettle->builder.take();
+        if (!changes.empty() && mSettle->observer)
+            mSettle->observer(changes);
+    }
+
+    if (mPersist)
+        persist(true);
+
+    if (mJournal)
+        syncJournal(true);
 }
 
+/**
+ * @brief Stops the event loop and waits for the notifications queued
+ *        for pool observers, except when called by such an observer.
+ */
 void NotifyController::stop()
 {
     _Notify->stop();
+
+    std::vector<std::shared_ptr<ThreadPool>> pools;
+    {
+        std::lock_guard<std::mutex> lock(mPools->mutex);
+        for (const auto& weak : mPools->pools)
+            if (auto pool = weak.lock())
+                pools.push_back(pool);
+    }
+    for (const auto& pool : pools)
+        pool->drain();
 }
 
+/**
+ * @brief Kernel events match observers registered for all of their
+ *        flags, coalesced events every observer sharing one of them.
+ *        Each observer is returned once, with the event it is notified
+ *        about.
+ */
 std::vector<std::pair<Event, EventObserver>>
-NotifyController::findObserver(Event e) const
+NotifyController::findObserver(const Observers& current, Event e, bool coalesced)
 {
     std::vector<std::pair<Event, EventObserver>> observers;
-    for (auto const& event2Observer : mEventObserver)
-        if ((event2Observer.first & e) == e)
-            observers.emplace_back(event2Observer.first, event2Observer.second);
+    std::vector<const EventObserver*> found;
+    for (auto const& event2Observer : current.eventObserver) {
+        const bool matches = coalesced ? intersects(event2Observer.first, e) : (event2Observer.first & e) == e;
+        if (!matches)
+            continue;
+
+        const EventObserver* observer = event2Observer.second.get();
+        if (std::find(found.begin(), found.end(), observer) != found.end())
+            continue;
+        found.push_back(observer);
+        observers.emplace_back(coalesced ? e : event2Observer.first, *observer);
+    }
     return observers;
 }
 }
@@ -0,0 +1,278 @@
+#include <notify-cpp/path_router.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace notifycpp {
+
+PathRouter::Glob::Glob(const std::string& pattern)
+    : _Pattern(pattern)
+{
+    for (std::size_t i = 0; i < pattern.size(); ++i) {
+        const char c = pattern[i];
+        if (c == '*') {
+            // collapse consecutive stars, they match the same strings
+            if (_Steps.empty() || _Steps.back().token != Token::any_string)
+                _Steps.push_back({Token::any_string, 0, 0});
+        }
+        else if (c == '?') {
+            _Steps.push_back({Token::any_char, 0, 0});
+        }
+        else if (c == '[') {
+            std::size_t j = i + 1;
+            const bool negated = j < pattern.size() && (pattern[j] == '!' || pattern[j] == '^');
+            if (negated)
+                ++j;
+            std::vector<std::pair<char, char>> ranges;
+            // a ']' directly after the opening bracket is a literal
+            bool first = true;
+            while (j < pattern.size() && (pattern[j] != ']' || first)) {
+                if (j + 2 < pattern.size() && pattern[j + 1] == '-' && pattern[j + 2] != ']') {
+                    ranges.emplace_back(pattern[j], pattern[j + 2]);
+                    j += 3;
+                }
+                else {
+                    ranges.emplace_back(pattern[j], pattern[j]);
+                    ++j;
+                }
+                first = false;
+            }
+            if (j >= pattern.size())
+                throw std::invalid_argument("Unterminated character class in pattern: " + pattern);
+
+            _Classes.push_back(std::move(ranges));
+            _Negated.push_back(negated);
+            _Steps.push_back({Token::char_class, 0, static_cast<std::uint16_t>(_Classes.size() - 1)});
+            i = j;
+        }
+        else if (c == '\\' && i + 1 < pattern.size()) {
+            _Steps.push_back({Token::literal, pattern[++i], 0});
+        }
+        else {
+            _Steps.push_back({Token::literal, c, 0});
+        }
+    }
+}
+
+const std::string& PathRouter::Glob::pattern() const
+{
+    return _Pattern;
+}
+
+bool PathRouter::Glob::matchStep(const Step& step, char c) const
+{
+    switch (step.token) {
+    case Token::literal:
+        return step.c == c;
+    case Token::any_char:
+        return true;
+    case Token::char_class: {
+        const auto& ranges = _Classes[step.cls];
+        const bool found = std::any_of(std::begin(ranges), std::end(ranges),
+            [c](const std::pair<char, char>& r) { return r.first <= c && c <= r.second; });
+        return found != _Negated[step.cls];
+    }
+    case Token::any_string:
+        return false;
+    }
+    return false;
+}
+
+/**
+ * @brief Matches a single component. Only the last '*' is used as
+ *        backtracking point, so the matching is linear for the usual
+ *        patterns like "*.log" or "core.*".
+ */
+bool PathRouter::Glob::match(const std::string& s) const
+{
+    std::size_t step = 0;
+    std::size_t pos = 0;
+    std::size_t starStep = npos;
+    std::size_t starPos = 0;
+
+    while (pos < s.size()) {
+        if (step < _Steps.size() && _Steps[step].token == Token::any_string) {
+            starStep = step++;
+            starPos = pos;
+        }
+        else if (step < _Steps.size() && matchStep(_Steps[step], s[pos])) {
+            ++step;
+            ++pos;
+        }
+        else if (starStep != npos) {
+            step = starStep + 1;
+            pos = ++starPos;
+        }
+        else {
+            return false;
+        }
+    }
+    while (step < _Steps.size() && _Steps[step].token == Token::any_string)
+        ++step;
+    return step == _Steps.size();
+}
+
+PathRouter::PathRouter()
+    : _Nodes(1)
+    , _NextId(0)
+    , _Routes(0)
+{
+}
+
+bool PathRouter::isGlob(const std::string& component)
+{
+    return component.find_first_of("*?[\\") != std::string::npos;
+}
+
+std::vector<std::string> PathRouter::split(const std::filesystem::path& path)
+{
+    std::vector<std::string> components;
+    for (const auto& component : path) {
+        if (!component.empty() && component != ".")
+            components.push_back(component.string());
+    }
+    return components;
+}
+
+std::uint32_t PathRouter::child(std::uint32_t node, const std::string& component)
+{
+    if (component == "**") {
+        if (_Nodes[node].anyDepth == npos) {
+            _Nodes.emplace_back();
+            _Nodes[node].anyDepth = static_cast<std::uint32_t>(_Nodes.size() - 1);
+        }
+        return _Nodes[node].anyDepth;
+    }
+
+    if (isGlob(component)) {
+        for (const auto& glob : _Nodes[node].globs)
+            if (glob.first.pattern() == component)
+                return glob.second;
+        Glob glob(component);
+        _Nodes.emplace_back();
+        _Nodes[node].globs.emplace_back(std::move(glob), static_cast<std::uint32_t>(_Nodes.size() - 1));
+        return _Nodes[node].globs.back().second;
+    }
+
+    const auto found = _Nodes[node].children.find(component);
+    if (found != std::end(_Nodes[node].children))
+        return found->second;
+    _Nodes.emplace_back();
+    const auto index = static_cast<std::uint32_t>(_Nodes.size() - 1);
+    _Nodes[node].children.emplace(component, index);
+    return index;
+}
+
+void PathRouter::add(const std::string& pattern, Event events, EventObserver observer)
+{
+    const auto components = split(pattern);
+    if (components.empty())
+        throw std::invalid_argument("Can´t route empty path pattern");
+
+    bool prefix = true;
+    std::uint32_t node = 0;
+    for (const auto& component : components) {
+        prefix = prefix && !isGlob(component) && component != "**";
+        node = child(node, component);
+    }
+
+    auto& routes = prefix ? _Nodes[node].prefixRoutes : _Nodes[node].routes;
+    routes.push_back({_NextId++, events, std::move(observer)});
+    ++_Routes;
+}
+
+std::uint32_t PathRouter::find(std::uint32_t node, const std::string& component) const
+{
+    if (component == "**")
+        return _Nodes[node].anyDepth;
+
+    if (isGlob(component)) {
+        for (const auto& glob : _Nodes[node].globs)
+            if (glob.first.pattern() == component)
+                return glob.second;
+        return npos;
+    }
+
+    const auto found = _Nodes[node].children.find(component);
+    return found != std::end(_Nodes[node].children) ? found->second : npos;
+}
+
+/**
+ * @brief Removes all observers registered with exactly this pattern.
+ *        The tree nodes are kept, they are reused by the next add.
+ */
+void PathRouter::remove(const std::string& pattern)
+{
+    const auto components = split(pattern);
+    if (components.empty())
+        return;
+
+    bool prefix = true;
+    std::uint32_t node = 0;
+    for (const auto& component : components) {
+        prefix = prefix && !isGlob(component) && component != "**";
+        node = find(node, component);
+        if (node == npos)
+            return;
+    }
+
+    auto& routes = prefix ? _Nodes[node].prefixRoutes : _Nodes[node].routes;
+    _Routes -= routes.size();
+    routes.clear();
+}
+
+void PathRouter::collect(const std::vector<Route>& routes, Event event, std::vector<const Route*>& out)
+{
+    for (const auto& route : routes)
+        if (intersects(route.events, event))
+            out.push_back(&route);
+}
+
+void PathRouter::walk(std::uint32_t index, const std::vector<std::string>& components, std::size_t pos,
+    Event event, std::vector<const Route*>& out) const
+{
+    const Node& node = _Nodes[index];
+    collect(node.prefixRoutes, event, out);
+
+    if (node.anyDepth != npos) {
+        // '**' consumes zero or more components
+        for (std::size_t skip = pos; skip <= components.size(); ++skip)
+            walk(node.anyDepth, components, skip, event, out);
+    }
+
+    if (pos == components.size()) {
+        collect(node.routes, event, out);
+        return;
+    }
+
+    const auto& component = components[pos];
+    const auto found = node.children.find(component);
+    if (found != std::end(node.children))
+        walk(found->second, components, pos + 1, event, out);
+
+    for (const auto& glob : node.globs)
+        if (glob.first.match(component))
+            walk(glob.second, components, pos + 1, event, out);
+}
+
+std::vector<const PathRouter::Route*>
+PathRouter::match(const std::filesystem::path& path, Event event) const
+{
+    std::vector<const Route*> routes;
+    if (empty())
+        return routes;
+
+    walk(0, split(path), 0, event, routes);
+
+    // a route can be reached more than once through '**'
+    std::sort(std::begin(routes), std::end(routes),
+        [](const Route* lhs, const Route* rhs) { return lhs->id < rhs->id; });
+    routes.erase(std::unique(std::begin(routes), std::end(routes)), std::end(routes));
+    return routes;
+}
+
+bool PathRouter::empty() const
+{
+    return _Routes == 0;
+}
+}
@@ -0,0 +1,164 @@
+#include <notify-cpp/remote_notify.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace notifycpp {
+
+RemoteNotify::RemoteNotify(const std::filesystem::path& socket)
+    : _NextId(1)
+{
+    struct sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if (socket.native().size() >= sizeof(address.sun_path))
+        throw std::invalid_argument("Socket path too long: " + socket.string());
+    std::strncpy(address.sun_path, socket.c_str(), sizeof(address.sun_path) - 1);
+
+    _Fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (_Fd == -1 || connect(_Fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1) {
+        std::stringstream errorStream;
+        errorStream << "Can't connect to watch daemon! " << strerror(errno) << ". Path: " << socket;
+        if (_Fd != -1)
+            close(_Fd);
+        throw std::runtime_error(errorStream.str());
+    }
+}
+
+RemoteNotify::~RemoteNotify()
+{
+    close(_Fd);
+}
+
+void RemoteNotify::send(const std::string& frame)
+{
+    std::size_t written = 0;
+    while (written < frame.size()) {
+        const auto result = ::send(_Fd, frame.data() + written, frame.size() - written, MSG_NOSIGNAL);
+        if (result == -1) {
+            if (errno == EINTR)
+                continue;
+            std::stringstream errorStream;
+            errorStream << "Can't send to watch daemon! " << strerror(errno) << ".";
+            throw std::runtime_error(errorStream.str());
+        }
+        written += static_cast<std::size_t>(result);
+    }
+}
+
+void RemoteNotify::subscribe(const FileSystemEvent& fse, bool recursive)
+{
+    std::lock_guard<std::mutex> lock(_SendMutex);
+    remote::Subscription subscription { _NextId++, fse.getEvent(), recursive, std::filesystem::absolute(fse.getPath()) };
+
+    std::string frame;
+    remote::encodeSubscribe(frame, subscription);
+    send(frame);
+    _Subscriptions.push_back(std::move(subscription));
+}
+
+void RemoteNotify::watchFile(const FileSystemEvent& fse)
+{
+    if (checkWatchFile(fse))
+        subscribe(fse, false);
+}
+
+/**
+ * @brief Subscribes to the entries of the directory, not to its
+ *        subdirectories
+ */
+void RemoteNotify::watchDirectory(const FileSystemEvent& fse)
+{
+    if (checkWatchDirectory(fse))
+        subscribe(fse, false);
+}
+
+void RemoteNotify::watchPathRecursively(const FileSystemEvent& fse)
+{
+    if (checkWatchDirectory(fse))
+        subscribe(fse, true);
+}
+
+void RemoteNotify::unwatch(const FileSystemEvent& fse)
+{
+    std::lock_guard<std::mutex> lock(_SendMutex);
+    const auto path = std::filesystem::absolute(fse.getPath());
+
+    std::string frames;
+    for (const auto& subscription : _Subscriptions)
+        if (subscription.path == path)
+            remote::encodeUnsubscribe(frames, subscription.id);
+    send(frames);
+
+    _Subscriptions.erase(std::remove_if(std::begin(_Subscriptions), std::end(_Subscriptions),
+                             [&](const remote::Subscription& subscription) { return subscription.path == path; }),
+        std::end(_Subscriptions));
+}
+
+/**
+ * @brief Moves the events of all complete frames received into the
+ *        event queue.
+ */
+void RemoteNotify::decodeFrames()
+{
+    std::string_view input(_Input);
+    remote::FrameType type;
+    std::string_view payload;
+    while (remote::decodeFrame(input, type, payload)) {
+        if (type != remote::FrameType::events)
+            continue;
+        for (auto& event : remote::decodeEvents(payload))
+            if (!isIgnoredOnce(event.path))
+                _Queue.push(std::make_shared<FileSystemEvent>(event.path, event.event));
+    }
+    _Input.erase(0, _Input.size() - input.size());
+}
+
+/**
+ * @brief Blocking wait on the next event sent by the daemon
+ *
+ * @return A new TFileSystemEventPtr, nullptr on timeout or stop
+ */
+TFileSystemEventPtr RemoteNotify::getNextEvent()
+{
+    const auto deadline = readDeadline();
+    struct pollfd fds = { _Fd, POLLIN, 0 };
+    char buffer[65536];
+
+    while (_Queue.empty() && isRunning()) {
+        if (isTimedOut(deadline))
+            return nullptr;
+
+        if (poll(&fds, 1, pollTimeout(deadline)) <= 0)
+            continue;
+
+        const auto length = read(_Fd, buffer, sizeof(buffer));
+        if (length == 0) {
+            // the daemon is gone
+            stop();
+            break;
+        }
+        if (length == -1)
+            continue;
+
+        _Input.append(buffer, static_cast<std::size_t>(length));
+        decodeFrames();
+    }
+
+    if (isStopped() || _Queue.empty())
+        return nullptr;
+
+    return _Queue.pop();
+}
+
+std::uint32_t RemoteNotify::getEventMask(const Event event) const
+{
+    return static_cast<std::uint32_t>(event);
+}
+}
@@ -0,0 +1,135 @@
+#include <notify-cpp/remote_protocol.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace notifycpp {
+namespace remote {
+
+    namespace {
+        const std::size_t FrameHeader = sizeof(std::uint32_t) + sizeof(std::uint8_t);
+
+        template <typename T>
+        void put(std::string& out, T value)
+        {
+            out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        template <typename T>
+        T get(std::string_view& input)
+        {
+            T value;
+            if (input.size() < sizeof(value))
+                throw std::runtime_error("Malformed frame!");
+            std::memcpy(&value, input.data(), sizeof(value));
+            input.remove_prefix(sizeof(value));
+            return value;
+        }
+
+        std::string_view getString(std::string_view& input, std::size_t length)
+        {
+            if (input.size() < length)
+                throw std::runtime_error("Malformed frame!");
+            const auto value = input.substr(0, length);
+            input.remove_prefix(length);
+            return value;
+        }
+
+        void putHeader(std::string& out, FrameType type, std::size_t length)
+        {
+            put(out, static_cast<std::uint32_t>(length));
+            put(out, static_cast<std::uint8_t>(type));
+        }
+    }
+
+    void encodeSubscribe(std::string& out, const Subscription& subscription)
+    {
+        const auto& path = subscription.path.native();
+        putHeader(out, FrameType::subscribe, 2 * sizeof(std::uint32_t) + sizeof(std::uint8_t) + path.size());
+        put(out, subscription.id);
+        put(out, static_cast<std::uint32_t>(subscription.events));
+        put(out, static_cast<std::uint8_t>(subscription.recursive));
+        out.append(path);
+    }
+
+    void encodeUnsubscribe(std::string& out, std::uint32_t id)
+    {
+        putHeader(out, FrameType::unsubscribe, sizeof(id));
+        put(out, id);
+    }
+
+    void appendEvent(std::string& batch, Event event, const std::filesystem::path& path)
+    {
+        put(batch, static_cast<std::uint32_t>(event));
+        put(batch, static_cast<std::uint32_t>(path.native().size()));
+        batch.append(path.native());
+    }
+
+    void encodeEvents(std::string& out, const std::string& batch, std::uint32_t count)
+    {
+        putHeader(out, FrameType::events, sizeof(count) + batch.size());
+        put(out, count);
+        out.append(batch);
+    }
+
+    bool decodeFrame(std::string_view& input, FrameType& type, std::string_view& payload)
+    {
+        if (input.size() < FrameHeader)
+            return false;
+
+        std::uint32_t length;
+        std::memcpy(&length, input.data(), sizeof(length));
+        if (input.size() < FrameHeader + length)
+            return false;
+
+        type = static_cast<FrameType>(input[sizeof(length)]);
+        payload = input.substr(FrameHeader, length);
+        input.remove_prefix(FrameHeader + length);
+        return true;
+    }
+
+    Subscription decodeSubscribe(std::string_view payload)
+    {
+        Subscription subscription;
+        subscription.id = get<std::uint32_t>(payload);
+        subscription.events = static_cast<Event>(get<std::uint32_t>(payload));
+        subscription.recursive = get<std::uint8_t>(payload) != 0;
+        subscription.path = std::string(payload);
+        return subscription;
+    }
+
+    std::uint32_t decodeUnsubscribe(std::string_view payload)
+    {
+        return get<std::uint32_t>(payload);
+    }
+
+    std::vector<RemoteEvent> decodeEvents(std::string_view payload)
+    {
+        const auto count = get<std::uint32_t>(payload);
+        if (count > payload.size() / (2 * sizeof(std::uint32_t)))
+            throw std::runtime_error("Malformed frame!");
+
+        std::vector<RemoteEvent> events(count);
+        for (auto& event : events) {
+            event.event = static_cast<Event>(get<std::uint32_t>(payload));
+            event.path = std::string(getString(payload, get<std::uint32_t>(payload)));
+        }
+        return events;
+    }
+
+    /**
+     * A recursive subscription matches everything below its path, any
+     * other the path itself and its direct entries.
+     */
+    bool matches(const Subscription& subscription, Event event, const std::filesystem::path& path)
+    {
+        if (!intersects(subscription.events, event))
+            return false;
+        if (subscription.recursive)
+            return std::mismatch(subscription.path.begin(), subscription.path.end(), path.begin(), path.end()).first
+                == subscription.path.end();
+        return path == subscription.path || path.parent_path() == subscription.path;
+    }
+}
+}
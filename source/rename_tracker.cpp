@@ -0,0 +1,96 @@
+#include <notify-cpp/rename_tracker.h>
+
+namespace notifycpp {
+
+RenameTracker::RenameTracker(std::chrono::milliseconds timeout, std::size_t capacity)
+    : _Timeout(timeout)
+    , _Capacity(capacity)
+{
+}
+
+/**
+ * @brief Pairs the event with a held back moved_from or holds it back
+ *        itself. All other events are passed on immediately.
+ */
+void RenameTracker::push(TFileSystemEventPtr fse, Clock::time_point now, std::vector<Rename>& renames,
+    std::vector<TFileSystemEventPtr>& ready)
+{
+    const std::uint32_t cookie = fse->getCookie();
+    const Event event = fse->getEvent();
+
+    if (cookie == 0 || (event != Event::moved_from && event != Event::moved_to)) {
+        ready.push_back(fse);
+        return;
+    }
+
+    if (event == Event::moved_to) {
+        const auto found = _Pending.find(cookie);
+        if (found == std::end(_Pending)) {
+            ready.push_back(fse);
+            return;
+        }
+        renames.push_back({ found->second->getPath(), fse->getPath() });
+        _Pending.erase(found);
+        return;
+    }
+
+    // the oldest rename is given up rather than the table growing
+    while (_Pending.size() >= _Capacity && !_Expiries.empty()) {
+        const auto expiry = _Expiries.front();
+        _Expiries.pop_front();
+        expire(expiry, ready);
+    }
+
+    const auto inserted = _Pending.emplace(cookie, fse);
+    if (!inserted.second) {
+        // cookie reused before the first rename was paired
+        ready.push_back(inserted.first->second);
+        inserted.first->second = fse;
+    }
+    _Expiries.push_back({ cookie, now + _Timeout });
+}
+
+void RenameTracker::expire(const Expiry& expiry, std::vector<TFileSystemEventPtr>& ready)
+{
+    const auto found = _Pending.find(expiry.cookie);
+    if (found == std::end(_Pending))
+        return;
+    ready.push_back(found->second);
+    _Pending.erase(found);
+}
+
+/**
+ * @brief Passes on all moved_from events whose timeout has passed.
+ */
+void RenameTracker::advance(Clock::time_point now, std::vector<TFileSystemEventPtr>& ready)
+{
+    while (!_Expiries.empty() && _Expiries.front().deadline <= now) {
+        const auto expiry = _Expiries.front();
+        _Expiries.pop_front();
+        expire(expiry, ready);
+    }
+}
+
+void RenameTracker::flush(std::vector<TFileSystemEventPtr>& ready)
+{
+    while (!_Expiries.empty()) {
+        const auto expiry = _Expiries.front();
+        _Expiries.pop_front();
+        expire(expiry, ready);
+    }
+}
+
+RenameTracker::Clock::time_point RenameTracker::nextExpiry() const
+{
+    // expiries of paired renames are skipped lazily
+    for (const auto& expiry : _Expiries)
+        if (_Pending.count(expiry.cookie))
+            return expiry.deadline;
+    return Clock::time_point::max();
+}
+
+std::size_t RenameTracker::pending() const
+{
+    return _Pending.size();
+}
+}
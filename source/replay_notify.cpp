@@ -0,0 +1,100 @@
+#include <notify-cpp/replay_notify.h>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace notifycpp {
+
+ReplayNotify::ReplayNotify(const std::filesystem::path& recording, ReplaySpeed speed)
+    : mPlayback(recording)
+    , mSpeed(speed)
+    , mStarted(false)
+{
+}
+
+void ReplayNotify::applyEntry(const RecordedEntry& entry)
+{
+    if (entry.type == RecordedEntry::Type::watch)
+        attachWatch(entry.wd, entry.path, entry.events, entry.recursive);
+    else if (entry.type == RecordedEntry::Type::unwatch)
+        applyWatchCommand({ WatchCommand::Type::remove, -1, entry.path, Event::none, false });
+}
+
+void ReplayNotify::watchCriticalPath(const FileSystemEvent& fse)
+{
+    Notify::watchCriticalPath(fse);
+}
+
+/**
+ * @brief Applies the watches the user changed before the current
+ *        buffer was decoded.
+ */
+void ReplayNotify::applyWatchCommands()
+{
+    for (auto* entry = mPlayback.peek(); entry && entry->type != RecordedEntry::Type::read; entry = mPlayback.peek()) {
+        if (entry->type == RecordedEntry::Type::watch && !entry->command)
+            break;
+        applyEntry(*entry);
+        mPlayback.pop();
+    }
+}
+
+/**
+ * @brief Applies the watches added for the directory and its
+ *        subdirectories when it was decoded, the file system is not
+ *        looked at.
+ */
+void ReplayNotify::watchNewDirectory(const Watch&, const std::filesystem::path& path)
+{
+    for (auto* entry = mPlayback.peek(); entry && entry->type == RecordedEntry::Type::watch && !entry->command;
+         entry = mPlayback.peek()) {
+        if (std::mismatch(path.begin(), path.end(), entry->path.begin(), entry->path.end()).first != path.end())
+            break;
+        applyEntry(*entry);
+        mPlayback.pop();
+    }
+}
+
+/**
+ * @brief Returns the next recorded buffer, for the original speed not
+ *        before its delay to the first buffer has passed.
+ *
+ * @return bytes returned, 0 if the buffer is not due yet
+ */
+ssize_t ReplayNotify::readEvents(char* buffer, std::size_t size, const std::chrono::steady_clock::time_point& deadline)
+{
+    // watch changes recorded after the last buffer was decoded
+    auto* entry = mPlayback.peek();
+    for (; entry && entry->type != RecordedEntry::Type::read; entry = mPlayback.peek()) {
+        applyEntry(*entry);
+        mPlayback.pop();
+    }
+
+    if (!entry) {
+        stop();
+        return 0;
+    }
+
+    if (mSpeed == ReplaySpeed::original) {
+        const auto now = std::chrono::steady_clock::now();
+        if (!mStarted) {
+            mStart = now - std::chrono::nanoseconds(entry->timestamp);
+            mStarted = true;
+        }
+
+        const auto due = mStart + std::chrono::nanoseconds(entry->timestamp);
+        if (now < due) {
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                due - now, std::chrono::milliseconds(pollTimeout(deadline))));
+            if (std::chrono::steady_clock::now() < due)
+                return 0;
+        }
+    }
+
+    const auto length = std::min(size, entry->data.size());
+    std::memcpy(buffer, entry->data.data(), length);
+    mPlayback.pop();
+    return static_cast<ssize_t>(length);
+}
+}
@@ -0,0 +1,485 @@
+#include <notify-cpp/sharded_notify.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <sstream>
+#include <stdexcept>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace notifycpp {
+
+/**
+ * @param shards number of inotify instances
+ * @param pinThreads pins the reader of shard i to the i-th core the
+ *        process may run on
+ * @throws std::runtime_error if a reader can't be pinned
+ */
+ShardedNotify::ShardedNotify(std::size_t shards, bool pinThreads)
+    : _PinThreads(pinThreads)
+    , _Split(std::make_shared<const SplitRoots>())
+    , _ForwardedIgnored(0)
+{
+    if (shards == 0)
+        throw std::invalid_argument("A sharded backend needs at least one shard");
+
+    _Shards.resize(shards);
+    for (auto& shard : _Shards) {
+        shard.notify = std::make_unique<Inotify>();
+        // the reader checks for stop between reads
+        shard.notify->setReadTimeout(std::chrono::milliseconds(mThreadSleep));
+    }
+
+    try {
+        for (std::size_t i = 0; i < _Shards.size(); ++i)
+            startReader(_Shards[i], i, false);
+    } catch (...) {
+        stop();
+        for (auto& shard : _Shards)
+            if (shard.reader.joinable())
+                shard.reader.join();
+        throw;
+    }
+}
+
+ShardedNotify::~ShardedNotify()
+{
+    stop();
+    _NotFull.notify_all();
+    for (auto& shard : _Shards)
+        shard.reader.join();
+    if (_Critical.reader.joinable())
+        _Critical.reader.join();
+}
+
+/**
+ * @brief Starts the reader of the shard. A pinned reader starts reading
+ *        once it runs on its core, if it can't be pinned it is joined
+ *        again and an exception is thrown.
+ */
+void ShardedNotify::startReader(Shard& shard, std::size_t index, bool critical)
+{
+    std::promise<bool> pinned;
+    shard.reader = std::thread([this, &shard, index, critical, start = pinned.get_future()]() mutable {
+        if (start.get())
+            read(shard, index, critical);
+    });
+    if (!_PinThreads) {
+        pinned.set_value(true);
+        return;
+    }
+
+    // the n-th core of the cores the process may run on
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    int result = sched_getaffinity(0, sizeof(allowed), &allowed) == 0 ? 0 : errno;
+    if (result == 0) {
+        const auto count = static_cast<std::size_t>(std::max(1, CPU_COUNT(&allowed)));
+        std::size_t n = index % count;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed) && n-- == 0) {
+                CPU_SET(cpu, &set);
+                break;
+            }
+        }
+        result = pthread_setaffinity_np(shard.reader.native_handle(), sizeof(set), &set);
+    }
+
+    pinned.set_value(result == 0);
+    if (result != 0) {
+        shard.reader.join();
+        std::stringstream errorStream;
+        errorStream << "Can't pin shard reader to a core! " << strerror(result) << ". Shard: " << index;
+        throw std::runtime_error(errorStream.str());
+    }
+}
+
+std::size_t ShardedNotify::shards() const
+{
+    return _Shards.size();
+}
+
+/**
+ * @brief Reads and decodes the events of one instance until stopped.
+ */
+void ShardedNotify::read(Shard& shard, std::size_t index, bool critical)
+{
+    while (isRunning()) {
+        auto event = shard.notify->getNextEvent();
+        if (!event)
+            continue;
+
+        if (!critical) {
+            const auto split = std::atomic_load(&_Split);
+            if (!split->empty() && !splitEvent(index, *split, *event))
+                continue;
+        }
+        event->setShard(static_cast<std::uint32_t>(index), ++shard.sequence);
+
+        if (!critical) {
+            push(std::move(event));
+            continue;
+        }
+
+        // never limited, critical events are not dropped or blocked
+        event->setPriority(Priority::critical);
+        std::lock_guard<std::mutex> lock(_QueueMutex);
+        _CriticalQueue.push_back(std::move(event));
+        _NotEmpty.notify_one();
+    }
+    shard.notify->stop();
+}
+
+void ShardedNotify::push(TFileSystemEventPtr event)
+{
+    std::unique_lock<std::mutex> lock(_QueueMutex);
+    if (!_Queue.accept())
+        while (_Queue.full() && isRunning())
+            _NotFull.wait_for(lock, std::chrono::milliseconds(mThreadSleep));
+
+    _Queue.push(std::move(event));
+    _NotEmpty.notify_one();
+}
+
+ShardedNotify::Shard& ShardedNotify::shardAt(std::size_t index)
+{
+    return index < _Shards.size() ? _Shards[index] : _Critical;
+}
+
+/**
+ * @brief Placement of the nearest recursively watched directory above
+ *        the path, nullptr if there is none. Called with _WatchMutex
+ *        held.
+ */
+const ShardedNotify::Placement* ShardedNotify::ownerOf(const std::filesystem::path& path) const
+{
+    for (auto parent = path.parent_path(); !parent.empty(); parent = parent.parent_path()) {
+        const auto above = _Placement.find(parent);
+        if (above != std::end(_Placement) && above->second.recursive)
+            return &above->second;
+        if (parent == parent.parent_path())
+            break;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Shard of the path, of the nearest recursively watched directory
+ *        above it or chosen by the hash of the path. Called with
+ *        _WatchMutex held.
+ */
+std::size_t ShardedNotify::placeOf(const std::filesystem::path& path) const
+{
+    const auto placed = _Placement.find(path);
+    if (placed != std::end(_Placement))
+        return placed->second.shard;
+
+    const auto owner = ownerOf(path);
+    if (owner)
+        return owner->shard;
+    return std::hash<std::string>()(path.string()) % _Shards.size();
+}
+
+/**
+ * @brief Watches a subdirectory of a split directory with its subtree.
+ *        The subtree is walked without _WatchMutex, so the readers of
+ *        the other shards go on.
+ *
+ * @throws std::runtime_error if the subdirectory can't be watched
+ */
+void ShardedNotify::placeSubdirectory(const std::filesystem::path& path, Event events)
+{
+    const auto index = std::hash<std::string>()(path.string()) % _Shards.size();
+    {
+        std::lock_guard<std::mutex> lock(_WatchMutex);
+        if (!_Placement.emplace(path, Placement { index, true }).second)
+            return;
+    }
+
+    try {
+        _Shards[index].notify->watchPathRecursively({ path, events });
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(_WatchMutex);
+        _Placement.erase(path);
+        throw;
+    }
+
+    // unwatched while its subtree was walked
+    std::lock_guard<std::mutex> lock(_WatchMutex);
+    if (_Placement.find(path) == std::end(_Placement))
+        _Shards[index].notify->unwatch({ path, Event::none });
+}
+
+/**
+ * @brief Unwatches the path and every path placed below it, each on
+ *        its shard. Called with _WatchMutex held.
+ */
+void ShardedNotify::unplace(const std::filesystem::path& path)
+{
+    const auto placed = _Placement.find(path);
+    if (placed != std::end(_Placement)) {
+        shardAt(placed->second.shard).notify->unwatch({ path, Event::none });
+        _Placement.erase(placed);
+    }
+
+    // the paths below sort right after it
+    const auto prefix = path.native() + '/';
+    for (auto it = _Placement.upper_bound(path);
+         it != std::end(_Placement) && it->first.native().compare(0, prefix.size(), prefix) == 0;) {
+        shardAt(it->second.shard).notify->unwatch({ it->first, Event::none });
+        it = _Placement.erase(it);
+    }
+}
+
+/**
+ * @brief Publishes a new snapshot of the split directories with the
+ *        directory added, or removed for nullptr. Called with
+ *        _WatchMutex held.
+ */
+void ShardedNotify::updateSplit(const std::filesystem::path& path, const SplitRoot* root)
+{
+    auto split = std::make_shared<SplitRoots>(*std::atomic_load(&_Split));
+    if (root)
+        (*split)[path] = *root;
+    else
+        split->erase(path);
+    std::atomic_store(&_Split, std::shared_ptr<const SplitRoots>(std::move(split)));
+}
+
+/**
+ * @brief Places and removes the subdirectories of a split directory as
+ *        its events are read. Called by the reader of the shard.
+ *
+ * @return false if the event was only read for the placement and not
+ *         requested
+ */
+bool ShardedNotify::splitEvent(std::size_t index, const SplitRoots& roots, const FileSystemEvent& event)
+{
+    const auto path = event.getPath();
+    const auto split = roots.find(path.parent_path());
+    if (split == std::end(roots) || split->second.shard != index)
+        return true;
+
+    const Event type = event.getEvent();
+    if (intersects(type, Event::create | Event::moved_to)) {
+        std::error_code error;
+        if (std::filesystem::is_directory(path, error) && !std::filesystem::is_symlink(path, error)
+            && !isIgnored(path)) {
+            try {
+                placeSubdirectory(path, split->second.events);
+            } catch (const std::exception&) {
+                // gone again
+            }
+        }
+    } else if (intersects(type, Event::moved_from | Event::delete_sub)) {
+        std::lock_guard<std::mutex> lock(_WatchMutex);
+        unplace(path);
+    }
+    return intersects(type, split->second.events);
+}
+
+/**
+ * @brief Passes paths ignored since the last watch to every instance,
+ *        which guards its list against its reading thread. Called with
+ *        _WatchMutex held.
+ */
+void ShardedNotify::forwardIgnored()
+{
+    std::vector<std::filesystem::path> ignored;
+    {
+        std::lock_guard<std::mutex> lock(_IgnoredMutex);
+        ignored.assign(std::begin(_Ignored) + static_cast<std::ptrdiff_t>(_ForwardedIgnored), std::end(_Ignored));
+        _ForwardedIgnored = _Ignored.size();
+    }
+
+    for (const auto& path : ignored) {
+        for (auto& shard : _Shards)
+            shard.notify->ignore(path);
+        if (_Critical.notify)
+            _Critical.notify->ignore(path);
+    }
+}
+
+void ShardedNotify::watchFile(const FileSystemEvent& fse)
+{
+    if (!checkWatchFile(fse))
+        return;
+
+    std::lock_guard<std::mutex> lock(_WatchMutex);
+    const auto index = placeOf(fse.getPath());
+    forwardIgnored();
+    shardAt(index).notify->watchFile(fse);
+    _Placement.emplace(fse.getPath(), Placement { index, false });
+}
+
+void ShardedNotify::followPath(const FileSystemEvent& fse)
+{
+    std::lock_guard<std::mutex> lock(_WatchMutex);
+    const auto index = placeOf(fse.getPath());
+    forwardIgnored();
+    shardAt(index).notify->followPath(fse);
+    _Placement.emplace(fse.getPath(), Placement { index, false });
+}
+
+/**
+ * @brief Watches the directory on its shard and every subdirectory with
+ *        its subtree on the shard chosen by its path. A directory below
+ *        a recursively watched one is watched on the shard owning it.
+ */
+void ShardedNotify::watchPathRecursively(const FileSystemEvent& fse)
+{
+    if (!checkWatchDirectory(fse))
+        return;
+
+    const auto path = fse.getPath();
+    {
+        std::lock_guard<std::mutex> lock(_WatchMutex);
+        forwardIgnored();
+
+        const auto owner = ownerOf(path);
+        if (owner || _Shards.size() == 1) {
+            const auto index = owner ? owner->shard : 0;
+            shardAt(index).notify->watchPathRecursively(fse);
+            _Placement[path] = { index, true };
+            return;
+        }
+
+        // the entries of the directory are placed as they appear
+        const auto index = std::hash<std::string>()(path.string()) % _Shards.size();
+        _Shards[index].notify->watchDirectory(
+            { path, fse.getEvent() | Event::create | Event::move | Event::delete_sub });
+        _Placement[path] = { index, true };
+        const SplitRoot root { fse.getEvent(), index };
+        updateSplit(path, &root);
+    }
+
+    for (const auto& entry : std::filesystem::directory_iterator(path)) {
+        if (entry.is_directory() && !entry.is_symlink() && !isIgnored(entry.path()))
+            placeSubdirectory(entry.path(), fse.getEvent());
+    }
+}
+
+/**
+ * @brief Watches the directory recursively on the critical instance,
+ *        which is started by the first call.
+ */
+void ShardedNotify::watchCriticalPath(const FileSystemEvent& fse)
+{
+    if (!checkWatchDirectory(fse))
+        return;
+
+    std::lock_guard<std::mutex> lock(_WatchMutex);
+    if (!_Critical.notify) {
+        _Critical.notify = std::make_unique<Inotify>();
+        _Critical.notify->setReadTimeout(std::chrono::milliseconds(mThreadSleep));
+        {
+            // forwarded to the other instances already
+            std::lock_guard<std::mutex> ignoredLock(_IgnoredMutex);
+            for (std::size_t i = 0; i < _ForwardedIgnored; ++i)
+                _Critical.notify->ignore(_Ignored[i]);
+        }
+        try {
+            // next to the last normal reader
+            startReader(_Critical, _Shards.size(), true);
+        } catch (...) {
+            _Critical.notify.reset();
+            throw;
+        }
+    }
+
+    forwardIgnored();
+    _Critical.notify->watchPathRecursively(fse);
+    _Placement[fse.getPath()] = { _Shards.size(), true };
+}
+
+/**
+ * @brief Unwatches the path on the instance it was placed on. A
+ *        recursively watched directory is unwatched with the paths
+ *        placed below it, the subdirectories of a split directory on
+ *        their shards. Paths not watched directly are unwatched on
+ *        every instance.
+ */
+void ShardedNotify::unwatch(const FileSystemEvent& fse)
+{
+    std::lock_guard<std::mutex> lock(_WatchMutex);
+    const auto placed = _Placement.find(fse.getPath());
+    if (placed == std::end(_Placement)) {
+        for (auto& shard : _Shards)
+            shard.notify->unwatch(fse);
+        if (_Critical.notify)
+            _Critical.notify->unwatch(fse);
+        return;
+    }
+
+    if (!placed->second.recursive) {
+        shardAt(placed->second.shard).notify->unwatch(fse);
+        _Placement.erase(placed);
+        return;
+    }
+
+    if (std::atomic_load(&_Split)->count(fse.getPath()))
+        updateSplit(fse.getPath(), nullptr);
+    unplace(fse.getPath());
+}
+
+/**
+ * @brief Blocking wait on the next event decoded by any instance
+ *
+ * @return A new TFileSystemEventPtr, nullptr on timeout or stop
+ */
+TFileSystemEventPtr ShardedNotify::getNextEvent()
+{
+    const auto deadline = readDeadline();
+    std::unique_lock<std::mutex> lock(_QueueMutex);
+
+    while (isRunning()) {
+        while (!_CriticalQueue.empty()) {
+            auto event = std::move(_CriticalQueue.front());
+            _CriticalQueue.pop_front();
+            if (!isIgnoredOnce(event->getPath()))
+                return event;
+        }
+
+        if (!_Queue.empty()) {
+            auto event = _Queue.pop();
+            _NotFull.notify_one();
+            if (!isIgnoredOnce(event->getPath()))
+                return event;
+            continue;
+        }
+
+        if (isTimedOut(deadline))
+            return nullptr;
+        _NotEmpty.wait_for(lock, std::chrono::milliseconds(pollTimeout(deadline)));
+    }
+    return nullptr;
+}
+
+std::uint32_t ShardedNotify::getEventMask(const Event event) const
+{
+    return _Shards.front().notify->getEventMask(event);
+}
+
+WatchStatistics ShardedNotify::getWatchStatistics() const
+{
+    WatchStatistics statistics;
+    const auto add = [&statistics](const Shard& shard) {
+        const auto shardStatistics = shard.notify->getWatchStatistics();
+        statistics.watches += shardStatistics.watches;
+        statistics.nodes += shardStatistics.nodes;
+        statistics.bytes += shardStatistics.bytes;
+    };
+
+    std::lock_guard<std::mutex> lock(_WatchMutex);
+    for (const auto& shard : _Shards)
+        add(shard);
+    if (_Critical.notify)
+        add(_Critical);
+    return statistics;
+}
+}
@@ -0,0 +1,102 @@
+#include <notify-cpp/shared_ring.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace notifycpp {
+
+std::size_t shared_ring::size(std::uint32_t slotCount)
+{
+    return sizeof(Slot) + static_cast<std::size_t>(slotCount) * sizeof(Slot);
+}
+
+/**
+ * @param slotCount number of events kept, a power of two
+ */
+SharedRingPublisher::SharedRingPublisher(std::uint32_t slotCount)
+    : _Fd(-1)
+    , _Length(shared_ring::size(slotCount))
+{
+    static_assert(sizeof(shared_ring::Header) <= sizeof(shared_ring::Slot), "header has to fit in the first slot");
+
+    if (slotCount == 0 || (slotCount & (slotCount - 1)) != 0)
+        throw std::invalid_argument("The slot count of a shared ring has to be a power of two");
+
+    _Fd = memfd_create("notify-cpp-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (_Fd == -1 || ftruncate(_Fd, static_cast<off_t>(_Length)) == -1) {
+        std::stringstream errorStream;
+        errorStream << "Can't create shared ring! " << strerror(errno) << ".";
+        if (_Fd != -1)
+            close(_Fd);
+        throw std::runtime_error(errorStream.str());
+    }
+
+    // readers can rely on the size
+    fcntl(_Fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+
+    void* data = mmap(nullptr, _Length, PROT_READ | PROT_WRITE, MAP_SHARED, _Fd, 0);
+    if (data == MAP_FAILED) {
+        std::stringstream errorStream;
+        errorStream << "Can't map shared ring! " << strerror(errno) << ".";
+        close(_Fd);
+        throw std::runtime_error(errorStream.str());
+    }
+
+    // the memfd is zero filled, which is the initial state of all atomics
+    _Header = static_cast<shared_ring::Header*>(data);
+    _Slots = reinterpret_cast<shared_ring::Slot*>(static_cast<char*>(data) + sizeof(shared_ring::Slot));
+    std::memcpy(_Header->magic, shared_ring::Magic, sizeof(shared_ring::Magic));
+    _Header->version = shared_ring::Version;
+    _Header->slotCount = slotCount;
+}
+
+SharedRingPublisher::~SharedRingPublisher()
+{
+    munmap(_Header, _Length);
+    close(_Fd);
+}
+
+void SharedRingPublisher::publish(const FileSystemEvent& fse)
+{
+    const auto sequence = _Header->head.load(std::memory_order_relaxed);
+    auto& slot = _Slots[sequence & (_Header->slotCount - 1)];
+
+    slot.version.store(2 * sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const auto path = fse.getPath().native();
+    slot.event = static_cast<std::uint32_t>(fse.getEvent());
+    slot.cookie = fse.getCookie();
+    slot.pid = fse.getPid();
+    slot.length = static_cast<std::uint32_t>(std::min(path.size(), sizeof(slot.path)));
+    std::memcpy(slot.path, path.data(), slot.length);
+
+    slot.version.store(2 * sequence + 2, std::memory_order_release);
+    _Header->head.store(sequence + 1, std::memory_order_release);
+
+    _Header->wake.fetch_add(1);
+    if (_Header->waiters.load() > 0)
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&_Header->wake), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+int SharedRingPublisher::fd() const
+{
+    return _Fd;
+}
+
+/**
+ * @return path other processes can open the ring with
+ */
+std::filesystem::path SharedRingPublisher::path() const
+{
+    return std::filesystem::path("/proc") / std::to_string(getpid()) / "fd" / std::to_string(_Fd);
+}
+}
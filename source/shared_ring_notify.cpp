@@ -0,0 +1,197 @@
+#include <notify-cpp/shared_ring_notify.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace notifycpp {
+
+SharedRingNotify::SharedRingNotify(const std::filesystem::path& ring)
+    : _Lost(0)
+{
+    const int fd = open(ring.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd == -1) {
+        std::stringstream errorStream;
+        errorStream << "Can't open shared ring! " << strerror(errno) << ". Path: " << ring;
+        throw std::runtime_error(errorStream.str());
+    }
+
+    try {
+        map(fd);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+}
+
+/**
+ * @param fd of the ring, stays owned by the caller
+ */
+SharedRingNotify::SharedRingNotify(int fd)
+    : _Lost(0)
+{
+    map(fd);
+}
+
+SharedRingNotify::~SharedRingNotify()
+{
+    munmap(_Header, _Length);
+}
+
+void SharedRingNotify::map(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) == -1 || static_cast<std::size_t>(st.st_size) < sizeof(shared_ring::Slot))
+        throw std::runtime_error("Invalid shared ring!");
+
+    _Length = static_cast<std::size_t>(st.st_size);
+    void* data = mmap(nullptr, _Length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        std::stringstream errorStream;
+        errorStream << "Can't map shared ring! " << strerror(errno) << ".";
+        throw std::runtime_error(errorStream.str());
+    }
+
+    _Header = static_cast<shared_ring::Header*>(data);
+    if (std::memcmp(_Header->magic, shared_ring::Magic, sizeof(shared_ring::Magic)) != 0
+        || _Header->version != shared_ring::Version
+        || _Header->slotCount == 0 || shared_ring::size(_Header->slotCount) != _Length) {
+        munmap(data, _Length);
+        throw std::runtime_error("Invalid shared ring!");
+    }
+
+    _Slots = reinterpret_cast<const shared_ring::Slot*>(static_cast<const char*>(data) + sizeof(shared_ring::Slot));
+    _Cursor = _Header->head.load(std::memory_order_acquire);
+}
+
+void SharedRingNotify::watchFile(const FileSystemEvent& fse)
+{
+    if (!checkWatchFile(fse))
+        return;
+
+    std::lock_guard<std::mutex> lock(_SubscriptionMutex);
+    _Subscriptions.push_back({ fse.getPath(), fse.getEvent(), false });
+}
+
+void SharedRingNotify::watchPathRecursively(const FileSystemEvent& fse)
+{
+    if (!checkWatchDirectory(fse))
+        return;
+
+    std::lock_guard<std::mutex> lock(_SubscriptionMutex);
+    _Subscriptions.push_back({ fse.getPath(), fse.getEvent(), true });
+}
+
+void SharedRingNotify::unwatch(const FileSystemEvent& fse)
+{
+    std::lock_guard<std::mutex> lock(_SubscriptionMutex);
+    _Subscriptions.erase(std::remove_if(std::begin(_Subscriptions), std::end(_Subscriptions),
+                             [&](const Subscription& subscription) { return subscription.path == fse.getPath(); }),
+        std::end(_Subscriptions));
+}
+
+bool SharedRingNotify::isSubscribed(const std::filesystem::path& path, Event event) const
+{
+    std::lock_guard<std::mutex> lock(_SubscriptionMutex);
+    if (_Subscriptions.empty())
+        return true;
+
+    return std::any_of(std::begin(_Subscriptions), std::end(_Subscriptions), [&](const Subscription& subscription) {
+        if (!intersects(subscription.events, event))
+            return false;
+        if (!subscription.recursive)
+            return path == subscription.path;
+        return std::mismatch(subscription.path.begin(), subscription.path.end(), path.begin(), path.end()).first
+            == subscription.path.end();
+    });
+}
+
+/**
+ * @brief Sleeps until the writer published an event after wake was
+ *        read, at most until the stop flag has to be checked again.
+ */
+void SharedRingNotify::wait(std::uint32_t wake, const std::chrono::steady_clock::time_point& deadline)
+{
+    const auto timeout = pollTimeout(deadline);
+    struct timespec ts = { timeout / 1000, (timeout % 1000) * 1000000L };
+
+    _Header->waiters.fetch_add(1);
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&_Header->wake), FUTEX_WAIT, wake, &ts, nullptr, 0);
+    _Header->waiters.fetch_sub(1);
+}
+
+/**
+ * @brief Blocking wait on the next published event matching the
+ *        watches.
+ *
+ * @return A new TFileSystemEventPtr, nullptr on timeout or stop
+ */
+TFileSystemEventPtr SharedRingNotify::getNextEvent()
+{
+    const auto deadline = readDeadline();
+    const std::uint64_t slotCount = _Header->slotCount;
+    std::string path;
+
+    while (isRunning()) {
+        const auto wake = _Header->wake.load();
+        const auto& slot = _Slots[_Cursor & (slotCount - 1)];
+        const auto expected = 2 * _Cursor + 2;
+        const auto version = slot.version.load(std::memory_order_acquire);
+
+        if (version < expected) {
+            if (isTimedOut(deadline))
+                return nullptr;
+            wait(wake, deadline);
+            continue;
+        }
+
+        if (version == expected) {
+            const auto event = static_cast<Event>(slot.event);
+            const auto cookie = slot.cookie;
+            const auto pid = slot.pid;
+            path.assign(slot.path, std::min<std::size_t>(slot.length, sizeof(slot.path)));
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.version.load(std::memory_order_relaxed) == expected) {
+                ++_Cursor;
+                if (!isSubscribed(path, event) || isIgnoredOnce(path))
+                    continue;
+                return std::make_shared<FileSystemEvent>(path, event, cookie, pid);
+            }
+        }
+
+        // lapped by the writer, continue with the oldest event still kept
+        const auto head = _Header->head.load(std::memory_order_acquire);
+        const auto oldest = head > slotCount ? head - slotCount : 0;
+        const auto next = std::max(oldest, _Cursor + 1);
+        _Lost += next - _Cursor;
+        _Cursor = next;
+
+        // like a kernel queue overflow, it concerns every path
+        return std::make_shared<FileSystemEvent>(std::filesystem::path {}, Event::overflow);
+    }
+    return nullptr;
+}
+
+std::uint32_t SharedRingNotify::getEventMask(const Event event) const
+{
+    return static_cast<std::uint32_t>(event);
+}
+
+/**
+ * @return number of events overwritten before they were read
+ */
+std::uint64_t SharedRingNotify::getLostEvents() const
+{
+    return _Lost;
+}
+}
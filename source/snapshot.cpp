@@ -0,0 +1,382 @@
+#include <notify-cpp/snapshot.h>
+#include <notify-cpp/tree_model.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace notifycpp {
+
+namespace {
+    const char SnapshotMagic[8] = { 'N', 'C', 'P', 'P', 'S', 'N', 'A', 'P' };
+    const std::uint32_t SnapshotVersion = 2;
+
+    std::runtime_error snapshotError(const std::string& what, const std::filesystem::path& file)
+    {
+        std::stringstream errorStream;
+        errorStream << what << " " << strerror(errno) << ". Path: " << file;
+        return std::runtime_error(errorStream.str());
+    }
+}
+
+Snapshot::Snapshot(const std::filesystem::path& file)
+    : _Data(nullptr)
+    , _Length(0)
+{
+    const int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        throw snapshotError("Can't open snapshot!", file);
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        throw snapshotError("Can't read snapshot!", file);
+    }
+    _Length = static_cast<std::size_t>(st.st_size);
+
+    if (_Length >= sizeof(Header))
+        _Data = mmap(nullptr, _Length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (_Data == MAP_FAILED || _Data == nullptr) {
+        _Data = nullptr;
+        throw std::runtime_error("Can't map snapshot! Path: " + file.string());
+    }
+
+    _Header = static_cast<const Header*>(_Data);
+    if (!valid()) {
+        munmap(_Data, _Length);
+        _Data = nullptr;
+        throw std::runtime_error("Invalid snapshot! Path: " + file.string());
+    }
+    _Root = std::string(_Strings, _Header->rootLength);
+}
+
+/**
+ * @brief Checks the header and every record of the mapped file, so the
+ *        walks over the records stay within it and end. Sets the
+ *        section pointers.
+ */
+bool Snapshot::valid()
+{
+    if (std::memcmp(_Header->magic, SnapshotMagic, sizeof(SnapshotMagic)) != 0
+        || _Header->version != SnapshotVersion || _Header->count == 0)
+        return false;
+
+    // the sizes are read from the file, nothing may overflow
+    auto remaining = _Length - sizeof(Header);
+    if (_Header->count > remaining / sizeof(Record))
+        return false;
+    remaining -= _Header->count * sizeof(Record);
+    if (_Header->hashCount > remaining / sizeof(HashRecord))
+        return false;
+    remaining -= _Header->hashCount * sizeof(HashRecord);
+    if (_Header->stringSize != remaining || _Header->rootLength > _Header->stringSize)
+        return false;
+
+    const auto records = sizeof(Header) + _Header->count * sizeof(Record);
+    _Records = reinterpret_cast<const Record*>(static_cast<const char*>(_Data) + sizeof(Header));
+    _Hashes = reinterpret_cast<const HashRecord*>(static_cast<const char*>(_Data) + records);
+    _Strings = static_cast<const char*>(_Data) + records + _Header->hashCount * sizeof(HashRecord);
+
+    const auto count = _Header->count;
+    if (_Records[0].subtree != count)
+        return false;
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto& record = _Records[i];
+        if (record.subtree == 0 || record.subtree > count - i)
+            return false;
+        if (static_cast<std::uint64_t>(record.name) + record.nameLength > _Header->stringSize)
+            return false;
+        if (i == 0)
+            continue;
+
+        // a single path component
+        const auto entry = std::string_view(_Strings + record.name, record.nameLength);
+        if (entry.empty() || entry == "." || entry == ".." || entry.find('/') != std::string_view::npos
+            || entry.find('\0') != std::string_view::npos)
+            return false;
+    }
+    return true;
+}
+
+Snapshot::~Snapshot()
+{
+    if (_Data)
+        munmap(_Data, _Length);
+}
+
+/**
+ * @brief Writes the model to a temporary file and renames it over the
+ *        snapshot, so a crash leaves either the old or the new one.
+ */
+void Snapshot::save(const TreeModel& model, const std::filesystem::path& file,
+    const std::vector<HashRecord>& hashes)
+{
+    std::vector<Record> records;
+    std::string strings;
+    {
+        std::shared_lock<std::shared_mutex> lock(model._Mutex);
+        strings = model._Root.string();
+
+        std::vector<std::size_t> parents;
+        std::vector<TreeModel::NodeId> stack { TreeModel::rootNode };
+        std::vector<std::size_t> stackParents { 0 };
+        while (!stack.empty()) {
+            const auto id = stack.back();
+            const auto parent = stackParents.back();
+            stack.pop_back();
+            stackParents.pop_back();
+
+            const auto& node = model._Nodes[id];
+            Record record {};
+            record.inode = node.inode;
+            record.size = node.size;
+            record.mtime = node.mtime;
+            record.type = static_cast<std::int8_t>(node.type);
+            record.subtree = 1;
+            if (id != TreeModel::rootNode) {
+                const auto name = model._Names.get(node.name);
+                record.name = static_cast<std::uint32_t>(strings.size());
+                record.nameLength = static_cast<std::uint16_t>(name.size());
+                strings.append(name);
+            }
+            parents.push_back(parent);
+            records.push_back(record);
+
+            const auto index = records.size() - 1;
+            for (std::uint32_t i = node.childCount; i > 0; --i) {
+                stack.push_back(model._Children[node.children + i - 1]);
+                stackParents.push_back(index);
+            }
+        }
+
+        // children come after their parent
+        for (std::size_t i = records.size() - 1; i > 0; --i)
+            records[parents[i]].subtree += records[i].subtree;
+    }
+
+    Header header {};
+    std::memcpy(header.magic, SnapshotMagic, sizeof(SnapshotMagic));
+    header.version = SnapshotVersion;
+    header.count = records.size();
+    header.stringSize = strings.size();
+    header.rootLength = model._Root.string().size();
+    header.hashCount = hashes.size();
+
+    auto temporary = file;
+    temporary += ".tmp";
+    const int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1)
+        throw snapshotError("Can't write snapshot!", temporary);
+
+    const auto write = [&](const void* data, std::size_t length) {
+        const char* current = static_cast<const char*>(data);
+        while (length > 0) {
+            const auto written = ::write(fd, current, length);
+            if (written == -1 && errno == EINTR)
+                continue;
+            if (written == -1) {
+                const auto error = snapshotError("Can't write snapshot!", temporary);
+                close(fd);
+                throw error;
+            }
+            current += written;
+            length -= static_cast<std::size_t>(written);
+        }
+    };
+    write(&header, sizeof(header));
+    write(records.data(), records.size() * sizeof(Record));
+    write(hashes.data(), hashes.size() * sizeof(HashRecord));
+    write(strings.data(), strings.size());
+
+    if (fsync(fd) == -1) {
+        const auto error = snapshotError("Can't write snapshot!", temporary);
+        close(fd);
+        throw error;
+    }
+    close(fd);
+
+    if (rename(temporary.c_str(), file.c_str()) == -1)
+        throw snapshotError("Can't write snapshot!", file);
+}
+
+const std::filesystem::path& Snapshot::root() const
+{
+    return _Root;
+}
+
+std::size_t Snapshot::size() const
+{
+    return _Header->count;
+}
+
+const Snapshot::Record& Snapshot::record(std::size_t index) const
+{
+    return _Records[index];
+}
+
+std::string_view Snapshot::name(std::size_t index) const
+{
+    return std::string_view(_Strings + _Records[index].name, _Records[index].nameLength);
+}
+
+std::size_t Snapshot::hashCount() const
+{
+    return _Header->hashCount;
+}
+
+const Snapshot::HashRecord& Snapshot::hash(std::size_t index) const
+{
+    return _Hashes[index];
+}
+
+void Snapshot::removed(std::size_t index, const std::filesystem::path& path, std::vector<FileSystemEvent>& events) const
+{
+    std::vector<std::pair<std::size_t, std::filesystem::path>> stack { { index, path } };
+    while (!stack.empty()) {
+        const auto current = std::move(stack.back());
+        stack.pop_back();
+        events.emplace_back(current.second, Event::delete_sub);
+
+        const auto end = current.first + _Records[current.first].subtree;
+        for (auto child = current.first + 1; child < end; child += _Records[child].subtree)
+            stack.emplace_back(child, current.second / name(child));
+    }
+}
+
+void Snapshot::created(const std::filesystem::path& path, std::vector<FileSystemEvent>& events)
+{
+    events.emplace_back(path, Event::create);
+
+    std::error_code error;
+    if (!std::filesystem::is_directory(std::filesystem::symlink_status(path, error)))
+        return;
+    for (auto it = std::filesystem::recursive_directory_iterator(path,
+             std::filesystem::directory_options::skip_permission_denied, error);
+         !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+        events.emplace_back(it->path(), Event::create);
+}
+
+void Snapshot::compare(std::size_t index, const std::filesystem::path& path, std::vector<Work>& next,
+    std::vector<FileSystemEvent>& events) const
+{
+    TreeModel::Stat live {};
+    if (!TreeModel::readStat(path, live)) {
+        removed(index, path, events);
+        return;
+    }
+
+    const auto& record = _Records[index];
+    if (static_cast<std::int8_t>(live.type) != record.type || live.inode != record.inode) {
+        removed(index, path, events);
+        created(path, events);
+        return;
+    }
+
+    if (live.type == std::filesystem::file_type::directory)
+        next.push_back({ index, path, live.mtime });
+    else if (live.size != record.size || live.mtime != record.mtime)
+        events.emplace_back(path, Event::modify);
+}
+
+/**
+ * @brief Compares the entries of a directory. The directory is only
+ *        read if its mtime changed, i.e. entries were added or removed.
+ */
+void Snapshot::diffDirectory(const Work& work, std::vector<Work>& next, std::vector<FileSystemEvent>& events) const
+{
+    const auto end = work.index + _Records[work.index].subtree;
+
+    if (work.mtime == _Records[work.index].mtime) {
+        for (auto child = work.index + 1; child < end; child += _Records[child].subtree)
+            compare(child, work.path / name(child), next, events);
+        return;
+    }
+
+    std::unordered_map<std::string_view, std::size_t> known;
+    for (auto child = work.index + 1; child < end; child += _Records[child].subtree)
+        known.emplace(name(child), child);
+
+    std::error_code error;
+    for (auto it = std::filesystem::directory_iterator(work.path, error);
+         !error && it != std::filesystem::directory_iterator(); it.increment(error)) {
+        const auto entryName = it->path().filename().string();
+        const auto found = known.find(entryName);
+        if (found == std::end(known)) {
+            created(it->path(), events);
+            continue;
+        }
+        compare(found->second, it->path(), next, events);
+        known.erase(found);
+    }
+
+    for (const auto& gone : known)
+        removed(gone.second, work.path / gone.first, events);
+}
+
+/**
+ * @brief Changes made since the snapshot was saved, sorted by path.
+ *
+ * @param threads comparing directories, 0 uses one per core
+ */
+std::vector<FileSystemEvent> Snapshot::diff(std::size_t threads) const
+{
+    std::vector<FileSystemEvent> events;
+    std::vector<Work> stack;
+    compare(0, _Root, stack, events);
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::size_t active = 0;
+
+    const auto worker = [&]() {
+        std::vector<FileSystemEvent> found;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [&]() { return !stack.empty() || active == 0; });
+            if (stack.empty())
+                break;
+
+            const auto work = std::move(stack.back());
+            stack.pop_back();
+            ++active;
+            lock.unlock();
+
+            std::vector<Work> next;
+            diffDirectory(work, next, found);
+
+            lock.lock();
+            --active;
+            std::move(std::begin(next), std::end(next), std::back_inserter(stack));
+            changed.notify_all();
+        }
+        std::move(std::begin(found), std::end(found), std::back_inserter(events));
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < threads; ++i)
+        workers.emplace_back(worker);
+    worker();
+    for (auto& thread : workers)
+        thread.join();
+
+    std::stable_sort(std::begin(events), std::end(events), [](const FileSystemEvent& a, const FileSystemEvent& b) {
+        return a.getPath() < b.getPath();
+    });
+    return events;
+}
+}
@@ -0,0 +1,181 @@
+#include <notify-cpp/stat_cache.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include <cerrno>
+#include <mutex>
+
+namespace notifycpp {
+
+namespace {
+    std::int64_t nanoseconds(const struct statx_timestamp& time)
+    {
+        return time.tv_sec * 1000000000LL + time.tv_nsec;
+    }
+
+    std::int64_t nanoseconds(const struct timespec& time)
+    {
+        return time.tv_sec * 1000000000LL + time.tv_nsec;
+    }
+
+    StatResult lookup(const std::string& path)
+    {
+        StatResult result;
+        struct statx buffer;
+        if (statx(AT_FDCWD, path.c_str(), AT_SYMLINK_NOFOLLOW, STATX_BASIC_STATS, &buffer) == 0) {
+            result.device = makedev(buffer.stx_dev_major, buffer.stx_dev_minor);
+            result.inode = buffer.stx_ino;
+            result.size = buffer.stx_size;
+            result.mode = buffer.stx_mode;
+            result.mtime = nanoseconds(buffer.stx_mtime);
+            result.ctime = nanoseconds(buffer.stx_ctime);
+            return result;
+        }
+        if (errno != ENOSYS) {
+            result.error = errno;
+            return result;
+        }
+
+        // kernels before 4.11
+        struct stat fallback;
+        if (lstat(path.c_str(), &fallback) == 0) {
+            result.device = fallback.st_dev;
+            result.inode = fallback.st_ino;
+            result.size = fallback.st_size;
+            result.mode = fallback.st_mode;
+            result.mtime = nanoseconds(fallback.st_mtim);
+            result.ctime = nanoseconds(fallback.st_ctim);
+        }
+        else {
+            result.error = errno;
+        }
+        return result;
+    }
+}
+
+StatCache::StatCache()
+    : _WorkingDirectory(std::filesystem::current_path())
+    , _Token(0)
+    , _Hits(0)
+    , _Misses(0)
+{
+}
+
+/**
+ * @brief Returns the cached metadata of the path, looks it up on a miss
+ */
+StatResult StatCache::stat(const std::filesystem::path& path)
+{
+    const auto name = key(path);
+    {
+        std::shared_lock<std::shared_mutex> lock(_Mutex);
+        const auto found = _Entries.find(name);
+        if (found != _Entries.end() && !found->second.pending) {
+            _Hits.fetch_add(1, std::memory_order_relaxed);
+            return found->second.result;
+        }
+    }
+    _Misses.fetch_add(1, std::memory_order_relaxed);
+
+    // an event invalidating the path during the lookup drops the pending
+    // entry, the result is then returned but not cached
+    std::uint64_t token;
+    {
+        std::unique_lock<std::shared_mutex> lock(_Mutex);
+        const auto inserted = _Entries.emplace(name, Entry{});
+        if (inserted.second)
+            _Paths.insert(name);
+        inserted.first->second.pending = true;
+        inserted.first->second.token = token = ++_Token;
+    }
+
+    const auto result = lookup(name);
+
+    std::unique_lock<std::shared_mutex> lock(_Mutex);
+    const auto found = _Entries.find(name);
+    if (found != _Entries.end() && found->second.pending && found->second.token == token) {
+        found->second.result = result;
+        found->second.pending = false;
+    }
+    return result;
+}
+
+void StatCache::invalidate(const FileSystemEvent& fse)
+{
+    const Event event = fse.getEvent();
+    if (intersects(event, Event::overflow)) {
+        clear();
+        return;
+    }
+
+    const Event structural = Event::create | Event::move | Event::delete_sub | Event::delete_self | Event::move_self
+        | Event::replaced;
+    const Event content = Event::modify | Event::attrib | Event::close_write;
+    if (!intersects(event, structural | content))
+        return;
+
+    const auto path = fse.getPath();
+    const auto name = key(path);
+
+    std::unique_lock<std::shared_mutex> lock(_Mutex);
+    erase(name);
+    if (intersects(event, structural)) {
+        // the parent gets a new mtime, entries below a moved or recreated
+        // directory are stale as well
+        eraseBelow(name);
+        erase(key(path.parent_path()));
+    }
+}
+
+/**
+ * @return events which change the metadata of a path, close_write and
+ *         replaced come with one of them
+ */
+Event StatCache::invalidatingEvents()
+{
+    return Event::modify | Event::attrib | Event::create | Event::move | Event::delete_sub | Event::delete_self
+        | Event::move_self;
+}
+
+void StatCache::clear()
+{
+    std::unique_lock<std::shared_mutex> lock(_Mutex);
+    _Entries.clear();
+    _Paths.clear();
+}
+
+StatCacheStatistics StatCache::getStatistics() const
+{
+    StatCacheStatistics statistics;
+    statistics.hits = _Hits.load(std::memory_order_relaxed);
+    statistics.misses = _Misses.load(std::memory_order_relaxed);
+    std::shared_lock<std::shared_mutex> lock(_Mutex);
+    statistics.entries = _Entries.size();
+    return statistics;
+}
+
+std::string StatCache::key(const std::filesystem::path& path) const
+{
+    if (path.is_absolute())
+        return path.native();
+    return (_WorkingDirectory / path).native();
+}
+
+void StatCache::erase(const std::string& name)
+{
+    if (_Entries.erase(name))
+        _Paths.erase(name);
+}
+
+void StatCache::eraseBelow(const std::string& name)
+{
+    const auto prefix = name.back() == '/' ? name : name + '/';
+    auto it = _Paths.lower_bound(prefix);
+    while (it != _Paths.end() && it->compare(0, prefix.size(), prefix) == 0) {
+        _Entries.erase(*it);
+        it = _Paths.erase(it);
+    }
+}
+}
@@ -0,0 +1,84 @@
+#include <notify-cpp/string_table.h>
+
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+namespace notifycpp {
+
+StringTable::StringTable()
+    : _Offsets { 0 }
+    , _Slots(16, npos)
+{
+}
+
+/**
+ * @return slot holding the string or the free slot it belongs into
+ */
+std::size_t StringTable::probe(std::string_view s, std::size_t hash) const
+{
+    const std::size_t mask = _Slots.size() - 1;
+    for (std::size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        const Id id = _Slots[slot];
+        if (id == npos || get(id) == s)
+            return slot;
+    }
+}
+
+void StringTable::grow()
+{
+    std::vector<Id> slots(_Slots.size() * 2, npos);
+    _Slots.swap(slots);
+
+    const std::size_t mask = _Slots.size() - 1;
+    for (Id id = 0; id < size(); ++id) {
+        std::size_t slot = std::hash<std::string_view>()(get(id)) & mask;
+        while (_Slots[slot] != npos)
+            slot = (slot + 1) & mask;
+        _Slots[slot] = id;
+    }
+}
+
+StringTable::Id StringTable::intern(std::string_view s)
+{
+    const std::size_t hash = std::hash<std::string_view>()(s);
+    std::size_t slot = probe(s, hash);
+    if (_Slots[slot] != npos)
+        return _Slots[slot];
+
+    if (_Arena.size() + s.size() > std::numeric_limits<std::uint32_t>::max())
+        throw std::length_error("String table is full");
+
+    const Id id = static_cast<Id>(size());
+    _Arena.insert(std::end(_Arena), std::begin(s), std::end(s));
+    _Offsets.push_back(static_cast<std::uint32_t>(_Arena.size()));
+
+    // keep the load factor below 1/2
+    if ((size() + 1) * 2 > _Slots.size()) {
+        grow();
+        slot = probe(s, hash);
+    }
+    _Slots[slot] = id;
+    return id;
+}
+
+StringTable::Id StringTable::find(std::string_view s) const
+{
+    return _Slots[probe(s, std::hash<std::string_view>()(s))];
+}
+
+std::string_view StringTable::get(Id id) const
+{
+    return std::string_view(_Arena.data() + _Offsets[id], _Offsets[id + 1] - _Offsets[id]);
+}
+
+std::size_t StringTable::size() const
+{
+    return _Offsets.size() - 1;
+}
+
+std::size_t StringTable::memoryUsage() const
+{
+    return _Arena.capacity() + _Offsets.capacity() * sizeof(std::uint32_t) + _Slots.capacity() * sizeof(Id);
+}
+}
@@ -0,0 +1,108 @@
+#include <notify-cpp/thread_pool.h>
+
+#include <algorithm>
+
+namespace notifycpp {
+
+ThreadPool::ThreadPool(std::size_t threads, std::size_t capacity)
+    : _Active(0)
+    , _Capacity(capacity)
+    , _Stopped(false)
+{
+    threads = std::max<std::size_t>(threads, 1);
+    _Threads.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        _Threads.emplace_back([this]() { work(); });
+        _Workers.push_back(_Threads.back().get_id());
+    }
+}
+
+/**
+ * @brief Must not be called by a worker, it can't join itself
+ */
+ThreadPool::~ThreadPool()
+{
+    join();
+}
+
+/**
+ * @return false if the queue is full or the pool joined and the task
+ *         was dropped
+ */
+bool ThreadPool::post(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        if (_Stopped || (_Capacity != 0 && _Tasks.size() >= _Capacity))
+            return false;
+        _Tasks.push_back(std::move(task));
+    }
+    _Condition.notify_one();
+    return true;
+}
+
+/**
+ * @brief Waits until the queued tasks are finished, the pool keeps
+ *        accepting tasks. Returns immediately on a worker, which would
+ *        wait for itself.
+ */
+void ThreadPool::drain()
+{
+    if (isWorker())
+        return;
+
+    std::unique_lock<std::mutex> lock(_Mutex);
+    _Idle.wait(lock, [this]() { return _Tasks.empty() && _Active == 0; });
+}
+
+/**
+ * @brief Finishes the queued tasks and ends the workers. A worker
+ *        calling this doesn't wait for itself.
+ */
+void ThreadPool::join()
+{
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        _Stopped = true;
+    }
+    _Condition.notify_all();
+    for (auto& thread : _Threads)
+        if (thread.joinable() && thread.get_id() != std::this_thread::get_id())
+            thread.join();
+}
+
+/**
+ * @return true if called by one of the workers
+ */
+bool ThreadPool::isWorker() const
+{
+    return std::find(_Workers.begin(), _Workers.end(), std::this_thread::get_id()) != _Workers.end();
+}
+
+std::size_t ThreadPool::size() const
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    return _Tasks.size();
+}
+
+void ThreadPool::work()
+{
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_Mutex);
+            _Condition.wait(lock, [this]() { return _Stopped || !_Tasks.empty(); });
+            if (_Tasks.empty())
+                return;
+            task = std::move(_Tasks.front());
+            _Tasks.pop_front();
+            ++_Active;
+        }
+        task();
+
+        std::lock_guard<std::mutex> lock(_Mutex);
+        if (--_Active == 0 && _Tasks.empty())
+            _Idle.notify_all();
+    }
+}
+}
@@ -0,0 +1,134 @@
+#include <notify-cpp/timing_wheel.h>
+
+#include <algorithm>
+
+namespace notifycpp {
+
+TimingWheel::TimingWheel(std::chrono::milliseconds tick, Clock::time_point now)
+    : _Tick(std::max<Clock::duration>(tick, std::chrono::milliseconds(1)))
+    , _Start(now)
+    , _Current(0)
+    , _Size(0)
+{
+}
+
+std::uint64_t TimingWheel::toTick(Clock::time_point t) const
+{
+    if (t <= _Start)
+        return 0;
+    // round up, a timer never fires before its deadline
+    return static_cast<std::uint64_t>((t - _Start + _Tick - Clock::duration(1)) / _Tick);
+}
+
+TimingWheel::Clock::time_point TimingWheel::toTimePoint(std::uint64_t tick) const
+{
+    return _Start + _Tick * tick;
+}
+
+void TimingWheel::insert(const Timer& timer)
+{
+    std::size_t level = 0;
+    while (level + 1 < Levels
+        && (timer.expiry >> (SlotBits * (level + 1))) != (_Current >> (SlotBits * (level + 1))))
+        ++level;
+    const auto slot = (timer.expiry >> (SlotBits * level)) & (Slots - 1);
+    _Wheel[level][slot].push_back(timer);
+}
+
+/**
+ * @brief Schedules a timer. A deadline in the past expires with the
+ *        next call to advance().
+ */
+void TimingWheel::schedule(std::uint64_t id, Clock::time_point deadline)
+{
+    insert({ id, std::max(toTick(deadline), _Current + 1) });
+    ++_Size;
+}
+
+void TimingWheel::cascade(std::size_t level)
+{
+    auto& slot = _Wheel[level][(_Current >> (SlotBits * level)) & (Slots - 1)];
+    std::vector<Timer> timers;
+    timers.swap(slot);
+    for (const auto& timer : timers)
+        insert(timer);
+}
+
+/**
+ * @brief Moves the wheel to now and appends the ids of all expired
+ *        timers.
+ */
+void TimingWheel::advance(Clock::time_point now, std::vector<std::uint64_t>& expired)
+{
+    const std::uint64_t target = now <= _Start ? 0 : static_cast<std::uint64_t>((now - _Start) / _Tick);
+    while (_Current < target) {
+        if (_Size == 0) {
+            _Current = target;
+            return;
+        }
+
+        ++_Current;
+        for (std::size_t level = Levels - 1; level > 0; --level)
+            if ((_Current & ((std::uint64_t(1) << (SlotBits * level)) - 1)) == 0)
+                cascade(level);
+
+        auto& slot = _Wheel[0][_Current & (Slots - 1)];
+        std::vector<Timer> timers;
+        timers.swap(slot);
+        for (const auto& timer : timers) {
+            if (timer.expiry <= _Current) {
+                expired.push_back(timer.id);
+                --_Size;
+            }
+            else {
+                // beyond the range of the wheel
+                insert(timer);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Removes all timers without moving the wheel and appends
+ *        their ids.
+ */
+void TimingWheel::clear(std::vector<std::uint64_t>& expired)
+{
+    for (auto& level : _Wheel) {
+        for (auto& slot : level) {
+            for (const auto& timer : slot)
+                expired.push_back(timer.id);
+            slot.clear();
+        }
+    }
+    _Size = 0;
+}
+
+/**
+ * @return time of the next expiring timer, or of the next cascade of
+ *         the upper levels if the lowest level is empty
+ */
+TimingWheel::Clock::time_point TimingWheel::nextExpiry() const
+{
+    if (_Size == 0)
+        return Clock::time_point::max();
+
+    for (std::uint64_t tick = _Current + 1; tick <= _Current + Slots; ++tick) {
+        if (!_Wheel[0][tick & (Slots - 1)].empty())
+            return toTimePoint(tick);
+        if ((tick & (Slots - 1)) == 0)
+            return toTimePoint(tick);
+    }
+    return toTimePoint(_Current + Slots);
+}
+
+bool TimingWheel::empty() const
+{
+    return _Size == 0;
+}
+
+std::size_t TimingWheel::size() const
+{
+    return _Size;
+}
+}
@@ -0,0 +1,507 @@
+#include <notify-cpp/snapshot.h>
+#include <notify-cpp/tree_model.h>
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+namespace notifycpp {
+
+TreeModel::TreeModel(const std::filesystem::path& root)
+    : _Root((root / "").lexically_normal().parent_path())
+    , _Wasted(0)
+    , _MovedFrom(npos)
+    , _MovedFromCookie(0)
+{
+    _Nodes.push_back({ npos, StringTable::npos, 0, 0, 0, std::filesystem::file_type::directory, 0, 0, 0 });
+}
+
+bool TreeModel::readStat(const std::filesystem::path& path, Stat& stat)
+{
+    struct stat st;
+    if (::lstat(path.c_str(), &st) == -1)
+        return false;
+
+    if (S_ISDIR(st.st_mode))
+        stat.type = std::filesystem::file_type::directory;
+    else if (S_ISREG(st.st_mode))
+        stat.type = std::filesystem::file_type::regular;
+    else if (S_ISLNK(st.st_mode))
+        stat.type = std::filesystem::file_type::symlink;
+    else if (S_ISFIFO(st.st_mode))
+        stat.type = std::filesystem::file_type::fifo;
+    else if (S_ISSOCK(st.st_mode))
+        stat.type = std::filesystem::file_type::socket;
+    else if (S_ISBLK(st.st_mode))
+        stat.type = std::filesystem::file_type::block;
+    else if (S_ISCHR(st.st_mode))
+        stat.type = std::filesystem::file_type::character;
+    else
+        stat.type = std::filesystem::file_type::unknown;
+
+    stat.size = static_cast<std::uint64_t>(st.st_size);
+    stat.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    stat.inode = static_cast<std::uint64_t>(st.st_ino);
+    return true;
+}
+
+/**
+ * @brief Reads an entry and, if it is a directory, everything below
+ *        it. Parents come before their children.
+ */
+std::vector<TreeModel::Stat> TreeModel::read(const std::filesystem::path& relative) const
+{
+    std::vector<Stat> stats;
+    const auto absolute = _Root / relative;
+
+    Stat stat { relative, std::filesystem::file_type::none, 0, 0, 0 };
+    if (!readStat(absolute, stat))
+        return stats;
+    stats.push_back(stat);
+    if (stat.type != std::filesystem::file_type::directory)
+        return stats;
+
+    std::error_code error;
+    for (auto it = std::filesystem::recursive_directory_iterator(absolute,
+             std::filesystem::directory_options::skip_permission_denied, error);
+         !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+        Stat child { relative / it->path().lexically_relative(absolute), std::filesystem::file_type::none, 0, 0, 0 };
+        if (readStat(it->path(), child))
+            stats.push_back(child);
+    }
+    return stats;
+}
+
+/**
+ * @return path relative to the rootNode, ".." for paths outside of it
+ */
+std::filesystem::path TreeModel::relative(const std::filesystem::path& path) const
+{
+    const auto normal = path.lexically_normal();
+    if (normal == _Root)
+        return {};
+    const auto result = normal.lexically_relative(_Root);
+    if (result.empty() || *result.begin() == "..")
+        return "..";
+    return result;
+}
+
+TreeModel::NodeId TreeModel::child(NodeId parent, StringTable::Id name) const
+{
+    const auto& node = _Nodes[parent];
+    const auto first = std::begin(_Children) + node.children;
+    const auto last = first + node.childCount;
+    const auto found = std::lower_bound(first, last, name,
+        [this](NodeId id, StringTable::Id n) { return _Nodes[id].name < n; });
+    return found != last && _Nodes[*found].name == name ? *found : npos;
+}
+
+TreeModel::NodeId TreeModel::lookup(const std::filesystem::path& relative) const
+{
+    if (relative == "..")
+        return npos;
+
+    NodeId current = rootNode;
+    for (const auto& component : relative) {
+        const std::string name = component.string();
+        if (name.empty() || name == ".")
+            continue;
+        const auto id = _Names.find(name);
+        if (id == StringTable::npos)
+            return npos;
+        current = child(current, id);
+        if (current == npos)
+            return npos;
+    }
+    return current;
+}
+
+/**
+ * @brief Inserts the child at its sorted position. A full range is
+ *        moved to the end of _Children with twice the capacity.
+ */
+void TreeModel::link(NodeId parent, NodeId id)
+{
+    _Nodes[id].parent = parent;
+
+    auto& node = _Nodes[parent];
+    if (node.childCount == node.childCapacity) {
+        const std::uint32_t capacity = std::max<std::uint32_t>(4, node.childCapacity * 2);
+        const auto offset = static_cast<std::uint32_t>(_Children.size());
+        _Children.resize(_Children.size() + capacity, npos);
+        std::copy_n(std::begin(_Children) + node.children, node.childCount, std::begin(_Children) + offset);
+        _Wasted += node.childCapacity;
+        node.children = offset;
+        node.childCapacity = capacity;
+    }
+
+    const auto first = std::begin(_Children) + node.children;
+    const auto last = first + node.childCount;
+    const auto name = _Nodes[id].name;
+    const auto position = std::lower_bound(first, last, name,
+        [this](NodeId other, StringTable::Id n) { return _Nodes[other].name < n; });
+    std::copy_backward(position, last, last + 1);
+    *position = id;
+    ++node.childCount;
+}
+
+void TreeModel::unlink(NodeId id)
+{
+    const NodeId parent = _Nodes[id].parent;
+    if (parent == npos)
+        return;
+
+    auto& node = _Nodes[parent];
+    const auto first = std::begin(_Children) + node.children;
+    const auto last = first + node.childCount;
+    const auto position = std::find(first, last, id);
+    if (position == last)
+        return;
+    std::copy(position + 1, last, position);
+    --node.childCount;
+    _Nodes[id].parent = npos;
+}
+
+/**
+ * @brief Adds or updates the entry, its parent has to exist.
+ */
+TreeModel::NodeId TreeModel::insert(const Stat& stat)
+{
+    if (stat.relative.empty()) {
+        _Nodes[rootNode].size = stat.size;
+        _Nodes[rootNode].mtime = stat.mtime;
+        _Nodes[rootNode].inode = stat.inode;
+        return rootNode;
+    }
+
+    const NodeId parent = lookup(stat.relative.parent_path());
+    if (parent == npos || _Nodes[parent].type != std::filesystem::file_type::directory)
+        return npos;
+
+    const auto name = _Names.intern(stat.relative.filename().string());
+    NodeId id = child(parent, name);
+    if (id != npos) {
+        if (_Nodes[id].type == std::filesystem::file_type::directory && stat.type != std::filesystem::file_type::directory) {
+            erase(id);
+            id = npos;
+        }
+        else {
+            _Nodes[id].type = stat.type;
+            _Nodes[id].size = stat.size;
+            _Nodes[id].mtime = stat.mtime;
+            _Nodes[id].inode = stat.inode;
+            return id;
+        }
+    }
+
+    const Node node { npos, name, 0, 0, 0, stat.type, stat.size, stat.mtime, stat.inode };
+    if (_Free.empty()) {
+        id = static_cast<NodeId>(_Nodes.size());
+        _Nodes.push_back(node);
+    }
+    else {
+        id = _Free.back();
+        _Free.pop_back();
+        _Nodes[id] = node;
+    }
+    link(parent, id);
+    return id;
+}
+
+/**
+ * @brief Removes the entry with everything below it. The rootNode itself
+ *        stays, only its children are removed.
+ */
+void TreeModel::erase(NodeId id)
+{
+    std::vector<NodeId> stack;
+    if (id == rootNode) {
+        const auto& node = _Nodes[rootNode];
+        stack.assign(std::begin(_Children) + node.children, std::begin(_Children) + node.children + node.childCount);
+        _Nodes[rootNode].childCount = 0;
+    }
+    else {
+        unlink(id);
+        stack.push_back(id);
+    }
+
+    while (!stack.empty()) {
+        const NodeId current = stack.back();
+        stack.pop_back();
+
+        const auto& node = _Nodes[current];
+        stack.insert(std::end(stack), std::begin(_Children) + node.children,
+            std::begin(_Children) + node.children + node.childCount);
+        _Wasted += node.childCapacity;
+        if (current == _MovedFrom)
+            _MovedFrom = npos;
+        _Nodes[current] = { npos, StringTable::npos, 0, 0, 0, std::filesystem::file_type::none, 0, 0, 0 };
+        _Free.push_back(current);
+    }
+
+    compact();
+}
+
+/**
+ * @brief Rewrites _Children without unused slots once more than half
+ *        of it is unused.
+ */
+void TreeModel::compact()
+{
+    if (_Wasted < 1024 || _Wasted * 2 < _Children.size())
+        return;
+
+    std::vector<NodeId> children;
+    children.reserve(_Children.size() - _Wasted);
+    for (auto& node : _Nodes) {
+        if (node.childCapacity == 0)
+            continue;
+        const auto offset = static_cast<std::uint32_t>(children.size());
+        children.insert(std::end(children), std::begin(_Children) + node.children,
+            std::begin(_Children) + node.children + node.childCount);
+        children.resize(offset + node.childCount + node.childCount / 4, npos);
+        node.children = offset;
+        node.childCapacity = static_cast<std::uint32_t>(children.size()) - offset;
+    }
+    _Children.swap(children);
+    _Wasted = 0;
+}
+
+/**
+ * @brief A moved_from not followed by its moved_to left the tree.
+ */
+void TreeModel::settleMove()
+{
+    if (_MovedFrom != npos)
+        erase(_MovedFrom);
+    _MovedFrom = npos;
+}
+
+/**
+ * @brief Reads the whole tree, replacing the current content.
+ */
+void TreeModel::scan()
+{
+    const auto stats = read({});
+
+    std::unique_lock<std::shared_mutex> lock(_Mutex);
+    erase(rootNode);
+    _MovedFrom = npos;
+    for (const auto& stat : stats)
+        insert(stat);
+}
+
+/**
+ * @brief Replaces the content with the snapshot without touching the
+ *        file system. Changes made since the snapshot was taken have
+ *        to be applied separately, see Snapshot::diff().
+ */
+void TreeModel::load(const Snapshot& snapshot)
+{
+    if (snapshot.root() != _Root)
+        throw std::invalid_argument("Snapshot of another tree! Path: " + snapshot.root().string());
+
+    std::unique_lock<std::shared_mutex> lock(_Mutex);
+    erase(rootNode);
+    _MovedFrom = npos;
+
+    const auto& first = snapshot.record(0);
+    _Nodes[rootNode].size = first.size;
+    _Nodes[rootNode].mtime = first.mtime;
+    _Nodes[rootNode].inode = first.inode;
+
+    // directories whose subtree is still being read: node and end of the subtree
+    std::vector<std::pair<NodeId, std::size_t>> parents { { rootNode, first.subtree } };
+    for (std::size_t index = 1; index < snapshot.size(); ++index) {
+        while (index >= parents.back().second)
+            parents.pop_back();
+
+        const auto& record = snapshot.record(index);
+        const Node node { npos, _Names.intern(snapshot.name(index)), 0, 0, 0,
+            static_cast<std::filesystem::file_type>(record.type), record.size, record.mtime, record.inode };
+        NodeId id;
+        if (_Free.empty()) {
+            id = static_cast<NodeId>(_Nodes.size());
+            _Nodes.push_back(node);
+        }
+        else {
+            id = _Free.back();
+            _Free.pop_back();
+            _Nodes[id] = node;
+        }
+        link(parents.back().first, id);
+
+        if (record.subtree > 1)
+            parents.emplace_back(id, index + record.subtree);
+    }
+}
+
+void TreeModel::apply(const FileSystemEvent& fse)
+{
+    const auto path = relative(fse.getPath());
+    if (path == "..")
+        return;
+
+    const Event event = fse.getEvent();
+    const std::uint32_t cookie = fse.getCookie();
+
+    {
+        std::unique_lock<std::shared_mutex> lock(_Mutex);
+        if (event == Event::moved_to && cookie != 0 && _MovedFrom != npos && cookie == _MovedFromCookie) {
+            const NodeId moved = _MovedFrom;
+            _MovedFrom = npos;
+
+            const NodeId parent = lookup(path.parent_path());
+            if (parent == npos) {
+                erase(moved);
+                return;
+            }
+            const auto name = _Names.intern(path.filename().string());
+            const NodeId replaced = child(parent, name);
+            if (replaced != npos && replaced != moved)
+                erase(replaced);
+            unlink(moved);
+            _Nodes[moved].name = name;
+            link(parent, moved);
+            return;
+        }
+
+        settleMove();
+
+        if (intersects(event, Event::moved_from)) {
+            const NodeId moved = lookup(path);
+            if (moved != npos && moved != rootNode) {
+                _MovedFrom = moved;
+                _MovedFromCookie = cookie;
+                if (cookie == 0)
+                    settleMove();
+            }
+            return;
+        }
+
+        if (intersects(event, Event::delete_sub | Event::delete_self)) {
+            const NodeId removed = lookup(path);
+            if (removed != npos)
+                erase(removed);
+            return;
+        }
+    }
+
+    if (intersects(event, Event::create | Event::moved_to)) {
+        const auto stats = read(path);
+        std::unique_lock<std::shared_mutex> lock(_Mutex);
+        for (const auto& stat : stats)
+            insert(stat);
+        return;
+    }
+
+    if (intersects(event, Event::modify | Event::attrib | Event::close_write)) {
+        Stat stat { path, std::filesystem::file_type::none, 0, 0, 0 };
+        if (!readStat(_Root / path, stat))
+            return;
+        std::unique_lock<std::shared_mutex> lock(_Mutex);
+        const NodeId id = lookup(path);
+        if (id != npos) {
+            _Nodes[id].size = stat.size;
+            _Nodes[id].mtime = stat.mtime;
+            _Nodes[id].inode = stat.inode;
+        }
+    }
+}
+
+TreeModel::Entry TreeModel::entry(NodeId id) const
+{
+    const auto& node = _Nodes[id];
+    const auto name = id == rootNode ? _Root.filename().string() : std::string(_Names.get(node.name));
+    return { name, node.type, node.size, node.mtime, node.inode };
+}
+
+std::optional<TreeModel::Entry> TreeModel::stat(const std::filesystem::path& path) const
+{
+    std::shared_lock<std::shared_mutex> lock(_Mutex);
+    const NodeId id = lookup(relative(path));
+    if (id == npos)
+        return std::nullopt;
+    return entry(id);
+}
+
+/**
+ * @return entries of the directory, sorted by interned name id and
+ *         not alphabetically
+ */
+std::vector<TreeModel::Entry> TreeModel::list(const std::filesystem::path& path) const
+{
+    std::shared_lock<std::shared_mutex> lock(_Mutex);
+    std::vector<Entry> entries;
+    const NodeId id = lookup(relative(path));
+    if (id == npos)
+        return entries;
+
+    const auto& node = _Nodes[id];
+    entries.reserve(node.childCount);
+    for (std::uint32_t i = 0; i < node.childCount; ++i)
+        entries.push_back(entry(_Children[node.children + i]));
+    return entries;
+}
+
+std::size_t TreeModel::count(const std::filesystem::path& path, bool recursive) const
+{
+    std::shared_lock<std::shared_mutex> lock(_Mutex);
+    const NodeId id = lookup(relative(path));
+    if (id == npos)
+        return 0;
+    if (!recursive)
+        return _Nodes[id].childCount;
+
+    std::size_t result = 0;
+    std::vector<NodeId> stack { id };
+    while (!stack.empty()) {
+        const auto& node = _Nodes[stack.back()];
+        stack.pop_back();
+        result += node.childCount;
+        stack.insert(std::end(stack), std::begin(_Children) + node.children,
+            std::begin(_Children) + node.children + node.childCount);
+    }
+    return result;
+}
+
+/**
+ * @brief Calls the visitor for every entry below the path, parents
+ *        before their children. The visitor must not modify the model.
+ */
+void TreeModel::walk(const std::filesystem::path& path, const Visitor& visitor) const
+{
+    std::shared_lock<std::shared_mutex> lock(_Mutex);
+    const auto start = relative(path);
+    const NodeId id = lookup(start);
+    if (id == npos)
+        return;
+
+    std::vector<std::pair<NodeId, std::filesystem::path>> stack { { id, start.empty() ? _Root : _Root / start } };
+    while (!stack.empty()) {
+        const auto current = std::move(stack.back());
+        stack.pop_back();
+
+        const auto& node = _Nodes[current.first];
+        for (std::uint32_t i = node.childCount; i > 0; --i) {
+            const NodeId childId = _Children[node.children + i - 1];
+            stack.emplace_back(childId, current.second / std::string(_Names.get(_Nodes[childId].name)));
+        }
+        if (current.first != id)
+            visitor(current.second, entry(current.first));
+    }
+}
+
+const std::filesystem::path& TreeModel::root() const
+{
+    return _Root;
+}
+
+std::size_t TreeModel::size() const
+{
+    std::shared_lock<std::shared_mutex> lock(_Mutex);
+    return _Nodes.size() - _Free.size() - 1;
+}
+}
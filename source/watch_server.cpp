@@ -0,0 +1,438 @@
+#include <notify-cpp/watch_server.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <grp.h>
+#include <poll.h>
+#include <pwd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace notifycpp {
+
+namespace {
+    //! input of a client not yet decoded, a subscription frame takes a path
+    const std::size_t InputLimit = 64 * 1024;
+
+    bool isBelow(const std::filesystem::path& root, const std::filesystem::path& path)
+    {
+        return std::mismatch(root.begin(), root.end(), path.begin(), path.end()).first == root.end();
+    }
+
+    //! the primary group and the groups the user is a member of
+    std::vector<gid_t> groupsOf(uid_t uid, gid_t gid)
+    {
+        std::vector<gid_t> groups { gid };
+        struct passwd entry;
+        struct passwd* user = nullptr;
+        std::vector<char> buffer(16384);
+        if (getpwuid_r(uid, &entry, buffer.data(), buffer.size(), &user) != 0 || !user)
+            return groups;
+
+        int count = 64;
+        std::vector<gid_t> list(static_cast<std::size_t>(count));
+        if (getgrouplist(user->pw_name, gid, list.data(), &count) == -1) {
+            list.resize(static_cast<std::size_t>(count));
+            if (getgrouplist(user->pw_name, gid, list.data(), &count) == -1)
+                return groups;
+        }
+        groups.insert(std::end(groups), std::begin(list), std::begin(list) + count);
+        return groups;
+    }
+
+    //! mode bits of the class the user belongs to, see access(2)
+    bool permits(const struct stat& st, uid_t uid, const std::vector<gid_t>& groups, mode_t wanted)
+    {
+        mode_t bits = st.st_mode & 7;
+        if (st.st_uid == uid)
+            bits = (st.st_mode >> 6) & 7;
+        else if (std::find(std::begin(groups), std::end(groups), st.st_gid) != std::end(groups))
+            bits = (st.st_mode >> 3) & 7;
+        return (bits & wanted) == wanted;
+    }
+}
+
+WatchServer::WatchServer(const std::filesystem::path& socket, std::size_t clientBufferLimit)
+    : _Socket(socket)
+    , _ClientBufferLimit(clientBufferLimit)
+    , _Listen(-1)
+    , _Wake(-1)
+    , _Stopped(false)
+{
+    struct sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if (socket.native().size() >= sizeof(address.sun_path))
+        throw std::invalid_argument("Socket path too long: " + socket.string());
+    std::strncpy(address.sun_path, socket.c_str(), sizeof(address.sun_path) - 1);
+
+    std::filesystem::remove(socket);
+    _Listen = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    _Wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_Listen == -1 || _Wake == -1
+        || bind(_Listen, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1
+        || listen(_Listen, SOMAXCONN) == -1) {
+        std::stringstream errorStream;
+        errorStream << "Can't listen on socket! " << strerror(errno) << ". Path: " << socket;
+        if (_Listen != -1)
+            close(_Listen);
+        if (_Wake != -1)
+            close(_Wake);
+        throw std::runtime_error(errorStream.str());
+    }
+
+    std::set<Event> events { Event::overflow };
+    for (auto event = static_cast<std::uint32_t>(Event::access); event < static_cast<std::uint32_t>(Event::none); event <<= 1)
+        events.insert(static_cast<Event>(event));
+    _Controller.onEvents(events, [this](Notification notification) { onNotification(notification); });
+}
+
+WatchServer::~WatchServer()
+{
+    stop();
+    if (_EventLoop.joinable())
+        _EventLoop.join();
+
+    for (const auto& client : _Clients)
+        close(client->fd);
+    close(_Listen);
+    close(_Wake);
+    std::filesystem::remove(_Socket);
+}
+
+void WatchServer::stop()
+{
+    _Stopped = true;
+    _Controller.stop();
+    wake();
+}
+
+void WatchServer::wake()
+{
+    const std::uint64_t one = 1;
+    if (write(_Wake, &one, sizeof(one)) == -1) {
+        // the counter is already set
+    }
+}
+
+std::size_t WatchServer::roots() const
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    return _Roots.size();
+}
+
+/**
+ * @brief Serves clients until stop() is called, the event loop runs
+ *        in a thread of its own meanwhile.
+ */
+void WatchServer::run()
+{
+    _EventLoop = std::thread([this]() { _Controller.run(); });
+
+    std::vector<struct pollfd> fds;
+    while (!_Stopped) {
+        fds.clear();
+        fds.push_back({ _Listen, POLLIN, 0 });
+        fds.push_back({ _Wake, POLLIN, 0 });
+        {
+            std::lock_guard<std::mutex> lock(_Mutex);
+            for (const auto& client : _Clients)
+                fds.push_back({ client->fd, static_cast<short>(POLLIN | (client->output.empty() ? 0 : POLLOUT)), 0 });
+        }
+
+        if (poll(fds.data(), fds.size(), -1) <= 0)
+            continue;
+
+        if (fds[0].revents & POLLIN)
+            accept();
+
+        if (fds[1].revents & POLLIN) {
+            std::uint64_t count;
+            if (read(_Wake, &count, sizeof(count)) == -1) {
+                // nothing to read
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(_Mutex);
+        for (auto it = std::begin(_Clients); it != std::end(_Clients);) {
+            auto& client = **it;
+            const auto polled = std::find_if(std::begin(fds) + 2, std::end(fds),
+                [&](const struct pollfd& fd) { return fd.fd == client.fd; });
+            const bool readable = polled != std::end(fds) && (polled->revents & (POLLIN | POLLHUP | POLLERR));
+
+            if ((readable && !receive(client)) || !flush(client)) {
+                close(client.fd);
+                for (const auto& subscribed : client.subscriptions)
+                    release(subscribed);
+                it = _Clients.erase(it);
+                updateRoots();
+                continue;
+            }
+            ++it;
+        }
+    }
+
+    _Controller.stop();
+    _EventLoop.join();
+}
+
+/**
+ * @brief Accepts a client, a client whose credentials can't be read
+ *        is closed again.
+ */
+void WatchServer::accept()
+{
+    const int fd = accept4(_Listen, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd == -1)
+        return;
+
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == -1 || length != sizeof(credentials)) {
+        close(fd);
+        return;
+    }
+    auto groups = groupsOf(credentials.uid, credentials.gid);
+
+    std::lock_guard<std::mutex> lock(_Mutex);
+    _Clients.push_back(std::make_unique<Client>(Client { fd, credentials.uid, std::move(groups), {}, {}, {}, 0, {} }));
+}
+
+/**
+ * @brief Checks that the user of the client may read the path and
+ *        search every directory above it. The path is resolved, no
+ *        symlink or .. leads past a directory the user can't search.
+ *
+ * @param path replaced by the resolved path the watch is added for
+ */
+bool WatchServer::mayAccess(const Client& client, std::filesystem::path& path) const
+{
+    std::error_code error;
+    const auto resolved = std::filesystem::canonical(path, error);
+    if (error)
+        return false;
+    path = resolved;
+    if (client.uid == 0)
+        return true;
+
+    struct stat st;
+    std::filesystem::path current;
+    for (const auto& component : resolved.parent_path()) {
+        current /= component;
+        if (lstat(current.c_str(), &st) == -1 || !S_ISDIR(st.st_mode) || !permits(st, client.uid, client.groups, S_IXOTH))
+            return false;
+    }
+    if (lstat(resolved.c_str(), &st) == -1)
+        return false;
+    return permits(st, client.uid, client.groups, S_ISDIR(st.st_mode) ? S_IROTH | S_IXOTH : S_IROTH);
+}
+
+/**
+ * @brief Reads and applies the subscriptions sent by the client. Called
+ *        with _Mutex held.
+ *
+ * @return false if the client is gone
+ */
+bool WatchServer::receive(Client& client)
+{
+    char buffer[4096];
+    const auto length = read(client.fd, buffer, sizeof(buffer));
+    if (length == 0)
+        return false;
+    if (length == -1)
+        return errno == EAGAIN || errno == EINTR;
+
+    client.input.append(buffer, static_cast<std::size_t>(length));
+    std::string_view input(client.input);
+    remote::FrameType type;
+    std::string_view payload;
+    bool changed = false;
+    try {
+        while (remote::decodeFrame(input, type, payload)) {
+            if (type == remote::FrameType::subscribe) {
+                auto subscription = remote::decodeSubscribe(payload);
+                if (!mayAccess(client, subscription.path))
+                    continue;
+                subscribe(client, std::move(subscription));
+                changed = true;
+            }
+            else if (type == remote::FrameType::unsubscribe) {
+                const auto id = remote::decodeUnsubscribe(payload);
+                const auto unsubscribed = std::stable_partition(std::begin(client.subscriptions), std::end(client.subscriptions),
+                    [id](const Subscribed& subscribed) { return subscribed.subscription.id != id; });
+                for (auto it = unsubscribed; it != std::end(client.subscriptions); ++it)
+                    release(*it);
+                changed = changed || unsubscribed != std::end(client.subscriptions);
+                client.subscriptions.erase(unsubscribed, std::end(client.subscriptions));
+            }
+        }
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    if (changed)
+        updateRoots();
+    client.input.erase(0, client.input.size() - input.size());
+    return client.input.size() <= InputLimit;
+}
+
+/**
+ * @brief Adds the subscription to the client and counts the root it
+ *        needs. Called with _Mutex held.
+ */
+void WatchServer::subscribe(Client& client, remote::Subscription subscription)
+{
+    std::error_code error;
+    RootType root = RootType::file;
+    if (std::filesystem::is_directory(subscription.path, error))
+        root = subscription.recursive ? RootType::directory : RootType::flat;
+
+    ++_Requested[{ subscription.path, root }];
+    client.subscriptions.push_back({ std::move(subscription), root });
+}
+
+/**
+ * @brief Drops the root of a removed subscription once no other
+ *        subscription needs it. Called with _Mutex held.
+ */
+void WatchServer::release(const Subscribed& subscribed)
+{
+    const auto found = _Requested.find({ subscribed.subscription.path, subscribed.root });
+    if (found != std::end(_Requested) && --found->second == 0)
+        _Requested.erase(found);
+}
+
+/**
+ * @brief Watches the roots the subscriptions need and unwatches the
+ *        others, including roots covered by a new recursive one.
+ *        Roots are removed first, a root watched again with another
+ *        type keeps the wd of its inode. Called with _Mutex held.
+ */
+void WatchServer::updateRoots()
+{
+    std::map<std::filesystem::path, RootType> roots;
+    std::vector<std::filesystem::path> directories;
+    for (const auto& requested : _Requested) {
+        const auto& path = requested.first.first;
+        if (requested.first.second != RootType::directory)
+            continue;
+        // sorted, a directory above comes first
+        if (std::none_of(std::begin(directories), std::end(directories),
+                [&](const std::filesystem::path& root) { return isBelow(root, path); }))
+            directories.push_back(path);
+    }
+    for (const auto& directory : directories)
+        roots[directory] = RootType::directory;
+
+    const auto covered = [&](const std::filesystem::path& path) {
+        return std::any_of(std::begin(directories), std::end(directories),
+            [&](const std::filesystem::path& root) { return isBelow(root, path); });
+    };
+    for (const auto& requested : _Requested)
+        if (requested.first.second == RootType::flat && !covered(requested.first.first))
+            roots.emplace(requested.first.first, RootType::flat);
+    for (const auto& requested : _Requested) {
+        const auto& path = requested.first.first;
+        const auto parent = roots.find(path.parent_path());
+        // the entries of a watched directory are reported by its wd
+        if (requested.first.second == RootType::file && !covered(path)
+            && (parent == std::end(roots) || parent->second != RootType::flat))
+            roots.emplace(path, RootType::file);
+    }
+
+    for (auto it = std::begin(_Roots); it != std::end(_Roots);) {
+        const auto wanted = roots.find(it->first);
+        if (wanted != std::end(roots) && wanted->second == it->second) {
+            ++it;
+            continue;
+        }
+        _Controller.unwatch(it->first);
+        it = _Roots.erase(it);
+    }
+
+    for (const auto& root : roots) {
+        if (_Roots.count(root.first))
+            continue;
+        try {
+            // the kernel watches all events, subscriptions are filtered here
+            if (root.second == RootType::directory)
+                _Controller.watchPathRecursively({ root.first, Event::all });
+            else if (root.second == RootType::flat)
+                _Controller.watchDirectory({ root.first, Event::all });
+            else
+                _Controller.watchFile({ root.first, Event::all });
+            _Roots.emplace(root);
+        } catch (const std::exception&) {
+            // gone, tried again with the next change of the subscriptions
+        }
+    }
+}
+
+/**
+ * @brief Collects the event for every client subscribed to it. Called
+ *        by the event loop.
+ */
+void WatchServer::onNotification(const Notification& notification)
+{
+    const auto event = notification.getEvent();
+    const std::filesystem::path path = notification.getPath();
+
+    bool collected = false;
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        for (const auto& client : _Clients) {
+            // every client may have missed events
+            if (event == Event::overflow) {
+                remote::appendEvent(client->batch, event, path);
+                ++client->batchCount;
+                collected = true;
+                continue;
+            }
+
+            const bool subscribed = std::any_of(std::begin(client->subscriptions), std::end(client->subscriptions),
+                [&](const Subscribed& subscribed) { return remote::matches(subscribed.subscription, event, path); });
+            if (!subscribed)
+                continue;
+            remote::appendEvent(client->batch, event, path);
+            ++client->batchCount;
+            collected = true;
+        }
+    }
+
+    if (collected)
+        wake();
+}
+
+/**
+ * @brief Frames the collected events and writes as much as the socket
+ *        takes. Called with _Mutex held.
+ *
+ * @return false if the client is gone or too far behind
+ */
+bool WatchServer::flush(Client& client)
+{
+    if (client.batchCount > 0) {
+        remote::encodeEvents(client.output, client.batch, client.batchCount);
+        client.batch.clear();
+        client.batchCount = 0;
+    }
+
+    while (!client.output.empty()) {
+        const auto written = ::send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+        if (written == -1) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN)
+                return false;
+            break;
+        }
+        client.output.erase(0, static_cast<std::size_t>(written));
+    }
+    return client.output.size() <= _ClientBufferLimit;
+}
+}
@@ -0,0 +1,246 @@
+#include <notify-cpp/watch_tree.h>
+
+namespace notifycpp {
+
+WatchTree::WatchTree()
+    : _Slots(16, npos)
+    , _Linked(0)
+{
+    _Nodes.push_back({ npos, StringTable::npos, 1, 0, -1 });
+}
+
+std::size_t WatchTree::hash(NodeId parent, StringTable::Id name) const
+{
+    const std::uint64_t key = (static_cast<std::uint64_t>(parent) << 32) | name;
+    return static_cast<std::size_t>((key * 0x9e3779b97f4a7c15ull) >> 16);
+}
+
+/**
+ * @return slot of the linked node or the free slot it belongs into
+ */
+std::size_t WatchTree::probe(NodeId parent, StringTable::Id name) const
+{
+    const std::size_t mask = _Slots.size() - 1;
+    for (std::size_t slot = hash(parent, name) & mask;; slot = (slot + 1) & mask) {
+        const NodeId id = _Slots[slot];
+        if (id == npos || (_Nodes[id].parent == parent && _Nodes[id].name == name))
+            return slot;
+    }
+}
+
+void WatchTree::grow()
+{
+    std::vector<NodeId> slots(_Slots.size() * 2, npos);
+    slots.swap(_Slots);
+    for (const NodeId id : slots)
+        if (id != npos)
+            _Slots[probe(_Nodes[id].parent, _Nodes[id].name)] = id;
+}
+
+void WatchTree::link(NodeId id)
+{
+    if ((_Linked + 1) * 2 > _Slots.size())
+        grow();
+
+    const auto& node = _Nodes[id];
+    _Slots[probe(node.parent, node.name)] = id;
+    ++_Nodes[node.parent].children;
+    ++_Linked;
+}
+
+/**
+ * @brief Removes the node from the index. Later entries of the probe
+ *        sequence are shifted back, so lookups need no tombstones.
+ */
+void WatchTree::unlink(NodeId id)
+{
+    const auto& node = _Nodes[id];
+    if (node.parent == npos)
+        return;
+
+    const std::size_t mask = _Slots.size() - 1;
+    std::size_t hole = probe(node.parent, node.name);
+    _Slots[hole] = npos;
+    for (std::size_t slot = (hole + 1) & mask; _Slots[slot] != npos; slot = (slot + 1) & mask) {
+        const auto& moved = _Nodes[_Slots[slot]];
+        const std::size_t home = hash(moved.parent, moved.name) & mask;
+        // an entry may fill the hole if its home is not within (hole, slot]
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            _Slots[hole] = _Slots[slot];
+            _Slots[slot] = npos;
+            hole = slot;
+        }
+    }
+
+    --_Nodes[node.parent].children;
+    --_Linked;
+}
+
+/**
+ * @brief Adds the nodes of all path components that don't exist yet
+ *        and references the last one.
+ */
+WatchTree::NodeId WatchTree::insert(const std::filesystem::path& path)
+{
+    NodeId current = root;
+    for (const auto& component : path) {
+        const std::string name = component.string();
+        if (name.empty())
+            continue;
+
+        const NodeId found = child(current, name);
+        if (found != npos) {
+            current = found;
+            continue;
+        }
+
+        const Node node { current, _Names.intern(name), 0, 0, -1 };
+        NodeId id;
+        if (_Free.empty()) {
+            id = static_cast<NodeId>(_Nodes.size());
+            _Nodes.push_back(node);
+        }
+        else {
+            id = _Free.back();
+            _Free.pop_back();
+            _Nodes[id] = node;
+        }
+        link(id);
+        current = id;
+    }
+
+    ++_Nodes[current].refs;
+    return current;
+}
+
+/**
+ * @brief Drops a reference and removes nodes that are not used by a
+ *        watch or another node anymore.
+ */
+void WatchTree::release(NodeId id)
+{
+    if (id == npos || id == root)
+        return;
+    --_Nodes[id].refs;
+    collect(id);
+}
+
+void WatchTree::collect(NodeId id)
+{
+    while (id != root && id != npos && _Nodes[id].refs == 0 && _Nodes[id].children == 0) {
+        const NodeId parent = _Nodes[id].parent;
+        unlink(id);
+        _Nodes[id] = { npos, StringTable::npos, 0, 0, -1 };
+        _Free.push_back(id);
+        id = parent;
+    }
+}
+
+WatchTree::NodeId WatchTree::find(const std::filesystem::path& path) const
+{
+    NodeId current = root;
+    for (const auto& component : path) {
+        const std::string name = component.string();
+        if (name.empty())
+            continue;
+        current = child(current, name);
+        if (current == npos)
+            break;
+    }
+    return current;
+}
+
+WatchTree::NodeId WatchTree::child(NodeId parent, std::string_view name) const
+{
+    const StringTable::Id id = _Names.find(name);
+    if (id == StringTable::npos)
+        return npos;
+    return _Slots[probe(parent, id)];
+}
+
+/**
+ * @brief Relinks the node below a new parent with a new name. A node
+ *        already linked under that name is replaced and detached.
+ */
+void WatchTree::move(NodeId id, NodeId parent, std::string_view name)
+{
+    if (id == root || id == npos || isAncestor(id, parent))
+        return;
+
+    const NodeId replaced = child(parent, name);
+    if (replaced == id)
+        return;
+    if (replaced != npos) {
+        // not detach(), the new parent must not be collected
+        unlink(replaced);
+        _Nodes[replaced].parent = npos;
+        collect(replaced);
+    }
+
+    const NodeId oldParent = _Nodes[id].parent;
+    unlink(id);
+    _Nodes[id].parent = parent;
+    _Nodes[id].name = _Names.intern(name);
+    link(id);
+    if (oldParent != npos)
+        collect(oldParent);
+}
+
+/**
+ * @brief Takes the node and its subtree out of the tree, e.g. when it
+ *        was moved to an unknown location. Its path is just its name
+ *        afterwards. The nodes stay until their watches are released.
+ */
+void WatchTree::detach(NodeId id)
+{
+    if (id == root || id == npos || _Nodes[id].parent == npos)
+        return;
+
+    const NodeId oldParent = _Nodes[id].parent;
+    unlink(id);
+    _Nodes[id].parent = npos;
+    collect(id);
+    collect(oldParent);
+}
+
+std::filesystem::path WatchTree::path(NodeId id) const
+{
+    std::vector<NodeId> ancestors;
+    for (NodeId current = id; current != root && current != npos; current = _Nodes[current].parent)
+        ancestors.push_back(current);
+
+    std::filesystem::path result;
+    for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it)
+        result /= _Names.get(_Nodes[*it].name);
+    return result;
+}
+
+bool WatchTree::isAncestor(NodeId ancestor, NodeId id) const
+{
+    for (NodeId current = id; current != npos; current = _Nodes[current].parent)
+        if (current == ancestor)
+            return true;
+    return false;
+}
+
+int WatchTree::watch(NodeId id) const
+{
+    return id == npos ? -1 : _Nodes[id].wd;
+}
+
+void WatchTree::setWatch(NodeId id, int wd)
+{
+    _Nodes[id].wd = wd;
+}
+
+std::size_t WatchTree::size() const
+{
+    return _Nodes.size() - _Free.size() - 1;
+}
+
+std::size_t WatchTree::memoryUsage() const
+{
+    return _Nodes.capacity() * sizeof(Node) + _Free.capacity() * sizeof(NodeId)
+        + _Slots.capacity() * sizeof(NodeId) + _Names.memoryUsage();
+}
+}
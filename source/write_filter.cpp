@@ -0,0 +1,183 @@
+#include <notify-cpp/write_filter.h>
+#include <notify-cpp/xxhash.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace notifycpp {
+
+namespace {
+    const std::size_t Ways = 4;
+    const std::uint64_t BlockSize = 16 * 1024;
+    const std::size_t ReadSize = 1 << 20;
+
+    //! closes the descriptor when leaving the scope
+    struct FileCloser {
+        int fd;
+        ~FileCloser()
+        {
+            if (fd != -1)
+                close(fd);
+        }
+    };
+}
+
+/**
+ * @param capacity number of fingerprints kept, rounded up to a power
+ *        of two
+ */
+WriteFilter::WriteFilter(std::size_t capacity)
+    : _SetMask(0)
+    , _Stamp(0)
+    , _Suppressed(0)
+    , _Buffer(ReadSize)
+{
+    std::size_t sets = 1;
+    while (sets * Ways < capacity)
+        sets *= 2;
+    _Slots.resize(sets * Ways, Slot {});
+    _SetMask = sets - 1;
+}
+
+/**
+ * @brief Fingerprints the file of a close_write or moved_to event
+ *
+ * @return true if the content is the same as at the previous event of
+ *         the path, the event can be dropped
+ */
+bool WriteFilter::unchanged(const FileSystemEvent& fse)
+{
+    const Event event = fse.getEvent();
+    if (!intersects(event, Event::close_write | Event::moved_to | Event::moved_from | Event::delete_sub | Event::delete_self
+            | Event::replaced))
+        return false;
+
+    const auto path = fse.getPath();
+    auto key = XXHash64::hash(path.native().data(), path.native().size());
+    if (key == 0)
+        key = 1;
+
+    // a file created again at the path starts without a fingerprint
+    if (!intersects(event, Event::close_write | Event::moved_to)) {
+        if (auto* slot = find(key))
+            slot->key = 0;
+        return false;
+    }
+
+    FileCloser file { open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW) };
+    struct stat st;
+    if (file.fd == -1 || fstat(file.fd, &st) == -1 || !S_ISREG(st.st_mode))
+        return false;
+
+    const auto size = static_cast<std::uint64_t>(st.st_size);
+    std::uint64_t sampled;
+    if (!sample(file.fd, size, sampled))
+        return false;
+
+    auto* slot = find(key);
+    if (!slot || slot->size != size || slot->sample != sampled) {
+        if (!slot)
+            slot = &insert(key);
+        slot->size = size;
+        slot->sample = sampled;
+        slot->hasFull = 0;
+        return false;
+    }
+
+    // the sample covers the whole file
+    if (size <= 3 * BlockSize) {
+        ++_Suppressed;
+        return true;
+    }
+
+    std::uint64_t full;
+    if (!digest(file.fd, 0, size, full))
+        return false;
+    const bool same = slot->hasFull && slot->full == full;
+    slot->full = full;
+    slot->hasFull = 1;
+    if (same)
+        ++_Suppressed;
+    return same;
+}
+
+std::size_t WriteFilter::getSuppressed() const
+{
+    return _Suppressed;
+}
+
+WriteFilter::Slot* WriteFilter::find(std::uint64_t key)
+{
+    auto* set = &_Slots[(key & _SetMask) * Ways];
+    for (std::size_t way = 0; way < Ways; ++way) {
+        if (set[way].key == key) {
+            set[way].stamp = ++_Stamp;
+            return &set[way];
+        }
+    }
+    return nullptr;
+}
+
+WriteFilter::Slot& WriteFilter::insert(std::uint64_t key)
+{
+    auto* set = &_Slots[(key & _SetMask) * Ways];
+    auto* victim = &set[0];
+    for (std::size_t way = 0; way < Ways; ++way) {
+        if (set[way].key == 0) {
+            victim = &set[way];
+            break;
+        }
+        // unsigned difference, correct across a wrap of the stamp
+        if (_Stamp - set[way].stamp > _Stamp - victim->stamp)
+            victim = &set[way];
+    }
+    *victim = Slot {};
+    victim->key = key;
+    victim->stamp = ++_Stamp;
+    return *victim;
+}
+
+/**
+ * @brief Digest of the first, middle and last block, of the whole file
+ *        if it is not larger than the three blocks
+ */
+bool WriteFilter::sample(int fd, std::uint64_t size, std::uint64_t& sampled)
+{
+    if (size <= 3 * BlockSize)
+        return digest(fd, 0, size, sampled);
+
+    const std::uint64_t offsets[] = { 0, (size / 2) & ~(BlockSize - 1), size - BlockSize };
+    XXHash64 state;
+    for (const auto offset : offsets) {
+        std::uint64_t block;
+        if (!digest(fd, offset, BlockSize, block))
+            return false;
+        state.update(&block, sizeof(block));
+    }
+    sampled = state.digest();
+    return true;
+}
+
+bool WriteFilter::digest(int fd, std::uint64_t offset, std::uint64_t length, std::uint64_t& result)
+{
+    XXHash64 state;
+    while (length > 0) {
+        const auto wanted = static_cast<std::size_t>(std::min<std::uint64_t>(length, _Buffer.size()));
+        const auto read = pread(fd, _Buffer.data(), wanted, static_cast<off_t>(offset));
+        if (read == -1 && errno == EINTR)
+            continue;
+        // truncated meanwhile, another event follows
+        if (read <= 0)
+            return false;
+        state.update(_Buffer.data(), static_cast<std::size_t>(read));
+        offset += static_cast<std::uint64_t>(read);
+        length -= static_cast<std::uint64_t>(read);
+    }
+    result = state.digest();
+    return true;
+}
+}
@@ -0,0 +1,135 @@
+#include <notify-cpp/xxhash.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace notifycpp {
+
+namespace {
+    const std::uint64_t Prime1 = 11400714785074694791ULL;
+    const std::uint64_t Prime2 = 14029467366897019727ULL;
+    const std::uint64_t Prime3 = 1609587929392839161ULL;
+    const std::uint64_t Prime4 = 9650029242287828579ULL;
+    const std::uint64_t Prime5 = 2870177450012600261ULL;
+
+    std::uint64_t rotate(std::uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    std::uint64_t read64(const unsigned char* data)
+    {
+        std::uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    std::uint32_t read32(const unsigned char* data)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    std::uint64_t round(std::uint64_t lane, std::uint64_t input)
+    {
+        lane += input * Prime2;
+        return rotate(lane, 31) * Prime1;
+    }
+
+    std::uint64_t merge(std::uint64_t hash, std::uint64_t lane)
+    {
+        hash ^= round(0, lane);
+        return hash * Prime1 + Prime4;
+    }
+
+    //! consumes whole stripes, returns the bytes left
+    std::size_t stripes(std::uint64_t* lanes, const unsigned char* data, std::size_t length)
+    {
+        std::uint64_t lane0 = lanes[0], lane1 = lanes[1], lane2 = lanes[2], lane3 = lanes[3];
+        const unsigned char* const end = data + (length & ~std::size_t(31));
+        for (; data < end; data += 32) {
+            lane0 = round(lane0, read64(data));
+            lane1 = round(lane1, read64(data + 8));
+            lane2 = round(lane2, read64(data + 16));
+            lane3 = round(lane3, read64(data + 24));
+        }
+        lanes[0] = lane0;
+        lanes[1] = lane1;
+        lanes[2] = lane2;
+        lanes[3] = lane3;
+        return length & 31;
+    }
+
+    std::uint64_t finish(std::uint64_t hash, const unsigned char* data, std::size_t length)
+    {
+        for (; length >= 8; data += 8, length -= 8)
+            hash = rotate(hash ^ round(0, read64(data)), 27) * Prime1 + Prime4;
+        if (length >= 4) {
+            hash = rotate(hash ^ (read32(data) * Prime1), 23) * Prime2 + Prime3;
+            data += 4;
+            length -= 4;
+        }
+        for (; length > 0; ++data, --length)
+            hash = rotate(hash ^ (*data * Prime5), 11) * Prime1;
+
+        hash ^= hash >> 33;
+        hash *= Prime2;
+        hash ^= hash >> 29;
+        hash *= Prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+}
+
+XXHash64::XXHash64(std::uint64_t seed)
+    : _Lanes { seed + Prime1 + Prime2, seed + Prime2, seed, seed - Prime1 }
+    , _Seed(seed)
+    , _Length(0)
+    , _Buffered(0)
+{
+}
+
+void XXHash64::update(const void* data, std::size_t length)
+{
+    auto input = static_cast<const unsigned char*>(data);
+    _Length += length;
+
+    if (_Buffered > 0) {
+        const auto fill = std::min(length, sizeof(_Buffer) - _Buffered);
+        std::memcpy(_Buffer + _Buffered, input, fill);
+        _Buffered += fill;
+        input += fill;
+        length -= fill;
+        if (_Buffered < sizeof(_Buffer))
+            return;
+        stripes(_Lanes, _Buffer, sizeof(_Buffer));
+        _Buffered = 0;
+    }
+
+    const auto left = stripes(_Lanes, input, length);
+    std::memcpy(_Buffer, input + length - left, left);
+    _Buffered = left;
+}
+
+std::uint64_t XXHash64::digest() const
+{
+    std::uint64_t hash;
+    if (_Length >= 32) {
+        hash = rotate(_Lanes[0], 1) + rotate(_Lanes[1], 7) + rotate(_Lanes[2], 12) + rotate(_Lanes[3], 18);
+        for (const auto lane : _Lanes)
+            hash = merge(hash, lane);
+    }
+    else {
+        hash = _Seed + Prime5;
+    }
+    return finish(hash + _Length, _Buffer, _Buffered);
+}
+
+std::uint64_t XXHash64::hash(const void* data, std::size_t length, std::uint64_t seed)
+{
+    XXHash64 state(seed);
+    state.update(data, length);
+    return state.digest();
+}
+}
@@ -0,0 +1,148 @@
+#include <notify-cpp/change_index.h>
+#include <notify-cpp/change_set.h>
+#include <notify-cpp/rename_tracker.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace notifycpp;
+
+BOOST_AUTO_TEST_CASE(ChangeSetCreateDeleteCancelsTest)
+{
+    ChangeSetBuilder builder;
+    builder.add({ "/d/tmp", Event::create });
+    builder.add({ "/d/tmp", Event::modify });
+    builder.add({ "/d/tmp", Event::delete_sub });
+    BOOST_CHECK(builder.take().empty());
+    BOOST_CHECK(builder.empty());
+}
+
+BOOST_AUTO_TEST_CASE(ChangeSetAtomicSaveTest)
+{
+    ChangeSetBuilder builder;
+    builder.add({ "/d/.file.swp", Event::create });
+    builder.add({ "/d/.file.swp", Event::modify });
+    builder.add({ "/d/.file.swp", Event::close_write });
+    builder.add({ "/d/.file.swp", Event::moved_from });
+    builder.add({ "/d/file", Event::moved_to });
+
+    const auto changes = builder.take();
+    BOOST_REQUIRE_EQUAL(changes.size(), 1);
+    BOOST_CHECK(changes[0].type == ChangeType::modified);
+    BOOST_CHECK_EQUAL(changes[0].path, "/d/file");
+}
+
+BOOST_AUTO_TEST_CASE(ChangeSetRenameAndModifyTest)
+{
+    ChangeSetBuilder builder;
+    builder.add({ "/d/a", Event::modify });
+    builder.add({ "/d/a", Event::modify });
+    builder.add({ "/d/b", Event::moved_from });
+    builder.add({ "/d/c", Event::moved_to });
+    builder.add({ "/d/e", Event::delete_sub });
+    builder.add({ "/d/f", Event::moved_from });
+
+    const auto changes = builder.take();
+    BOOST_REQUIRE_EQUAL(changes.size(), 4);
+    BOOST_CHECK(changes[0].type == ChangeType::modified);
+    BOOST_CHECK_EQUAL(changes[0].path, "/d/a");
+    BOOST_CHECK(changes[1].type == ChangeType::renamed);
+    BOOST_CHECK_EQUAL(changes[1].from, "/d/b");
+    BOOST_CHECK_EQUAL(changes[1].path, "/d/c");
+    BOOST_CHECK(changes[2].type == ChangeType::removed);
+    BOOST_CHECK_EQUAL(changes[2].path, "/d/e");
+    BOOST_CHECK(changes[3].type == ChangeType::removed);
+    BOOST_CHECK_EQUAL(changes[3].path, "/d/f");
+}
+
+BOOST_AUTO_TEST_CASE(ChangeSetRenameBackTest)
+{
+    ChangeSetBuilder builder;
+    builder.add({ "/d/a", Event::moved_from });
+    builder.add({ "/d/b", Event::moved_to });
+    builder.add({ "/d/b", Event::moved_from });
+    builder.add({ "/d/a", Event::moved_to });
+
+    const auto changes = builder.take();
+    BOOST_REQUIRE_EQUAL(changes.size(), 1);
+    BOOST_CHECK(changes[0].type == ChangeType::removed);
+    BOOST_CHECK_EQUAL(changes[0].path, "/d/b");
+}
+
+BOOST_AUTO_TEST_CASE(ChangeSetCookieMismatchTest)
+{
+    ChangeSetBuilder builder;
+    builder.add({ "/d/a", Event::moved_from, 1 });
+    builder.add({ "/d/b", Event::moved_to, 2 });
+
+    const auto changes = builder.take();
+    BOOST_REQUIRE_EQUAL(changes.size(), 2);
+    BOOST_CHECK(changes[0].type == ChangeType::removed);
+    BOOST_CHECK_EQUAL(changes[0].path, "/d/a");
+    BOOST_CHECK(changes[1].type == ChangeType::modified);
+    BOOST_CHECK_EQUAL(changes[1].path, "/d/b");
+}
+
+BOOST_AUTO_TEST_CASE(RenameTrackerPairingTest)
+{
+    const auto start = RenameTracker::Clock::now();
+    RenameTracker tracker(std::chrono::milliseconds(10));
+    std::vector<Rename> renames;
+    std::vector<TFileSystemEventPtr> ready;
+
+    tracker.push(std::make_shared<FileSystemEvent>("/d/a", Event::moved_from, 7), start, renames, ready);
+    tracker.push(std::make_shared<FileSystemEvent>("/d/c", Event::modify), start, renames, ready);
+    BOOST_CHECK_EQUAL(tracker.pending(), 1);
+    BOOST_REQUIRE_EQUAL(ready.size(), 1);
+
+    tracker.push(std::make_shared<FileSystemEvent>("/d/b", Event::moved_to, 7), start, renames, ready);
+    BOOST_REQUIRE_EQUAL(renames.size(), 1);
+    BOOST_CHECK_EQUAL(renames[0].from, "/d/a");
+    BOOST_CHECK_EQUAL(renames[0].to, "/d/b");
+    BOOST_CHECK_EQUAL(tracker.pending(), 0);
+    BOOST_CHECK(tracker.nextExpiry() == RenameTracker::Clock::time_point::max());
+}
+
+BOOST_AUTO_TEST_CASE(RenameTrackerTimeoutTest)
+{
+    const auto start = RenameTracker::Clock::now();
+    RenameTracker tracker(std::chrono::milliseconds(10));
+    std::vector<Rename> renames;
+    std::vector<TFileSystemEventPtr> ready;
+
+    tracker.push(std::make_shared<FileSystemEvent>("/d/a", Event::moved_from, 7), start, renames, ready);
+    tracker.push(std::make_shared<FileSystemEvent>("/d/b", Event::moved_to, 8), start, renames, ready);
+    BOOST_REQUIRE_EQUAL(ready.size(), 1);
+    BOOST_CHECK_EQUAL(ready[0]->getPath(), "/d/b");
+    BOOST_CHECK(tracker.nextExpiry() == start + std::chrono::milliseconds(10));
+
+    tracker.advance(start + std::chrono::milliseconds(9), ready);
+    BOOST_CHECK_EQUAL(ready.size(), 1);
+    tracker.advance(start + std::chrono::milliseconds(10), ready);
+    BOOST_REQUIRE_EQUAL(ready.size(), 2);
+    BOOST_CHECK_EQUAL(ready[1]->getPath(), "/d/a");
+    BOOST_CHECK(renames.empty());
+}
+
+BOOST_AUTO_TEST_CASE(ChangeIndexChangedSinceTest)
+{
+    ChangeIndex index;
+    index.record("/srv/a", 1);
+    index.record("/srv/b", 2);
+    index.record("/srv/c/d", 3);
+    index.record("/srv/a", 4);
+    index.record("/srv/cd", 5);
+
+    const auto changes = index.changedSince(2);
+    BOOST_REQUIRE_EQUAL(changes.size(), 3);
+    BOOST_CHECK_EQUAL(changes[0].path, "/srv/c/d");
+    BOOST_CHECK_EQUAL(changes[1].path, "/srv/a");
+    BOOST_CHECK_EQUAL(changes[1].clock, 4);
+    BOOST_CHECK_EQUAL(changes[2].path, "/srv/cd");
+
+    const auto below = index.changedSince(0, "/srv/c");
+    BOOST_REQUIRE_EQUAL(below.size(), 1);
+    BOOST_CHECK_EQUAL(below[0].path, "/srv/c/d");
+
+    BOOST_CHECK(index.changedSince(5).empty());
+    BOOST_CHECK_EQUAL(index.size(), 4);
+}
@@ -0,0 +1,193 @@
+#include <notify-cpp/content_hash_cache.h>
+#include <notify-cpp/tree_model.h>
+#include <notify-cpp/xxhash.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+using namespace notifycpp;
+
+namespace {
+struct ContentHashDirectory {
+    ContentHashDirectory()
+        : root(std::filesystem::absolute("content_hash.test"))
+    {
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root);
+    }
+
+    ~ContentHashDirectory()
+    {
+        std::filesystem::remove_all(root);
+    }
+
+    //! written long enough ago for its digest to be cached
+    static void age(const std::filesystem::path& file)
+    {
+        std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now() - std::chrono::seconds(10));
+    }
+
+    const std::filesystem::path root;
+};
+}
+
+BOOST_AUTO_TEST_CASE(XXHash64ReferenceTest)
+{
+    BOOST_CHECK_EQUAL(XXHash64::hash("", 0), 0xEF46DB3751D8E999ULL);
+    BOOST_CHECK_EQUAL(XXHash64::hash("abc", 3), 0x44BC2CF5AD770999ULL);
+
+    std::string data;
+    for (int i = 0; i < 1000; ++i)
+        data.push_back(static_cast<char>(i * 31));
+
+    // the same digest for any split of the stream
+    const auto expected = XXHash64::hash(data.data(), data.size(), 7);
+    for (std::size_t step : { 1, 5, 31, 32, 33, 999 }) {
+        XXHash64 state(7);
+        for (std::size_t offset = 0; offset < data.size(); offset += step)
+            state.update(data.data() + offset, std::min(step, data.size() - offset));
+        BOOST_CHECK_EQUAL(state.digest(), expected);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(ContentHashInvalidatedByEventTest, ContentHashDirectory)
+{
+    const auto file = root / "file";
+    std::ofstream(file) << "first";
+    age(file);
+
+    ContentHashCache cache;
+    const auto first = cache.hash(file);
+    BOOST_CHECK_EQUAL(first, XXHash64::hash("first", 5));
+    BOOST_CHECK_EQUAL(cache.hash(file), first);
+    BOOST_CHECK_EQUAL(cache.getStatistics().hits, 1);
+
+    // same size, the mtime may not have changed
+    std::ofstream(file) << "other";
+    age(file);
+    cache.invalidate(FileSystemEvent(file, Event::close_write));
+    BOOST_CHECK_EQUAL(cache.hash(file), XXHash64::hash("other", 5));
+    BOOST_CHECK_EQUAL(cache.getStatistics().hashed, 2);
+    BOOST_CHECK_EQUAL(cache.getStatistics().entries, 1);
+
+    BOOST_CHECK_THROW(cache.hash(root / "missing"), std::runtime_error);
+    BOOST_CHECK_THROW(cache.hash(root), std::runtime_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(ContentHashRacilyCleanTest, ContentHashDirectory)
+{
+    const auto file = root / "file";
+    std::ofstream(file) << "fresh";
+
+    // a rewrite in the same tick could keep the identity, not cached
+    ContentHashCache cache;
+    BOOST_CHECK_EQUAL(cache.hash(file), XXHash64::hash("fresh", 5));
+    BOOST_CHECK_EQUAL(cache.hash(file), XXHash64::hash("fresh", 5));
+    BOOST_CHECK_EQUAL(cache.getStatistics().hashed, 2);
+    BOOST_CHECK_EQUAL(cache.getStatistics().entries, 0);
+
+    age(file);
+    cache.hash(file);
+    BOOST_CHECK_EQUAL(cache.getStatistics().entries, 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(ContentHashRenameTest, ContentHashDirectory)
+{
+    const auto file = root / "file";
+    const auto renamed = root / "renamed";
+    std::ofstream(file) << "content";
+    age(file);
+
+    ContentHashCache cache;
+    const auto digest = cache.hash(file);
+
+    std::filesystem::rename(file, renamed);
+    cache.invalidate(FileSystemEvent(file, Event::moved_from, 42));
+    cache.invalidate(FileSystemEvent(renamed, Event::moved_to, 42));
+    BOOST_CHECK_EQUAL(cache.hash(renamed), digest);
+    BOOST_CHECK_EQUAL(cache.getStatistics().hashed, 1);
+
+    // the digest moved with the path
+    std::ofstream(renamed) << "changed";
+    cache.invalidate(FileSystemEvent(renamed, Event::modify));
+    BOOST_CHECK_EQUAL(cache.getStatistics().entries, 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(ContentHashBackgroundTest, ContentHashDirectory)
+{
+    const auto file = root / "file";
+    std::ofstream(file) << "background";
+    age(file);
+
+    ContentHashCache cache(1);
+    cache.invalidate(FileSystemEvent(file, Event::close_write));
+    for (int i = 0; i < 100 && cache.getStatistics().entries == 0; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    BOOST_CHECK_EQUAL(cache.hash(file), XXHash64::hash("background", 10));
+    BOOST_CHECK_EQUAL(cache.getStatistics().hashed, 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(ContentHashSnapshotTest, ContentHashDirectory)
+{
+    const auto file = root / "file";
+    const std::filesystem::path snapshot("content_hash.snapshot");
+    std::ofstream(file) << "saved";
+    age(file);
+
+    std::uint64_t digest;
+    {
+        ContentHashCache cache;
+        digest = cache.hash(file);
+        TreeModel model(root);
+        model.scan();
+        Snapshot::save(model, snapshot, cache.records());
+    }
+
+    ContentHashCache cache;
+    cache.load(Snapshot(snapshot));
+    BOOST_CHECK_EQUAL(cache.hash(file), digest);
+    BOOST_CHECK_EQUAL(cache.getStatistics().hashed, 0);
+    std::filesystem::remove(snapshot);
+}
+
+BOOST_FIXTURE_TEST_CASE(ContentHashSnapshotDeletedTest, ContentHashDirectory)
+{
+    const auto kept = root / "kept";
+    const auto deleted = root / "deleted";
+    const auto unknown = root / "unknown";
+    const std::filesystem::path snapshot("content_hash.snapshot");
+    for (const auto& file : { kept, deleted })
+        std::ofstream(file) << file.filename().string();
+    age(kept);
+    age(deleted);
+
+    {
+        ContentHashCache cache;
+        TreeModel model(root);
+        model.scan();
+        // not in the saved model
+        std::ofstream(unknown) << "unknown";
+        age(unknown);
+        for (const auto& file : { kept, deleted, unknown })
+            cache.hash(file);
+        Snapshot::save(model, snapshot, cache.records());
+    }
+
+    ContentHashCache cache;
+    cache.load(Snapshot(snapshot));
+    BOOST_CHECK_EQUAL(cache.getStatistics().entries, 2);
+
+    // deleted while nothing was watched, reported by the snapshot diff
+    std::filesystem::remove(deleted);
+    cache.invalidate(FileSystemEvent(deleted, Event::delete_sub));
+    BOOST_CHECK_EQUAL(cache.records().size(), 1);
+    cache.hash(kept);
+    BOOST_CHECK_EQUAL(cache.getStatistics().hashed, 0);
+    std::filesystem::remove(snapshot);
+}
@@ -0,0 +1,97 @@
+#include <notify-cpp/cursor.h>
+#include <notify-cpp/event_history.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+using namespace notifycpp;
+
+namespace {
+FileSystemEvent sequenced(const std::filesystem::path& path, std::uint64_t sequence)
+{
+    FileSystemEvent fse(path, Event::modify);
+    fse.setSequence(sequence);
+    return fse;
+}
+}
+
+BOOST_AUTO_TEST_CASE(EventHistorySinceTest)
+{
+    EventHistory history(3);
+    for (std::uint64_t sequence = 1; sequence <= 3; ++sequence)
+        history.push(sequenced("/tmp/" + std::to_string(sequence), sequence));
+
+    std::vector<HistoryEntry> entries;
+    BOOST_CHECK(history.since(1, entries));
+    BOOST_REQUIRE_EQUAL(entries.size(), 2);
+    BOOST_CHECK_EQUAL(entries[0].sequence, 2);
+    BOOST_CHECK_EQUAL(entries[1].path, "/tmp/3");
+
+    history.push(sequenced("/tmp/4", 4));
+    history.push(sequenced("/tmp/5", 5));
+    BOOST_CHECK_EQUAL(history.size(), 3);
+
+    // 2 was overwritten
+    entries.clear();
+    BOOST_CHECK(!history.since(1, entries));
+    BOOST_CHECK_EQUAL(entries.size(), 3);
+
+    entries.clear();
+    BOOST_CHECK(history.since(2, entries));
+    BOOST_REQUIRE_EQUAL(entries.size(), 3);
+    BOOST_CHECK_EQUAL(entries.front().sequence, 3);
+
+    // newer than the last event, e.g. from an earlier process
+    entries.clear();
+    BOOST_CHECK(!history.since(6, entries));
+    BOOST_CHECK(entries.empty());
+}
+
+BOOST_AUTO_TEST_CASE(EventHistoryBaseTest)
+{
+    EventHistory history(3, 100);
+    std::vector<HistoryEntry> entries;
+    BOOST_CHECK(history.since(100, entries));
+    BOOST_CHECK(!history.since(99, entries));
+    BOOST_CHECK(!history.since(101, entries));
+
+    history.push(sequenced("/tmp/101", 101));
+    BOOST_CHECK(history.since(100, entries));
+    BOOST_CHECK_EQUAL(entries.size(), 1);
+    entries.clear();
+    BOOST_CHECK(!history.since(42, entries));
+}
+
+BOOST_AUTO_TEST_CASE(CursorResumeTest)
+{
+    const std::filesystem::path file("cursor.test");
+    std::filesystem::remove(file);
+    {
+        Cursor cursor(file, std::chrono::hours(1));
+        BOOST_CHECK_EQUAL(cursor.position(), 0);
+        cursor.ack(5);
+        // within the sync interval, written by the destructor
+        cursor.ack(9);
+        cursor.ack(7);
+        BOOST_CHECK_EQUAL(cursor.position(), 9);
+    }
+    {
+        Cursor cursor(file);
+        BOOST_CHECK_EQUAL(cursor.position(), 9);
+        cursor.ack(12);
+        cursor.flush();
+    }
+    BOOST_CHECK_EQUAL(Cursor(file).position(), 12);
+
+    // back to a smaller position after a rescan
+    {
+        Cursor cursor(file);
+        cursor.reset(3);
+        BOOST_CHECK_EQUAL(cursor.position(), 3);
+    }
+    BOOST_CHECK_EQUAL(Cursor(file).position(), 3);
+    std::filesystem::remove(file);
+}
@@ -0,0 +1,73 @@
+#include <notify-cpp/event_coalescer.h>
+#include <notify-cpp/timing_wheel.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+
+using namespace notifycpp;
+
+BOOST_AUTO_TEST_CASE(TimingWheelExpiryTest)
+{
+    const auto start = TimingWheel::Clock::now();
+    TimingWheel wheel(std::chrono::milliseconds(1), start);
+    wheel.schedule(1, start + std::chrono::milliseconds(10));
+    wheel.schedule(2, start + std::chrono::milliseconds(100));
+    wheel.schedule(3, start + std::chrono::seconds(30));
+
+    std::vector<std::uint64_t> expired;
+    wheel.advance(start + std::chrono::milliseconds(9), expired);
+    BOOST_CHECK(expired.empty());
+    BOOST_CHECK(wheel.nextExpiry() == start + std::chrono::milliseconds(10));
+
+    wheel.advance(start + std::chrono::milliseconds(100), expired);
+    BOOST_CHECK_EQUAL(expired.size(), 2);
+
+    wheel.advance(start + std::chrono::milliseconds(29999), expired);
+    BOOST_CHECK_EQUAL(expired.size(), 2);
+    wheel.advance(start + std::chrono::seconds(30), expired);
+    BOOST_CHECK_EQUAL(expired.size(), 3);
+    BOOST_CHECK_EQUAL(expired[2], 3);
+    BOOST_CHECK(wheel.empty());
+}
+
+BOOST_AUTO_TEST_CASE(EventCoalescerTrailingTest)
+{
+    const auto start = EventCoalescer::Clock::now();
+    EventCoalescer coalescer(std::chrono::milliseconds(50));
+    std::vector<TFileSystemEventPtr> ready;
+
+    for (int i = 0; i < 20; ++i)
+        coalescer.push({ "a", Event::modify }, start + std::chrono::milliseconds(i), ready);
+    coalescer.push({ "a", Event::close_write }, start + std::chrono::milliseconds(20), ready);
+    coalescer.push({ "b", Event::modify }, start + std::chrono::milliseconds(20), ready);
+    BOOST_CHECK(ready.empty());
+    BOOST_CHECK_EQUAL(coalescer.pending(), 2);
+
+    coalescer.advance(start + std::chrono::milliseconds(60), ready);
+    BOOST_REQUIRE_EQUAL(ready.size(), 1);
+    BOOST_CHECK_EQUAL(ready[0]->getPath(), "a");
+    BOOST_CHECK(ready[0]->getEvent() == (Event::modify | Event::close_write));
+
+    coalescer.flush(ready);
+    BOOST_CHECK_EQUAL(ready.size(), 2);
+    BOOST_CHECK_EQUAL(coalescer.pending(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(EventCoalescerLeadingTest)
+{
+    const auto start = EventCoalescer::Clock::now();
+    EventCoalescer coalescer(std::chrono::milliseconds(50), CoalesceMode::leading);
+    std::vector<TFileSystemEventPtr> ready;
+
+    coalescer.push({ "a", Event::modify }, start, ready);
+    BOOST_CHECK_EQUAL(ready.size(), 1);
+
+    coalescer.advance(start + std::chrono::milliseconds(60), ready);
+    BOOST_CHECK_EQUAL(ready.size(), 1);
+
+    coalescer.push({ "a", Event::modify }, start + std::chrono::milliseconds(70), ready);
+    coalescer.push({ "a", Event::modify }, start + std::chrono::milliseconds(71), ready);
+    coalescer.advance(start + std::chrono::milliseconds(130), ready);
+    BOOST_CHECK_EQUAL(ready.size(), 3);
+}
@@ -0,0 +1,113 @@
+#include <notify-cpp/event_queue.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace notifycpp;
+
+namespace {
+TFileSystemEventPtr makeEvent(const std::string& path, Event event)
+{
+    return std::make_shared<FileSystemEvent>(path, event);
+}
+}
+
+BOOST_AUTO_TEST_CASE(EventQueueDropOldestTest)
+{
+    EventQueue queue;
+    queue.setLimit(2, OverflowPolicy::drop_oldest);
+    queue.push(makeEvent("a", Event::modify));
+    queue.push(makeEvent("b", Event::modify));
+    queue.push(makeEvent("c", Event::modify));
+
+    // and the overflow marker
+    BOOST_CHECK_EQUAL(queue.size(), 3);
+    BOOST_CHECK_EQUAL(queue.pop()->getPath(), "b");
+    BOOST_CHECK(queue.pop()->getEvent() == Event::overflow);
+    BOOST_CHECK_EQUAL(queue.pop()->getPath(), "c");
+    BOOST_CHECK_EQUAL(queue.getStatistics().dropped, 1);
+    BOOST_CHECK_EQUAL(queue.getStatistics().highWatermark, 3);
+}
+
+BOOST_AUTO_TEST_CASE(EventQueueDropLowestPriorityTest)
+{
+    EventQueue queue;
+    queue.setLimit(2, OverflowPolicy::drop_lowest_priority);
+    queue.push(makeEvent("a", Event::create));
+    queue.push(makeEvent("b", Event::access));
+    queue.push(makeEvent("c", Event::delete_sub));
+    queue.push(makeEvent("d", Event::open));
+
+    BOOST_CHECK_EQUAL(queue.size(), 3);
+    BOOST_CHECK_EQUAL(queue.pop()->getPath(), "a");
+    BOOST_CHECK(queue.pop()->getEvent() == Event::overflow);
+    BOOST_CHECK_EQUAL(queue.pop()->getPath(), "c");
+    BOOST_CHECK_EQUAL(queue.getStatistics().dropped, 2);
+}
+
+BOOST_AUTO_TEST_CASE(EventQueueCoalesceAndBlockTest)
+{
+    EventQueue queue;
+    queue.setLimit(1, OverflowPolicy::coalesce);
+    queue.push(makeEvent("a", Event::modify));
+    queue.push(makeEvent("a", Event::modify));
+    queue.push(makeEvent("b", Event::modify));
+    BOOST_CHECK_EQUAL(queue.getStatistics().coalesced, 1);
+    BOOST_CHECK_EQUAL(queue.getStatistics().dropped, 1);
+
+    queue.setLimit(1, OverflowPolicy::block);
+    BOOST_CHECK(!queue.accept());
+    queue.pop();
+    BOOST_CHECK(queue.accept());
+    BOOST_CHECK_EQUAL(queue.getStatistics().blocked, 1);
+}
+
+BOOST_AUTO_TEST_CASE(EventQueueBlockPerPushTest)
+{
+    EventQueue queue;
+    queue.setLimit(2, OverflowPolicy::block);
+    queue.push(makeEvent("a", Event::modify));
+
+    // room for one more event only
+    BOOST_CHECK(queue.accept());
+    BOOST_CHECK(!queue.accept(2));
+
+    // an event pushed into the full queue anyway is dropped
+    queue.push(makeEvent("b", Event::modify));
+    queue.push(makeEvent("c", Event::modify));
+    BOOST_CHECK_EQUAL(queue.size(), 3);
+    BOOST_CHECK_EQUAL(queue.getStatistics().dropped, 1);
+    BOOST_CHECK_EQUAL(queue.pop()->getPath(), "a");
+    BOOST_CHECK_EQUAL(queue.pop()->getPath(), "b");
+    BOOST_CHECK(queue.pop()->getEvent() == Event::overflow);
+
+    // an empty queue accepts more events than its capacity
+    BOOST_CHECK(queue.accept(3));
+}
+
+BOOST_AUTO_TEST_CASE(EventQueueOverflowMarkerTest)
+{
+    EventQueue queue;
+    queue.setLimit(1, OverflowPolicy::drop_oldest);
+    queue.push(makeEvent("a", Event::modify));
+    queue.push(makeEvent("b", Event::modify));
+    queue.push(makeEvent("c", Event::modify));
+    // merged with the queued marker
+    queue.push(makeEvent("", Event::overflow));
+
+    // the marker is never dropped and queued once
+    BOOST_CHECK_EQUAL(queue.size(), 2);
+    BOOST_CHECK_EQUAL(queue.getStatistics().dropped, 2);
+    const auto marker = queue.pop();
+    BOOST_CHECK(marker->getEvent() == Event::overflow);
+    BOOST_CHECK(marker->getPath().empty());
+    BOOST_CHECK_EQUAL(queue.pop()->getPath(), "c");
+    BOOST_CHECK(queue.empty());
+
+    // queued again with the next drop
+    queue.setLimit(1, OverflowPolicy::drop_newest);
+    queue.push(makeEvent("d", Event::modify));
+    queue.push(makeEvent("e", Event::modify));
+    BOOST_CHECK_EQUAL(queue.pop()->getPath(), "d");
+    BOOST_CHECK(queue.pop()->getEvent() == Event::overflow);
+    BOOST_CHECK(queue.empty());
+}
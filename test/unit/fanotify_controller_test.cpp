@@ -31,6 +31,7 @@
 #include <fstream>
 #include <future>
 #include <iostream>
+#include <thread>
 
 using namespace notifycpp;
 
@@ -0,0 +1,138 @@
+#include <notify-cpp/file_follower.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace notifycpp;
+
+namespace {
+struct FileFollowerHelper {
+    FileFollowerHelper()
+        : root(std::filesystem::absolute("file_follower.test"))
+        , log(root / "app.log")
+    {
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root);
+        append("existing\n");
+    }
+
+    ~FileFollowerHelper()
+    {
+        std::filesystem::remove_all(root);
+    }
+
+    void append(const std::string& content)
+    {
+        std::ofstream(log.string(), std::ios::app) << content;
+    }
+
+    const std::filesystem::path root;
+    const std::filesystem::path log;
+};
+}
+
+BOOST_FIXTURE_TEST_CASE(FileFollowerAppendTest, FileFollowerHelper)
+{
+    InotifyController controller;
+    std::string received;
+    FileFollower follower(controller, [&](const FileChunk& chunk) {
+        BOOST_CHECK_EQUAL(chunk.path, log);
+        BOOST_CHECK_EQUAL(chunk.offset, received.size() + 9);
+        received.append(chunk.data);
+    }, 4);
+    follower.follow(log);
+    BOOST_CHECK_EQUAL(follower.offset(log), 9);
+
+    append("first line\n");
+    // modify and close_write, the second finds nothing new
+    controller.runOnce();
+    controller.runOnce();
+    BOOST_CHECK_EQUAL(received, "first line\n");
+    BOOST_CHECK_EQUAL(follower.offset(log), 20);
+}
+
+BOOST_FIXTURE_TEST_CASE(FileFollowerTruncateTest, FileFollowerHelper)
+{
+    InotifyController controller;
+    std::string received;
+    bool truncated = false;
+    FileFollower follower(controller, [&](const FileChunk& chunk) {
+        truncated = truncated || chunk.truncated;
+        received.append(chunk.data);
+    });
+    follower.follow(log, 0);
+    BOOST_CHECK_EQUAL(received, "existing\n");
+
+    std::ofstream(log.string(), std::ios::trunc) << "new\n";
+    controller.runOnce();
+    BOOST_CHECK(truncated);
+    BOOST_CHECK_EQUAL(received, "existing\nnew\n");
+
+    follower.unfollow(log);
+    BOOST_CHECK_EQUAL(follower.offset(log), 0);
+    BOOST_CHECK_THROW(follower.follow(root / "missing"), std::runtime_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(FileFollowerRotationTest, FileFollowerHelper)
+{
+    InotifyController controller;
+    std::string received;
+    std::size_t restarts = 0;
+    FileFollower follower(controller, [&](const FileChunk& chunk) {
+        restarts += chunk.truncated;
+        received.append(chunk.data);
+    });
+    follower.follow(log);
+
+    append("a\n");
+    // modify and close_write
+    controller.runOnce();
+    controller.runOnce();
+
+    const auto rotated = root / "app.log.1";
+    std::filesystem::rename(log, rotated);
+    append("b\n");
+    // written before the new file was opened
+    std::ofstream(rotated.string(), std::ios::app) << "late\n";
+    controller.runOnce();
+    BOOST_CHECK_EQUAL(received, "a\nlate\nb\n");
+    BOOST_CHECK_EQUAL(restarts, 1);
+
+    std::ofstream(rotated.string(), std::ios::app) << "lost\n";
+    append("c\n");
+    controller.runOnce();
+    BOOST_CHECK_EQUAL(received, "a\nlate\nb\nc\n");
+    BOOST_CHECK_EQUAL(follower.offset(log), 4);
+}
+
+BOOST_FIXTURE_TEST_CASE(FileFollowerSharedWatchTest, FileFollowerHelper)
+{
+    const auto file = root / "app[1].log";
+    std::ofstream(file.string()) << "";
+
+    InotifyController controller;
+    std::size_t modified = 0;
+    controller.watchFile({ file, Event::modify }).onEvent(Event::modify, [&](Notification) { ++modified; });
+
+    std::string received;
+    FileFollower follower(controller, [&](const FileChunk& chunk) { received.append(chunk.data); });
+    follower.follow(root / "." / "app[1].log");
+    follower.follow(file);
+
+    std::ofstream(file.string(), std::ios::app) << "a\n";
+    controller.runOnce();
+    controller.runOnce();
+    BOOST_CHECK_EQUAL(received, "a\n");
+    BOOST_CHECK_EQUAL(follower.offset(file), 2);
+
+    // the wd of the file is shared, the watch stays
+    follower.unfollow(root / "app[1].log");
+    modified = 0;
+    std::ofstream(file.string(), std::ios::app) << "b\n";
+    controller.runOnce();
+    BOOST_CHECK_EQUAL(modified, 1);
+    BOOST_CHECK_EQUAL(received, "a\n");
+}
@@ -20,6 +20,7 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
+#include <notify-cpp/cursor.h>
 #include <notify-cpp/inotify.h>
 #include <notify-cpp/notify_controller.h>
 
@@ -27,11 +28,13 @@
 
 #include "filesystem_event_helper.hpp"
 
+#include <atomic>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <future>
 #include <iostream>
+#include <thread>
 
 /*
  * The test cases based on the original work from Erik Zenker for inotify-cpp.
@@ -245,4 +248,677 @@ BOOST_FIXTURE_TEST_CASE(countEvents, FilesystemEventHelper)
     BOOST_CHECK(futureOpen.get() == 2);
     notifier.stop();
     thread.join();
-}
\ No newline at end of file
+}
+BOOST_FIXTURE_TEST_CASE(shouldNotifyOnPath, FilesystemEventHelper)
+{
+    std::promise<Notification> promisedOther;
+    InotifyController notifier = InotifyController();
+    notifier.watchFile({testFileOne_, Event::close_write})
+        .onPath((testDirectory_ / "*.txt").string(), Event::close_write, [&](Notification notification) {
+            promisedOpen_.set_value(notification);
+        })
+        .onPath((testDirectory_ / "*.log").string(), Event::close_write, [&](Notification notification) {
+            promisedOther.set_value(notification);
+        });
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    openFile(testFileOne_);
+
+    auto futureOpen = promisedOpen_.get_future();
+    BOOST_CHECK(futureOpen.wait_for(timeout_) == std::future_status::ready);
+    BOOST_CHECK(futureOpen.get().getPath() == testFileOne_);
+    BOOST_CHECK(promisedOther.get_future().wait_for(std::chrono::milliseconds(0)) == std::future_status::timeout);
+    thread.join();
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldRegisterObserverWhileRunning, FilesystemEventHelper)
+{
+    InotifyController notifier = InotifyController();
+    notifier.watchFile({testFileOne_, Event::close_write});
+
+    std::thread thread([&notifier]() { notifier.run(); });
+
+    notifier.onEvent(Event::close_write, [&](Notification notification) {
+        promisedOpen_.set_value(notification);
+    });
+    openFile(testFileOne_);
+
+    auto futureOpen = promisedOpen_.get_future();
+    BOOST_CHECK(futureOpen.wait_for(timeout_) == std::future_status::ready);
+
+    notifier.removeEventObserver(Event::close_write);
+    notifier.stop();
+    thread.join();
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldWatchFileWhileRunning, FilesystemEventHelper)
+{
+    InotifyController notifier = InotifyController();
+    notifier.watchFile({testFileOne_, Event::close_write}).onEvent(Event::close_write, [&](Notification notification) {
+        if (notification.getPath() == testFileTwo_.string())
+            promisedOpen_.set_value(notification);
+    });
+
+    std::thread thread([&notifier]() { notifier.run(); });
+
+    notifier.watchFile({testFileTwo_, Event::close_write});
+    notifier.unwatch(testFileOne_);
+    openFile(testFileTwo_);
+
+    auto futureOpen = promisedOpen_.get_future();
+    BOOST_CHECK(futureOpen.wait_for(timeout_) == std::future_status::ready);
+
+    notifier.stop();
+    thread.join();
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldExecuteObserverOnDedicatedThread, FilesystemEventHelper)
+{
+    std::promise<std::thread::id> observerThread;
+    InotifyController notifier = InotifyController();
+    notifier.watchFile({testFileOne_, Event::close_write})
+        .onEvent(Event::close_write, [&](Notification) {
+            observerThread.set_value(std::this_thread::get_id());
+        },
+            ExecutionPolicy::dedicated);
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    openFile(testFileOne_);
+
+    auto futureThread = observerThread.get_future();
+    BOOST_CHECK(futureThread.wait_for(timeout_) == std::future_status::ready);
+    const auto observerThreadId = futureThread.get();
+    BOOST_CHECK(observerThreadId != thread.get_id());
+    BOOST_CHECK(observerThreadId != std::this_thread::get_id());
+    thread.join();
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldFinishQueuedNotificationsOnStop, FilesystemEventHelper)
+{
+    std::promise<void> observerStarted;
+    std::atomic<bool> observerFinished{false};
+    InotifyController notifier = InotifyController();
+    notifier.watchFile({testFileOne_, Event::close_write})
+        .onEvent(Event::close_write, [&](Notification) {
+            observerStarted.set_value();
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            observerFinished = true;
+        },
+            ExecutionPolicy::dedicated);
+
+    std::thread thread([&notifier]() { notifier.run(); });
+
+    openFile(testFileOne_);
+
+    BOOST_CHECK(observerStarted.get_future().wait_for(timeout_) == std::future_status::ready);
+    notifier.stop();
+    BOOST_CHECK(observerFinished);
+    thread.join();
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldReturnCriticalEventsFirst, FilesystemEventHelper)
+{
+    std::filesystem::create_directories(recursiveTestDirectory_);
+    const auto criticalFile = recursiveTestDirectory_ / "critical.txt";
+
+    Inotify inotify;
+    inotify.setReadTimeout(std::chrono::milliseconds(100));
+    inotify.watchFile({ testFileOne_, Event::close_write });
+    inotify.watchCriticalPath({ recursiveTestDirectory_, Event::close_write });
+
+    openFile(testFileOne_);
+    openFile(criticalFile);
+
+    auto event = inotify.getNextEvent();
+    BOOST_REQUIRE(event);
+    BOOST_CHECK(event->getPath() == criticalFile);
+    BOOST_CHECK(event->getPriority() == Priority::critical);
+
+    event = inotify.getNextEvent();
+    BOOST_REQUIRE(event);
+    BOOST_CHECK(event->getPath() == testFileOne_);
+    BOOST_CHECK(event->getPriority() == Priority::normal);
+
+    std::filesystem::remove_all(recursiveTestDirectory_);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldCountFailedNotifications, FilesystemEventHelper)
+{
+    InotifyController notifier = InotifyController();
+    notifier.watchFile({testFileOne_, Event::close_write})
+        .onEvent(Event::close_write, [](Notification) {
+            throw std::runtime_error("observer failed");
+        },
+            ExecutionPolicy::dedicated);
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    openFile(testFileOne_);
+    thread.join();
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout_;
+    while (notifier.getFailedNotifications() == 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    BOOST_CHECK(notifier.getFailedNotifications() == 1);
+    BOOST_CHECK(notifier.getDroppedNotifications() == 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldBlockOnFullQueue, FilesystemEventHelper)
+{
+    size_t counter = 0;
+    InotifyController notifier = InotifyController();
+    notifier.setQueueLimit(1, OverflowPolicy::block)
+        .watchFile({testFileOne_, Event::open | Event::close_write})
+        .onEvents({Event::open, Event::close_write}, [&](Notification) {
+            if (++counter == 2)
+                _promisedCounter.set_value(counter);
+        });
+
+    std::thread thread([&notifier]() { notifier.run(); });
+
+    openFile(testFileOne_);
+
+    auto futureCounter = _promisedCounter.get_future();
+    BOOST_CHECK(futureCounter.wait_for(timeout_) == std::future_status::ready);
+    BOOST_CHECK(notifier.getQueueStatistics().highWatermark == 1);
+    BOOST_CHECK(notifier.getQueueStatistics().dropped == 0);
+    notifier.stop();
+    thread.join();
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldCoalesceEvents, FilesystemEventHelper)
+{
+    size_t counter = 0;
+    InotifyController notifier = InotifyController();
+    notifier.coalesce(std::chrono::milliseconds(200))
+        .watchFile({testFileOne_, Event::open | Event::close_write})
+        .onPath(testFileOne_.string(), Event::all, [&](Notification notification) {
+            if (++counter == 1)
+                promisedOpen_.set_value(notification);
+        });
+
+    std::thread thread([&notifier]() { notifier.run(); });
+
+    openFile(testFileOne_);
+
+    auto futureOpen = promisedOpen_.get_future();
+    BOOST_CHECK(futureOpen.wait_for(timeout_) == std::future_status::ready);
+    BOOST_CHECK(futureOpen.get().getEvent() == (Event::open | Event::close_write));
+    notifier.stop();
+    thread.join();
+    BOOST_CHECK_EQUAL(counter, 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldNotifyObserverOncePerCoalescedEvent, FilesystemEventHelper)
+{
+    std::atomic<size_t> counter{0};
+    std::atomic<size_t> modified{0};
+    InotifyController notifier = InotifyController();
+    notifier.coalesce(std::chrono::milliseconds(200))
+        .watchFile({testFileOne_, Event::open | Event::close_write})
+        .onEvent(Event::modify, [&](Notification) { ++modified; })
+        .onEvents({Event::open, Event::close_write}, [&](Notification notification) {
+            if (++counter == 1)
+                promisedOpen_.set_value(notification);
+        });
+
+    std::thread thread([&notifier]() { notifier.run(); });
+
+    openFile(testFileOne_);
+
+    auto futureOpen = promisedOpen_.get_future();
+    BOOST_CHECK(futureOpen.wait_for(timeout_) == std::future_status::ready);
+    BOOST_CHECK(futureOpen.get().getEvent() == (Event::open | Event::close_write));
+    notifier.stop();
+    thread.join();
+    BOOST_CHECK_EQUAL(counter, 1);
+    BOOST_CHECK_EQUAL(modified, 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldSettleChangeSet, FilesystemEventHelper)
+{
+    std::promise<ChangeSet> promisedChanges;
+    const auto tmpFile = testDirectory_ / "test.txt.tmp";
+
+    InotifyController notifier = InotifyController();
+    notifier.watchPathRecursively({testDirectory_, Event::all})
+        .onChangeSet(std::chrono::milliseconds(100), [&](const ChangeSet& changes) {
+            promisedChanges.set_value(changes);
+        });
+
+    std::thread thread([&notifier]() { notifier.run(); });
+
+    openFile(tmpFile);
+    std::filesystem::rename(tmpFile, testFileOne_);
+
+    auto futureChanges = promisedChanges.get_future();
+    BOOST_CHECK(futureChanges.wait_for(timeout_) == std::future_status::ready);
+    const auto changes = futureChanges.get();
+    BOOST_REQUIRE_EQUAL(changes.size(), 1);
+    BOOST_CHECK(changes[0].type == ChangeType::modified);
+    BOOST_CHECK(changes[0].path == testFileOne_);
+    notifier.stop();
+    thread.join();
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldPairRename, FilesystemEventHelper)
+{
+    std::promise<Rename> promisedRename;
+    std::atomic<bool> movedFrom(false);
+    const auto renamedFile = testDirectory_ / "renamed.txt";
+
+    InotifyController notifier = InotifyController();
+    notifier.watchPathRecursively({testDirectory_, Event::move})
+        .onEvent(Event::moved_from, [&](Notification) { movedFrom = true; })
+        .onRename([&](const Rename& rename) { promisedRename.set_value(rename); });
+
+    std::thread thread([&notifier]() { notifier.run(); });
+
+    std::filesystem::rename(testFileOne_, renamedFile);
+
+    auto futureRename = promisedRename.get_future();
+    BOOST_CHECK(futureRename.wait_for(timeout_) == std::future_status::ready);
+    const auto rename = futureRename.get();
+    BOOST_CHECK(rename.from == testFileOne_);
+    BOOST_CHECK(rename.to == renamedFile);
+    BOOST_CHECK(!movedFrom);
+    notifier.stop();
+    thread.join();
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldReportPathsBelowRenamedDirectory, FilesystemEventHelper)
+{
+    std::promise<std::string> promisedPath;
+    const auto sourceDirectory = testDirectory_ / "renameSource";
+    const auto targetDirectory = testDirectory_ / "renameTarget";
+    const auto file = targetDirectory / "sub" / "file.txt";
+    std::filesystem::remove_all(sourceDirectory);
+    std::filesystem::remove_all(targetDirectory);
+    std::filesystem::create_directories(sourceDirectory / "sub");
+
+    InotifyController notifier = InotifyController();
+    notifier.watchPathRecursively({testDirectory_, Event::close_write})
+        .onPath(file.string(), Event::close_write, [&](Notification notification) {
+            promisedPath.set_value(notification.getPath());
+        });
+
+    std::thread thread([&notifier]() { notifier.run(); });
+
+    std::filesystem::rename(sourceDirectory, targetDirectory);
+    openFile(file);
+
+    auto futurePath = promisedPath.get_future();
+    BOOST_CHECK(futurePath.wait_for(timeout_) == std::future_status::ready);
+    notifier.stop();
+    thread.join();
+    std::filesystem::remove_all(targetDirectory);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldAnswerChangedSince, FilesystemEventHelper)
+{
+    std::promise<void> promisedWrite;
+
+    InotifyController notifier = InotifyController();
+    notifier.watchFile({testFileOne_, Event::close_write})
+        .watchFile({testFileTwo_, Event::close_write})
+        .trackChanges()
+        .onEvent(Event::close_write, [&](Notification notification) {
+            if (notification.getPath() == testFileTwo_.string())
+                promisedWrite.set_value();
+        });
+
+    const auto start = notifier.getClock();
+    std::thread thread([&notifier]() { notifier.run(); });
+
+    openFile(testFileOne_);
+    openFile(testFileTwo_);
+
+    BOOST_CHECK(promisedWrite.get_future().wait_for(timeout_) == std::future_status::ready);
+    const auto changes = notifier.changedSince(start);
+    BOOST_REQUIRE_EQUAL(changes.size(), 2);
+    BOOST_CHECK(changes[0].path == testFileOne_);
+    BOOST_CHECK(changes[1].path == testFileTwo_);
+    BOOST_CHECK(notifier.changedSince(changes[1].clock).empty());
+    notifier.stop();
+    thread.join();
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldReportOfflineChangesFromSnapshot, FilesystemEventHelper)
+{
+    const std::filesystem::path snapshot("inotify.snapshot");
+    std::filesystem::remove(snapshot);
+    {
+        InotifyController notifier = InotifyController();
+        notifier.attachTreeModel(std::make_shared<TreeModel>(testDirectory_))
+            .persistTreeModel(snapshot, std::chrono::seconds(60));
+        notifier.stop();
+        notifier.run();
+    }
+    BOOST_REQUIRE(std::filesystem::exists(snapshot));
+
+    const auto offlineFile = testDirectory_ / "offline.txt";
+    openFile(offlineFile);
+
+    std::promise<std::string> promisedCreate;
+    InotifyController notifier = InotifyController();
+    notifier.watchPathRecursively({testDirectory_, Event::create})
+        .attachTreeModel(std::make_shared<TreeModel>(testDirectory_), snapshot)
+        .onEvent(Event::create, [&](Notification notification) { promisedCreate.set_value(notification.getPath()); });
+
+    notifier.runOnce();
+
+    auto futureCreate = promisedCreate.get_future();
+    BOOST_REQUIRE(futureCreate.wait_for(timeout_) == std::future_status::ready);
+    BOOST_CHECK(futureCreate.get() == offlineFile.string());
+    std::filesystem::remove(offlineFile);
+    std::filesystem::remove(snapshot);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldReplayRecordedEvents, FilesystemEventHelper)
+{
+    const std::filesystem::path recording("inotify.recording");
+    const auto subDirectory = testDirectory_ / "replay";
+    std::filesystem::remove_all(subDirectory);
+
+    std::vector<std::pair<Event, std::filesystem::path>> recorded;
+    {
+        Inotify inotify;
+        inotify.watchPathRecursively({testDirectory_, Event::create | Event::close_write});
+        inotify.record(recording);
+        inotify.setReadTimeout(std::chrono::milliseconds(200));
+
+        const auto drain = [&]() {
+            while (auto event = inotify.getNextEvent())
+                recorded.emplace_back(event->getEvent(), event->getPath());
+        };
+
+        std::filesystem::create_directory(subDirectory);
+        drain();
+        // only seen if the watch added while decoding is replayed
+        openFile(subDirectory / "test.txt");
+        openFile(testFileOne_);
+        drain();
+    }
+    BOOST_REQUIRE_GE(recorded.size(), 3);
+
+    std::vector<std::pair<Event, std::filesystem::path>> replayed;
+    ReplayController notifier(recording, ReplaySpeed::fastest);
+    notifier.onEvents({Event::create, Event::close_write}, [&](Notification notification) {
+        replayed.emplace_back(notification.getEvent(), notification.getPath());
+    });
+    notifier.run();
+
+    BOOST_CHECK(replayed == recorded);
+    std::filesystem::remove_all(subDirectory);
+    std::filesystem::remove(recording);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldUnwatchRecursiveSubtree, FilesystemEventHelper)
+{
+    const auto deep = recursiveTestDirectory_ / "deep";
+    std::filesystem::create_directories(deep);
+
+    Inotify inotify;
+    inotify.watchPathRecursively({testDirectory_, Event::close_write});
+    inotify.setReadTimeout(std::chrono::milliseconds(100));
+    BOOST_CHECK(inotify.getNextEvent() == nullptr);
+    BOOST_CHECK_EQUAL(inotify.getWatchStatistics().watches, 3);
+
+    inotify.unwatch({testDirectory_});
+    BOOST_CHECK(inotify.getNextEvent() == nullptr);
+    openFile(deep / "test.txt");
+    BOOST_CHECK(inotify.getNextEvent() == nullptr);
+    BOOST_CHECK_EQUAL(inotify.getWatchStatistics().watches, 0);
+    std::filesystem::remove_all(recursiveTestDirectory_);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldReportWriteRightAfterWatch, FilesystemEventHelper)
+{
+    const std::size_t count = 50;
+    std::filesystem::create_directories(recursiveTestDirectory_);
+
+    Inotify inotify;
+    inotify.setReadTimeout(std::chrono::milliseconds(10));
+    std::atomic<std::size_t> received(0);
+    std::atomic<bool> done(false);
+    std::thread reader([&]() {
+        while (!done)
+            if (inotify.getNextEvent())
+                ++received;
+    });
+
+    // the reader is waiting while each watch is added
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto directory = recursiveTestDirectory_ / std::to_string(i);
+        std::filesystem::create_directory(directory);
+        inotify.watchDirectory({directory, Event::close_write});
+        openFile(directory / "test.txt");
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout_;
+    while (received < count && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    done = true;
+    reader.join();
+    BOOST_CHECK_EQUAL(received, count);
+    std::filesystem::remove_all(recursiveTestDirectory_);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldKeepFollowingInWatchedDirectory, FilesystemEventHelper)
+{
+    const auto rotated = testDirectory_ / "test.txt.1";
+    Inotify inotify;
+    inotify.setReadTimeout(std::chrono::milliseconds(100));
+    inotify.followPath({testFileOne_, Event::close_write});
+    // replaces the mask of the directory watched for the follow
+    inotify.watchDirectory({testDirectory_, Event::close_write});
+
+    const auto replaced = [&]() {
+        std::filesystem::rename(testFileOne_, rotated);
+        openFile(testFileOne_);
+        std::size_t count = 0;
+        while (auto event = inotify.getNextEvent())
+            count += event->getEvent() == Event::replaced;
+        return count;
+    };
+
+    BOOST_CHECK(inotify.getNextEvent() == nullptr);
+    BOOST_CHECK_EQUAL(replaced(), 1);
+
+    // the directory stays watched for the follow
+    inotify.unwatch({testDirectory_});
+    BOOST_CHECK(inotify.getNextEvent() == nullptr);
+    BOOST_CHECK_EQUAL(replaced(), 1);
+    std::filesystem::remove(rotated);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldReplayHistorySinceSequence, FilesystemEventHelper)
+{
+    InotifyController notifier = InotifyController();
+    std::vector<std::uint64_t> sequences;
+    notifier.watchFile({testFileOne_, Event::close_write})
+        .keepHistory(16)
+        .onEvent(Event::close_write, [&](Notification notification) { sequences.push_back(notification.getSequence()); });
+
+    openFile(testFileOne_);
+    notifier.runOnce();
+    openFile(testFileOne_);
+    notifier.runOnce();
+
+    BOOST_REQUIRE_EQUAL(sequences.size(), 2);
+    BOOST_CHECK_LT(sequences[0], sequences[1]);
+
+    // a subscriber which acked the first event catches up
+    std::vector<std::uint64_t> replayed;
+    BOOST_CHECK(notifier.replaySince(sequences[0], [&](Notification notification) {
+        replayed.push_back(notification.getSequence());
+    }));
+    BOOST_REQUIRE_EQUAL(replayed.size(), 1);
+    BOOST_CHECK_EQUAL(replayed[0], sequences[1]);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldResumeFromCursorAfterRestart, FilesystemEventHelper)
+{
+    const std::filesystem::path journal("controller.journal");
+    const std::filesystem::path file("controller.cursor");
+    std::filesystem::remove_all(journal);
+    std::filesystem::remove(file);
+
+    std::vector<std::uint64_t> sequences;
+    {
+        Cursor cursor(file);
+        InotifyController notifier = InotifyController();
+        notifier.watchFile({testFileOne_, Event::close_write})
+            .keepHistory(16)
+            .writeJournal(std::make_shared<JournalWriter>(journal))
+            .onEvent(Event::close_write, [&](Notification notification) { sequences.push_back(notification.getSequence()); });
+
+        openFile(testFileOne_);
+        notifier.runOnce();
+        openFile(testFileOne_);
+        notifier.runOnce();
+        BOOST_REQUIRE_EQUAL(sequences.size(), 2);
+        // the second event is lost with the process
+        cursor.ack(sequences[0]);
+    }
+
+    Cursor cursor(file);
+    BOOST_REQUIRE_EQUAL(cursor.position(), sequences[0]);
+    {
+        InotifyController notifier = InotifyController();
+        notifier.watchFile({testFileOne_, Event::close_write})
+            .keepHistory(16)
+            .writeJournal(std::make_shared<JournalWriter>(journal))
+            .onEvent(Event::close_write, [&](Notification notification) { sequences.push_back(notification.getSequence()); });
+        BOOST_CHECK_EQUAL(notifier.getClock(), sequences[1]);
+
+        // not in the history of this process, read from the journal
+        BOOST_CHECK(!notifier.replaySince(cursor.position(), [](Notification) {}));
+        JournalReader reader(journal);
+        JournalRecord record;
+        BOOST_REQUIRE(reader.seek(cursor.position() + 1));
+        BOOST_REQUIRE(reader.next(record));
+        BOOST_CHECK_EQUAL(record.sequence, sequences[1]);
+        cursor.ack(record.sequence);
+
+        openFile(testFileOne_);
+        notifier.runOnce();
+        BOOST_REQUIRE_EQUAL(sequences.size(), 3);
+        BOOST_CHECK_GT(sequences[2], cursor.position());
+        cursor.ack(sequences[2]);
+        BOOST_CHECK_EQUAL(cursor.position(), sequences[2]);
+    }
+
+    std::filesystem::remove_all(journal);
+    std::filesystem::remove(file);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldContinueAbovePersistedClock, FilesystemEventHelper)
+{
+    const std::filesystem::path mark("controller.clock");
+    std::filesystem::remove(mark);
+
+    std::uint64_t sequence = 0;
+    {
+        InotifyController notifier = InotifyController();
+        notifier.persistClock(mark)
+            .watchFile({testFileOne_, Event::close_write})
+            .onEvent(Event::close_write, [&](Notification notification) { sequence = notification.getSequence(); });
+
+        openFile(testFileOne_);
+        notifier.runOnce();
+        BOOST_REQUIRE_GT(sequence, 0);
+    }
+
+    // without a journal the clock continues above the mark, a position
+    // of an earlier process is never taken for one of this process
+    InotifyController notifier = InotifyController();
+    notifier.persistClock(mark).watchFile({testFileOne_, Event::close_write}).keepHistory(16);
+    BOOST_CHECK_GT(notifier.getClock(), sequence);
+    BOOST_CHECK(!notifier.replaySince(sequence, [](Notification) {}));
+    BOOST_CHECK(!notifier.replaySince(notifier.getClock() + 1, [](Notification) {}));
+    BOOST_CHECK(notifier.replaySince(notifier.getClock(), [](Notification) {}));
+
+    std::filesystem::remove(mark);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldInvalidateStatCacheBeforeDispatch, FilesystemEventHelper)
+{
+    InotifyController notifier = InotifyController();
+    auto cache = std::make_shared<StatCache>();
+    std::uint64_t size = 0;
+    notifier.watchFile({testFileOne_, Event::close_write | StatCache::invalidatingEvents()})
+        .attachStatCache(cache)
+        .onEvent(Event::close_write, [&](Notification notification) { size = cache->stat(notification.getPath()).size; });
+
+    const auto before = cache->stat(testFileOne_).size;
+    {
+        std::ofstream stream(testFileOne_.string(), std::ios::app);
+        stream << "appended";
+    }
+    // modify first, then close_write
+    notifier.runOnce();
+    notifier.runOnce();
+
+    BOOST_CHECK_EQUAL(size, before + 8);
+    BOOST_CHECK_EQUAL(cache->getStatistics().misses, 2);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldRejectWatchesMissingStatCacheEvents, FilesystemEventHelper)
+{
+    auto cache = std::make_shared<StatCache>();
+    {
+        // attrib, create and delete would never invalidate the cache
+        InotifyController notifier = InotifyController();
+        notifier.watchFile({testFileOne_, Event::close_write});
+        BOOST_CHECK_THROW(notifier.attachStatCache(cache), std::runtime_error);
+    }
+
+    InotifyController notifier = InotifyController();
+    notifier.attachStatCache(cache).watchPathRecursively({testDirectory_, Event::all});
+    BOOST_CHECK_THROW(notifier.watchFile({testFileOne_, Event::close_write}), std::invalid_argument);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldSuppressUnchangedWrites, FilesystemEventHelper)
+{
+    InotifyController notifier = InotifyController();
+    std::size_t writes = 0;
+    notifier.watchFile({testFileOne_, Event::close_write})
+        .suppressUnchangedWrites()
+        .onEvent(Event::close_write, [&](Notification) { ++writes; });
+
+    openFile(testFileOne_);
+    notifier.runOnce();
+    // rewritten with the same content
+    openFile(testFileOne_);
+    notifier.runOnce();
+
+    BOOST_CHECK_EQUAL(writes, 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(shouldFollowPathAcrossReplace, FilesystemEventHelper)
+{
+    InotifyController notifier = InotifyController();
+    std::vector<Event> events;
+    notifier.followPath({ testFileOne_, Event::close_write })
+        .onEvents({ Event::close_write, Event::replaced }, [&](Notification notification) {
+            BOOST_CHECK_EQUAL(notification.getPath(), testFileOne_.string());
+            events.push_back(notification.getEvent());
+        });
+
+    // atomic replace
+    const auto replacement = testDirectory_ / "test.txt.tmp";
+    openFile(replacement);
+    std::filesystem::rename(replacement, testFileOne_);
+    notifier.runOnce();
+
+    // the old file is not watched anymore
+    openFile(testFileOne_);
+    notifier.runOnce();
+
+    BOOST_REQUIRE_EQUAL(events.size(), 2);
+    BOOST_CHECK(events[0] == Event::replaced);
+    BOOST_CHECK(events[1] == Event::close_write);
+}
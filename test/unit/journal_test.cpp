@@ -0,0 +1,142 @@
+#include <notify-cpp/journal.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace notifycpp;
+
+struct JournalHelper {
+    JournalHelper()
+        : directory_("journalDirectory")
+    {
+        std::filesystem::remove_all(directory_);
+    }
+
+    ~JournalHelper()
+    {
+        std::filesystem::remove_all(directory_);
+    }
+
+    std::filesystem::path directory_;
+};
+
+BOOST_FIXTURE_TEST_CASE(JournalRoundTripTest, JournalHelper)
+{
+    {
+        JournalWriter writer(directory_);
+        BOOST_CHECK_EQUAL(writer.append(Event::create, "/tmp/a/one.txt", 10, 1000), 1);
+        BOOST_CHECK_EQUAL(writer.append(Event::modify, "/tmp/a/two.txt", 11, 900), 2);
+        BOOST_CHECK_EQUAL(writer.append(FileSystemEvent("/tmp/b", Event::delete_sub), 1100), 3);
+        writer.sync();
+    }
+
+    JournalReader reader(directory_);
+    JournalRecord record;
+    BOOST_REQUIRE(reader.next(record));
+    BOOST_CHECK_EQUAL(record.sequence, 1);
+    BOOST_CHECK_EQUAL(record.timestamp, 1000);
+    BOOST_CHECK(record.event == Event::create);
+    BOOST_CHECK_EQUAL(record.path, "/tmp/a/one.txt");
+    BOOST_CHECK_EQUAL(record.pid, 10);
+
+    BOOST_REQUIRE(reader.next(record));
+    BOOST_CHECK_EQUAL(record.timestamp, 900);
+    BOOST_CHECK_EQUAL(record.path, "/tmp/a/two.txt");
+
+    BOOST_REQUIRE(reader.next(record));
+    BOOST_CHECK_EQUAL(record.sequence, 3);
+    BOOST_CHECK(record.event == Event::delete_sub);
+    BOOST_CHECK_EQUAL(record.path, "/tmp/b");
+    BOOST_CHECK(!reader.next(record));
+}
+
+BOOST_FIXTURE_TEST_CASE(JournalRotateAndSeekTest, JournalHelper)
+{
+    const std::size_t records = 20000;
+    {
+        JournalWriter writer(directory_, 1 << 16);
+        for (std::size_t i = 1; i <= records; ++i)
+            writer.append(Event::modify, "/var/log/file" + std::to_string(i), 0, static_cast<std::int64_t>(i));
+    }
+    BOOST_CHECK_GT(journal::segments(directory_).size(), 1);
+
+    JournalReader reader(directory_);
+    JournalRecord record;
+    for (std::uint64_t sequence : { 1, 2, 777, 12345, 20000 }) {
+        BOOST_REQUIRE(reader.seek(sequence));
+        BOOST_REQUIRE(reader.next(record));
+        BOOST_CHECK_EQUAL(record.sequence, sequence);
+        BOOST_CHECK_EQUAL(record.path, "/var/log/file" + std::to_string(sequence));
+    }
+    BOOST_CHECK(!reader.next(record));
+    BOOST_CHECK(!reader.seek(records + 1));
+    BOOST_CHECK_EQUAL(reader.lastSequence(), records);
+}
+
+BOOST_FIXTURE_TEST_CASE(JournalContinueTest, JournalHelper)
+{
+    {
+        JournalWriter writer(directory_);
+        writer.append(Event::create, "/tmp/a", 0, 1);
+        writer.append(Event::create, "/tmp/b", 0, 2);
+    }
+
+    JournalWriter writer(directory_);
+    BOOST_CHECK_EQUAL(writer.lastSequence(), 2);
+    BOOST_CHECK_EQUAL(writer.append(Event::delete_sub, "/tmp/a", 0, 3), 3);
+
+    // records of the open segment are visible to readers
+    JournalReader reader(directory_);
+    JournalRecord record;
+    BOOST_REQUIRE(reader.seek(3));
+    BOOST_REQUIRE(reader.next(record));
+    BOOST_CHECK_EQUAL(record.path, "/tmp/a");
+    BOOST_CHECK(record.event == Event::delete_sub);
+}
+
+BOOST_FIXTURE_TEST_CASE(JournalTornSegmentTest, JournalHelper)
+{
+    {
+        JournalWriter writer(directory_);
+        writer.append(Event::create, "/tmp/a", 0, 1);
+        writer.append(Event::create, "/tmp/b", 0, 2);
+    }
+    {
+        JournalWriter writer(directory_);
+        writer.append(Event::modify, "/tmp/a", 0, 3);
+        writer.append(Event::modify, "/tmp/b", 0, 4);
+    }
+    auto segments = journal::segments(directory_);
+    BOOST_REQUIRE_EQUAL(segments.size(), 2);
+
+    // a record torn by a crash, its bytes counted as used already
+    const auto written = std::filesystem::file_size(segments[1]);
+    {
+        std::fstream segment(segments[1], std::ios::in | std::ios::out | std::ios::binary);
+        segment.seekp(0, std::ios::end);
+        segment.write("\xff\xff\xff", 3);
+        const std::uint64_t used = written + 3;
+        segment.seekp(24);
+        segment.write(reinterpret_cast<const char*>(&used), sizeof(used));
+    }
+    // a segment whose header was never written
+    std::ofstream(directory_ / "00000000000000000005.journal") << "torn";
+    BOOST_CHECK_THROW(JournalReader(directory_).lastSequence(), std::runtime_error);
+
+    JournalWriter writer(directory_);
+    BOOST_CHECK_EQUAL(writer.lastSequence(), 4);
+    BOOST_CHECK_EQUAL(std::filesystem::file_size(segments[1]), written);
+    BOOST_CHECK_EQUAL(writer.append(Event::delete_sub, "/tmp/b", 0, 5), 5);
+
+    JournalReader reader(directory_);
+    JournalRecord record;
+    for (std::uint64_t sequence = 1; sequence <= 5; ++sequence) {
+        BOOST_REQUIRE(reader.next(record));
+        BOOST_CHECK_EQUAL(record.sequence, sequence);
+    }
+    BOOST_CHECK(!reader.next(record));
+}
@@ -0,0 +1,80 @@
+#include <notify-cpp/path_router.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace notifycpp;
+
+namespace {
+void dispatch(const PathRouter& router, const std::string& path, Event event = Event::modify)
+{
+    for (const auto* route : router.match(path, event))
+        route->observer({event, path});
+}
+}
+
+BOOST_AUTO_TEST_CASE(PathRouterPrefixTest)
+{
+    PathRouter router;
+    std::vector<std::string> hits;
+    router.add("/srv/b/config", Event::all, [&](Notification n) { hits.push_back("config:" + n.getPath()); });
+
+    dispatch(router, "/srv/b/config");
+    dispatch(router, "/srv/b/config/app.yaml");
+    dispatch(router, "/srv/b/configuration");
+    dispatch(router, "/srv/b");
+
+    BOOST_CHECK_EQUAL(hits.size(), 2);
+    BOOST_CHECK_EQUAL(hits[0], "config:/srv/b/config");
+    BOOST_CHECK_EQUAL(hits[1], "config:/srv/b/config/app.yaml");
+}
+
+BOOST_AUTO_TEST_CASE(PathRouterGlobTest)
+{
+    PathRouter router;
+    size_t logs = 0;
+    size_t yaml = 0;
+    router.add("/srv/a/**/*.log", Event::modify, [&](Notification) { ++logs; });
+    router.add("/srv/b/config/[a-c]?.yaml", Event::all, [&](Notification) { ++yaml; });
+
+    dispatch(router, "/srv/a/x.log");
+    dispatch(router, "/srv/a/b/c/x.log");
+    dispatch(router, "/srv/a/b/c/x.txt");
+    dispatch(router, "/srv/a/b/c/x.log", Event::open);
+    BOOST_CHECK_EQUAL(logs, 2);
+
+    dispatch(router, "/srv/b/config/a1.yaml");
+    dispatch(router, "/srv/b/config/d1.yaml");
+    dispatch(router, "/srv/b/config/a12.yaml");
+    dispatch(router, "/srv/b/config/sub/a1.yaml");
+    BOOST_CHECK_EQUAL(yaml, 1);
+}
+
+BOOST_AUTO_TEST_CASE(PathRouterMatchesRouteOnceTest)
+{
+    PathRouter router;
+    size_t counter = 0;
+    router.add("/srv/**/**/*.log", Event::all, [&](Notification) { ++counter; });
+
+    dispatch(router, "/srv/a/b/x.log");
+    BOOST_CHECK_EQUAL(counter, 1);
+    BOOST_CHECK_THROW(router.add("/srv/[a-", Event::all, [](Notification) {}), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(PathRouterRemoveTest)
+{
+    PathRouter router;
+    size_t counter = 0;
+    router.add("/srv/*.log", Event::all, [&](Notification) { ++counter; });
+    router.add("/srv/b", Event::all, [&](Notification) { ++counter; });
+
+    router.remove("/srv/*.log");
+    dispatch(router, "/srv/x.log");
+    BOOST_CHECK_EQUAL(counter, 0);
+    BOOST_CHECK(!router.empty());
+
+    router.remove("/srv/b");
+    BOOST_CHECK(router.empty());
+}
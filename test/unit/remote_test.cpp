@@ -0,0 +1,210 @@
+#include <notify-cpp/remote_notify.h>
+#include <notify-cpp/remote_protocol.h>
+#include <notify-cpp/watch_server.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace notifycpp;
+
+struct WatchServerHelper {
+    WatchServerHelper()
+        : directory_(std::filesystem::absolute("watchServerDirectory"))
+        , subDirectory_(directory_ / "sub")
+        , socket_(std::filesystem::absolute("watchServer.sock"))
+        , server_(socket_)
+        , thread_([this]() { server_.run(); })
+    {
+        std::filesystem::create_directories(subDirectory_);
+    }
+
+    ~WatchServerHelper()
+    {
+        server_.stop();
+        thread_.join();
+        std::filesystem::remove_all(directory_);
+    }
+
+    bool waitForRoots(std::size_t roots)
+    {
+        for (int i = 0; i < 100 && server_.roots() != roots; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return server_.roots() == roots;
+    }
+
+    std::filesystem::path directory_;
+    std::filesystem::path subDirectory_;
+    std::filesystem::path socket_;
+    WatchServer server_;
+    std::thread thread_;
+};
+
+BOOST_AUTO_TEST_CASE(RemoteProtocolTest)
+{
+    std::string frames;
+    remote::encodeSubscribe(frames, { 7, Event::create | Event::modify, true, "/tmp/a" });
+    std::string batch;
+    remote::appendEvent(batch, Event::create, "/tmp/a/one");
+    remote::appendEvent(batch, Event::modify, "/tmp/a/two");
+    remote::encodeEvents(frames, batch, 2);
+
+    std::string_view input(frames.data(), frames.size() - 1);
+    remote::FrameType type;
+    std::string_view payload;
+    BOOST_REQUIRE(remote::decodeFrame(input, type, payload));
+    BOOST_CHECK(type == remote::FrameType::subscribe);
+    const auto subscription = remote::decodeSubscribe(payload);
+    BOOST_CHECK_EQUAL(subscription.id, 7);
+    BOOST_CHECK(subscription.recursive);
+    BOOST_CHECK(subscription.path == "/tmp/a");
+    BOOST_CHECK(remote::matches(subscription, Event::create, "/tmp/a/b/c"));
+    BOOST_CHECK(!remote::matches(subscription, Event::open, "/tmp/a/b/c"));
+    BOOST_CHECK(!remote::matches(subscription, Event::create, "/tmp/ab"));
+
+    // the events frame is incomplete
+    BOOST_CHECK(!remote::decodeFrame(input, type, payload));
+    input = std::string_view(frames).substr(frames.size() - input.size() - 1);
+    BOOST_REQUIRE(remote::decodeFrame(input, type, payload));
+    const auto events = remote::decodeEvents(payload);
+    BOOST_REQUIRE_EQUAL(events.size(), 2);
+    BOOST_CHECK(events[1].event == Event::modify);
+    BOOST_CHECK(events[1].path == "/tmp/a/two");
+    BOOST_CHECK(input.empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(WatchServerSharedRootTest, WatchServerHelper)
+{
+    RemoteNotify writes(socket_);
+    RemoteNotify creates(socket_);
+    writes.setReadTimeout(std::chrono::seconds(1));
+    creates.setReadTimeout(std::chrono::seconds(1));
+
+    writes.watchPathRecursively({ directory_, Event::close_write });
+    BOOST_REQUIRE(waitForRoots(1));
+    creates.watchPathRecursively({ subDirectory_, Event::create });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_CHECK_EQUAL(server_.roots(), 1);
+
+    const auto file = subDirectory_ / "file.txt";
+    std::ofstream(file) << "remote";
+
+    const auto created = creates.getNextEvent();
+    BOOST_REQUIRE(created);
+    BOOST_CHECK(created->getEvent() == Event::create);
+    BOOST_CHECK(created->getPath() == file);
+
+    const auto written = writes.getNextEvent();
+    BOOST_REQUIRE(written);
+    BOOST_CHECK(written->getEvent() == Event::close_write);
+    BOOST_CHECK(written->getPath() == file);
+}
+
+BOOST_FIXTURE_TEST_CASE(WatchServerDirectoryTest, WatchServerHelper)
+{
+    RemoteNotify flat(socket_);
+    flat.setReadTimeout(std::chrono::milliseconds(300));
+    flat.watchDirectory({ directory_, Event::create });
+    BOOST_REQUIRE(waitForRoots(1));
+
+    // not below the entries of the directory
+    std::ofstream(subDirectory_ / "nested.txt") << "remote";
+    const auto file = directory_ / "file.txt";
+    std::ofstream(file) << "remote";
+
+    const auto created = flat.getNextEvent();
+    BOOST_REQUIRE(created);
+    BOOST_CHECK(created->getPath() == file);
+    BOOST_CHECK(!flat.getNextEvent());
+
+    // a recursive subscription replaces the watch of the entries
+    RemoteNotify recursive(socket_);
+    recursive.setReadTimeout(std::chrono::seconds(1));
+    recursive.watchPathRecursively({ directory_, Event::create });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_CHECK_EQUAL(server_.roots(), 1);
+
+    std::ofstream(subDirectory_ / "second.txt") << "remote";
+    const auto nested = recursive.getNextEvent();
+    BOOST_REQUIRE(nested);
+    BOOST_CHECK(nested->getPath() == subDirectory_ / "second.txt");
+}
+
+BOOST_FIXTURE_TEST_CASE(WatchServerResolvedPathTest, WatchServerHelper)
+{
+    const auto link = directory_ / "link";
+    std::filesystem::create_directory_symlink(subDirectory_, link);
+
+    RemoteNotify client(socket_);
+    client.setReadTimeout(std::chrono::seconds(1));
+    client.watchPathRecursively({ link / ".." / "link", Event::close_write });
+    BOOST_REQUIRE(waitForRoots(1));
+
+    // watched and reported by the resolved path
+    std::ofstream(subDirectory_ / "file.txt") << "remote";
+    const auto written = client.getNextEvent();
+    BOOST_REQUIRE(written);
+    BOOST_CHECK(written->getPath() == subDirectory_ / "file.txt");
+}
+
+BOOST_FIXTURE_TEST_CASE(WatchServerReleaseRootsTest, WatchServerHelper)
+{
+    const auto file = subDirectory_ / "file.txt";
+    std::ofstream(file) << "remote";
+
+    RemoteNotify files(socket_);
+    files.setReadTimeout(std::chrono::milliseconds(300));
+    files.watchFile({ file, Event::close_write });
+    BOOST_REQUIRE(waitForRoots(1));
+
+    {
+        // covers the file, whose watch is removed
+        RemoteNotify recursive(socket_);
+        recursive.watchPathRecursively({ directory_, Event::create });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        BOOST_CHECK_EQUAL(server_.roots(), 1);
+
+        std::ofstream(file) << "once";
+        const auto written = files.getNextEvent();
+        BOOST_REQUIRE(written);
+        BOOST_CHECK(written->getPath() == file);
+        BOOST_CHECK(!files.getNextEvent());
+    }
+
+    // the file is watched again once the directory is released
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_CHECK_EQUAL(server_.roots(), 1);
+    files.unwatch({ file });
+    BOOST_CHECK(waitForRoots(0));
+}
+
+BOOST_FIXTURE_TEST_CASE(WatchServerInputLimitTest, WatchServerHelper)
+{
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_.c_str(), sizeof(address.sun_path) - 1);
+    BOOST_REQUIRE_EQUAL(connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+
+    // a frame never completed, the client is disconnected
+    std::string frame(5, '\0');
+    frame[3] = 0x40;
+    frame.append(128 * 1024, 'x');
+    BOOST_CHECK(send(fd, frame.data(), frame.size(), MSG_NOSIGNAL) > 0);
+
+    struct pollfd readable = { fd, POLLIN, 0 };
+    BOOST_REQUIRE_EQUAL(poll(&readable, 1, 1000), 1);
+    char byte;
+    // closed, reset if the rest was not read
+    BOOST_CHECK_LE(read(fd, &byte, 1), 0);
+    close(fd);
+}
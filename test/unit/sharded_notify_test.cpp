@@ -0,0 +1,172 @@
+#include <notify-cpp/sharded_notify.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace notifycpp;
+
+struct ShardedNotifyHelper {
+    ShardedNotifyHelper()
+        : directory_("shardedNotifyDirectory")
+    {
+        for (int i = 0; i < 8; ++i)
+            std::filesystem::create_directories(directory_ / std::to_string(i) / "sub");
+    }
+
+    ~ShardedNotifyHelper()
+    {
+        std::filesystem::remove_all(directory_);
+    }
+
+    std::filesystem::path directory_;
+};
+
+BOOST_FIXTURE_TEST_CASE(ShardedNotifyMergeTest, ShardedNotifyHelper)
+{
+    ShardedNotify notify(4, false);
+    notify.setReadTimeout(std::chrono::seconds(1));
+    BOOST_CHECK_EQUAL(notify.shards(), 4);
+
+    std::set<std::filesystem::path> expected;
+    for (int i = 0; i < 8; ++i) {
+        notify.watchPathRecursively({ directory_ / std::to_string(i), Event::close_write });
+        expected.insert(directory_ / std::to_string(i) / "sub" / "file.txt");
+    }
+
+    for (const auto& file : expected)
+        std::ofstream(file) << "shard";
+
+    std::set<std::filesystem::path> received;
+    while (received.size() < expected.size()) {
+        const auto event = notify.getNextEvent();
+        BOOST_REQUIRE(event);
+        BOOST_CHECK(event->getEvent() == Event::close_write);
+        received.insert(event->getPath());
+    }
+    BOOST_CHECK(received == expected);
+    BOOST_CHECK_EQUAL(notify.getWatchStatistics().watches, 16);
+}
+
+BOOST_FIXTURE_TEST_CASE(ShardedNotifyUnwatchTest, ShardedNotifyHelper)
+{
+    ShardedNotify notify(2, false);
+    notify.setReadTimeout(std::chrono::milliseconds(300));
+
+    const auto file = directory_ / "0" / "file.txt";
+    std::ofstream(file) << "shard";
+    notify.watchFile({ file, Event::close_write });
+    notify.unwatch({ file });
+    std::ofstream(file) << "unwatched";
+
+    BOOST_CHECK(!notify.getNextEvent());
+}
+
+BOOST_FIXTURE_TEST_CASE(ShardedNotifyCriticalLaneTest, ShardedNotifyHelper)
+{
+    ShardedNotify notify(1, false);
+    notify.setReadTimeout(std::chrono::seconds(1));
+
+    const auto noisy = directory_ / "0";
+    const auto critical = directory_ / "1";
+    notify.watchPathRecursively({ noisy, Event::close_write });
+    notify.watchCriticalPath({ critical, Event::close_write });
+
+    for (int i = 0; i < 100; ++i)
+        std::ofstream(noisy / std::to_string(i)) << "noise";
+    // wait until the noise is decoded, the critical event arrives after it
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::ofstream(critical / "config") << "critical";
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const auto event = notify.getNextEvent();
+    BOOST_REQUIRE(event);
+    BOOST_CHECK(event->getPath() == critical / "config");
+    BOOST_CHECK(event->getPriority() == Priority::critical);
+
+    const auto next = notify.getNextEvent();
+    BOOST_REQUIRE(next);
+    BOOST_CHECK(next->getPriority() == Priority::normal);
+}
+
+BOOST_FIXTURE_TEST_CASE(ShardedNotifyPinnedIgnoreTest, ShardedNotifyHelper)
+{
+    ShardedNotify notify(2, true);
+    notify.setReadTimeout(std::chrono::milliseconds(300));
+    notify.watchPathRecursively({ directory_ / "0", Event::create });
+
+    // forwarded with the next watch while the readers run
+    notify.ignore(directory_ / "1" / "sub");
+    notify.watchPathRecursively({ directory_ / "1", Event::create });
+    std::ofstream(directory_ / "1" / "sub" / "file.txt") << "ignored";
+    std::ofstream(directory_ / "1" / "file.txt") << "seen";
+
+    const auto event = notify.getNextEvent();
+    BOOST_REQUIRE(event);
+    BOOST_CHECK(event->getPath() == directory_ / "1" / "file.txt");
+    BOOST_CHECK(!notify.getNextEvent());
+}
+
+BOOST_FIXTURE_TEST_CASE(ShardedNotifySplitTest, ShardedNotifyHelper)
+{
+    ShardedNotify notify(4, false);
+    notify.setReadTimeout(std::chrono::milliseconds(300));
+    notify.watchPathRecursively({ directory_, Event::close_write });
+    // below the split directory, watched on the shard owning it
+    notify.watchPathRecursively({ directory_ / "0", Event::close_write });
+
+    // placed when its create event is read, which is not reported
+    std::filesystem::create_directories(directory_ / "8");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    const std::vector<std::filesystem::path> files { directory_ / "file.txt", directory_ / "0" / "sub" / "file.txt",
+        directory_ / "5" / "file.txt", directory_ / "8" / "file.txt" };
+    for (const auto& file : files)
+        std::ofstream(file) << "split";
+
+    std::multiset<std::filesystem::path> received;
+    while (const auto event = notify.getNextEvent()) {
+        BOOST_CHECK(event->getEvent() == Event::close_write);
+        received.insert(event->getPath());
+    }
+    BOOST_CHECK(received == std::multiset<std::filesystem::path>(std::begin(files), std::end(files)));
+
+    notify.unwatch({ directory_ });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::ofstream(directory_ / "3" / "file.txt") << "unwatched";
+    BOOST_CHECK(!notify.getNextEvent());
+}
+
+BOOST_FIXTURE_TEST_CASE(ShardedNotifyMovedSubtreeTest, ShardedNotifyHelper)
+{
+    ShardedNotify notify(4, false);
+    notify.setReadTimeout(std::chrono::milliseconds(300));
+    notify.watchPathRecursively({ directory_, Event::close_write });
+
+    // unplaced with its subtree and placed again under the new name
+    const auto moved = directory_ / "moved";
+    std::filesystem::rename(directory_ / "1", moved);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    std::ofstream(moved / "sub" / "file.txt") << "moved";
+
+    std::vector<TFileSystemEventPtr> received;
+    while (auto event = notify.getNextEvent())
+        received.push_back(std::move(event));
+    BOOST_REQUIRE_EQUAL(received.size(), 1);
+    BOOST_CHECK(received.front()->getPath() == moved / "sub" / "file.txt");
+    BOOST_CHECK_GT(received.front()->getShardSequence(), 0);
+
+    notify.unwatch({ directory_ });
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (notify.getWatchStatistics().watches > 0 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    BOOST_CHECK_EQUAL(notify.getWatchStatistics().watches, 0);
+    std::ofstream(moved / "sub" / "file.txt") << "unwatched";
+    BOOST_CHECK(!notify.getNextEvent());
+}
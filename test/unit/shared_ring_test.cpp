@@ -0,0 +1,104 @@
+#include <notify-cpp/shared_ring.h>
+#include <notify-cpp/shared_ring_notify.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <thread>
+
+using namespace notifycpp;
+
+struct SharedRingHelper {
+    SharedRingHelper()
+        : directory_(std::filesystem::absolute("sharedRingDirectory"))
+        , file_(directory_ / "file.txt")
+    {
+        std::filesystem::create_directories(directory_);
+        std::ofstream(file_) << "ring";
+    }
+
+    ~SharedRingHelper()
+    {
+        std::filesystem::remove_all(directory_);
+    }
+
+    std::filesystem::path directory_;
+    std::filesystem::path file_;
+};
+
+BOOST_FIXTURE_TEST_CASE(SharedRingReadTest, SharedRingHelper)
+{
+    SharedRingPublisher publisher(16);
+    SharedRingNotify reader(publisher.path());
+    reader.setReadTimeout(std::chrono::milliseconds(10));
+
+    publisher.publish(FileSystemEvent(file_, Event::modify, 0, 42));
+    publisher.publish(FileSystemEvent(directory_ / "other", Event::create));
+
+    auto event = reader.getNextEvent();
+    BOOST_REQUIRE(event);
+    BOOST_CHECK(event->getPath() == file_);
+    BOOST_CHECK(event->getEvent() == Event::modify);
+    BOOST_CHECK_EQUAL(event->getPid(), 42);
+
+    event = reader.getNextEvent();
+    BOOST_REQUIRE(event);
+    BOOST_CHECK(event->getPath() == directory_ / "other");
+    BOOST_CHECK(!reader.getNextEvent());
+}
+
+BOOST_FIXTURE_TEST_CASE(SharedRingFilterTest, SharedRingHelper)
+{
+    SharedRingPublisher publisher(16);
+    SharedRingNotify reader(publisher.fd());
+    reader.setReadTimeout(std::chrono::milliseconds(10));
+    reader.watchFile({ file_, Event::modify });
+
+    publisher.publish(FileSystemEvent(file_, Event::open));
+    publisher.publish(FileSystemEvent("/elsewhere/file.txt", Event::modify));
+    publisher.publish(FileSystemEvent(file_, Event::modify));
+
+    auto event = reader.getNextEvent();
+    BOOST_REQUIRE(event);
+    BOOST_CHECK(event->getEvent() == Event::modify);
+    BOOST_CHECK(event->getPath() == file_);
+    BOOST_CHECK(!reader.getNextEvent());
+}
+
+BOOST_FIXTURE_TEST_CASE(SharedRingLappedTest, SharedRingHelper)
+{
+    SharedRingPublisher publisher(4);
+    SharedRingNotify reader(publisher.path());
+    reader.setReadTimeout(std::chrono::milliseconds(10));
+
+    for (int i = 0; i < 10; ++i)
+        publisher.publish(FileSystemEvent(directory_ / std::to_string(i), Event::create));
+
+    auto event = reader.getNextEvent();
+    BOOST_REQUIRE(event);
+    BOOST_CHECK(event->getEvent() == Event::overflow);
+    BOOST_CHECK(event->getPath().empty());
+
+    event = reader.getNextEvent();
+    BOOST_REQUIRE(event);
+    BOOST_CHECK(event->getPath() == directory_ / "6");
+    BOOST_CHECK_EQUAL(reader.getLostEvents(), 6);
+}
+
+BOOST_FIXTURE_TEST_CASE(SharedRingWakeTest, SharedRingHelper)
+{
+    SharedRingPublisher publisher;
+    SharedRingNotify reader(publisher.path());
+
+    auto futureEvent = std::async(std::launch::async, [&]() { return reader.getNextEvent(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    publisher.publish(FileSystemEvent(file_, Event::close_write));
+
+    BOOST_REQUIRE(futureEvent.wait_for(std::chrono::seconds(1)) == std::future_status::ready);
+    const auto event = futureEvent.get();
+    BOOST_REQUIRE(event);
+    BOOST_CHECK(event->getPath() == file_);
+}
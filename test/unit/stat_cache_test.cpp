@@ -0,0 +1,99 @@
+#include <notify-cpp/stat_cache.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+
+using namespace notifycpp;
+
+namespace {
+struct StatCacheDirectory {
+    StatCacheDirectory()
+        : root(std::filesystem::absolute("stat_cache.test"))
+    {
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root / "sub");
+    }
+
+    ~StatCacheDirectory()
+    {
+        std::filesystem::remove_all(root);
+    }
+
+    void write(const std::filesystem::path& file, const std::string& content)
+    {
+        std::ofstream stream(file.string(), std::ios::app);
+        stream << content;
+    }
+
+    const std::filesystem::path root;
+};
+}
+
+BOOST_FIXTURE_TEST_CASE(StatCacheInvalidatedByModifyTest, StatCacheDirectory)
+{
+    const auto file = root / "file";
+    write(file, "four");
+
+    StatCache cache;
+    BOOST_CHECK_EQUAL(cache.stat(file).size, 4);
+    write(file, "more");
+    // no event read yet
+    BOOST_CHECK_EQUAL(cache.stat(file).size, 4);
+
+    cache.invalidate(FileSystemEvent(file, Event::access));
+    BOOST_CHECK_EQUAL(cache.stat(file).size, 4);
+
+    cache.invalidate(FileSystemEvent(file, Event::modify));
+    BOOST_CHECK_EQUAL(cache.stat(file).size, 8);
+
+    const auto statistics = cache.getStatistics();
+    BOOST_CHECK_EQUAL(statistics.hits, 2);
+    BOOST_CHECK_EQUAL(statistics.misses, 2);
+    BOOST_CHECK_EQUAL(statistics.entries, 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(StatCacheMissingPathTest, StatCacheDirectory)
+{
+    const auto file = root / "created";
+
+    StatCache cache;
+    BOOST_CHECK_EQUAL(cache.stat(file).error, ENOENT);
+    const auto parent = cache.stat(root).mtime;
+
+    write(file, "new");
+    BOOST_CHECK_EQUAL(cache.stat(file).error, ENOENT);
+
+    cache.invalidate(FileSystemEvent(file, Event::create));
+    const auto created = cache.stat(file);
+    BOOST_CHECK_EQUAL(created.error, 0);
+    BOOST_CHECK_EQUAL(created.size, 3);
+    // the parent directory was dropped as well
+    BOOST_CHECK_EQUAL(cache.getStatistics().hits, 1);
+    BOOST_CHECK_GE(cache.stat(root).mtime, parent);
+    BOOST_CHECK_EQUAL(cache.getStatistics().misses, 4);
+}
+
+BOOST_FIXTURE_TEST_CASE(StatCacheSubtreeTest, StatCacheDirectory)
+{
+    const auto file = root / "sub" / "file";
+    const auto other = root / "subway";
+    write(file, "a");
+    write(other, "b");
+
+    StatCache cache;
+    cache.stat(file);
+    cache.stat(other);
+    cache.stat(root / "sub");
+    BOOST_CHECK_EQUAL(cache.getStatistics().entries, 3);
+
+    std::filesystem::rename(root / "sub", root / "moved");
+    cache.invalidate(FileSystemEvent(root / "sub", Event::moved_from));
+    BOOST_CHECK_EQUAL(cache.getStatistics().entries, 1);
+    BOOST_CHECK_EQUAL(cache.stat(file).error, ENOENT);
+
+    cache.invalidate(FileSystemEvent({}, Event::overflow));
+    BOOST_CHECK_EQUAL(cache.getStatistics().entries, 0);
+}
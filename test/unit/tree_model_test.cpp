@@ -0,0 +1,166 @@
+#include <notify-cpp/snapshot.h>
+#include <notify-cpp/tree_model.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <set>
+#include <vector>
+
+using namespace notifycpp;
+
+struct TreeModelHelper {
+    TreeModelHelper()
+        : root_("treeModelDirectory")
+    {
+        std::filesystem::remove_all(root_);
+        std::filesystem::create_directories(root_ / "a" / "b");
+        std::ofstream(root_ / "a" / "one.txt") << "one";
+        std::ofstream(root_ / "a" / "b" / "two.txt") << "two";
+    }
+
+    ~TreeModelHelper()
+    {
+        std::filesystem::remove_all(root_);
+    }
+
+    std::filesystem::path root_;
+};
+
+BOOST_FIXTURE_TEST_CASE(TreeModelScanTest, TreeModelHelper)
+{
+    TreeModel model(root_);
+    model.scan();
+
+    BOOST_CHECK_EQUAL(model.size(), 4);
+    BOOST_CHECK_EQUAL(model.count(root_ / "a"), 2);
+    BOOST_CHECK_EQUAL(model.count(root_, true), 4);
+
+    const auto entry = model.stat(root_ / "a" / "one.txt");
+    BOOST_REQUIRE(entry);
+    BOOST_CHECK(entry->type == std::filesystem::file_type::regular);
+    BOOST_CHECK_EQUAL(entry->size, 3);
+    BOOST_CHECK(!model.stat(root_ / "missing"));
+
+    std::vector<std::filesystem::path> paths;
+    model.walk(root_ / "a", [&](const std::filesystem::path& path, const TreeModel::Entry&) { paths.push_back(path); });
+    BOOST_CHECK_EQUAL(paths.size(), 3);
+}
+
+BOOST_FIXTURE_TEST_CASE(TreeModelUpdateTest, TreeModelHelper)
+{
+    TreeModel model(root_);
+    model.scan();
+
+    std::filesystem::create_directories(root_ / "c" / "d");
+    model.apply({ root_ / "c", Event::create });
+    BOOST_CHECK_EQUAL(model.count(root_ / "c", true), 1);
+
+    std::ofstream(root_ / "a" / "one.txt") << "longer content";
+    model.apply({ root_ / "a" / "one.txt", Event::modify });
+    BOOST_CHECK_EQUAL(model.stat(root_ / "a" / "one.txt")->size, 14);
+
+    std::filesystem::remove(root_ / "a" / "one.txt");
+    model.apply({ root_ / "a" / "one.txt", Event::delete_sub });
+    BOOST_CHECK(!model.stat(root_ / "a" / "one.txt"));
+    BOOST_CHECK_EQUAL(model.size(), 5);
+}
+
+BOOST_FIXTURE_TEST_CASE(TreeModelRenameTest, TreeModelHelper)
+{
+    TreeModel model(root_);
+    model.scan();
+
+    // paired halves relink the subtree without reading it again
+    model.apply({ root_ / "a", Event::moved_from, 42 });
+    model.apply({ root_ / "renamed", Event::moved_to, 42 });
+    BOOST_CHECK(!model.stat(root_ / "a"));
+    BOOST_CHECK(model.stat(root_ / "renamed" / "b" / "two.txt"));
+
+    // an unpaired moved_from left the tree
+    model.apply({ root_ / "renamed" / "b", Event::moved_from, 43 });
+    model.apply({ root_ / "renamed" / "one.txt", Event::attrib });
+    BOOST_CHECK(!model.stat(root_ / "renamed" / "b"));
+    BOOST_CHECK_EQUAL(model.size(), 2);
+}
+
+BOOST_FIXTURE_TEST_CASE(SnapshotDiffTest, TreeModelHelper)
+{
+    const std::filesystem::path file("treeModel.snapshot");
+    {
+        TreeModel model(root_);
+        model.scan();
+        Snapshot::save(model, file);
+    }
+
+    std::ofstream(root_ / "a" / "one.txt") << "changed while offline";
+    std::filesystem::remove_all(root_ / "a" / "b");
+    std::filesystem::create_directories(root_ / "c");
+    std::ofstream(root_ / "c" / "three.txt") << "three";
+
+    Snapshot snapshot(file);
+    BOOST_CHECK_EQUAL(snapshot.size(), 5);
+    BOOST_CHECK_EQUAL(snapshot.root(), root_);
+
+    std::set<std::pair<std::string, Event>> changes;
+    for (const auto& event : snapshot.diff(2))
+        changes.emplace(event.getPath().string(), event.getEvent());
+
+    const std::set<std::pair<std::string, Event>> expected {
+        { (root_ / "a" / "one.txt").string(), Event::modify },
+        { (root_ / "a" / "b").string(), Event::delete_sub },
+        { (root_ / "a" / "b" / "two.txt").string(), Event::delete_sub },
+        { (root_ / "c").string(), Event::create },
+        { (root_ / "c" / "three.txt").string(), Event::create },
+    };
+    BOOST_CHECK(changes == expected);
+
+    TreeModel model(root_);
+    model.load(snapshot);
+    BOOST_CHECK_EQUAL(model.size(), 4);
+    BOOST_CHECK(model.stat(root_ / "a" / "b" / "two.txt"));
+    std::filesystem::remove(file);
+}
+
+BOOST_AUTO_TEST_CASE(SnapshotInvalidFileTest)
+{
+    const std::filesystem::path file("invalid.snapshot");
+    std::ofstream(file) << "not a snapshot";
+    BOOST_CHECK_THROW(Snapshot snapshot(file), std::runtime_error);
+    std::filesystem::remove(file);
+}
+
+BOOST_FIXTURE_TEST_CASE(SnapshotCorruptRecordTest, TreeModelHelper)
+{
+    const std::filesystem::path file("corrupt.snapshot");
+    {
+        TreeModel model(root_);
+        model.scan();
+        Snapshot::save(model, file);
+    }
+    BOOST_CHECK_EQUAL(Snapshot(file).size(), 5);
+
+    // header of 48 bytes, records of 40 bytes
+    const auto corrupt = [&file](std::size_t offset, auto value) {
+        const std::filesystem::path copy("corrupt.snapshot.copy");
+        std::filesystem::copy_file(file, copy, std::filesystem::copy_options::overwrite_existing);
+        std::fstream stream(copy, std::ios::in | std::ios::out | std::ios::binary);
+        stream.seekp(static_cast<std::streamoff>(offset));
+        stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        stream.close();
+        BOOST_CHECK_THROW(Snapshot snapshot(copy), std::runtime_error);
+        std::filesystem::remove(copy);
+    };
+    const std::size_t second = 48 + 40;
+    // an empty subtree, the walk over the children would not end
+    corrupt(second + 28, std::uint32_t { 0 });
+    corrupt(second + 28, std::uint32_t { 1000 });
+    // a name outside of the names
+    corrupt(second + 24, std::uint32_t { 0xffffffff });
+    corrupt(second + 32, std::uint16_t { 0xffff });
+    // a count whose size overflows
+    corrupt(16, std::uint64_t { 1 } << 59);
+    std::filesystem::remove(file);
+}
@@ -0,0 +1,94 @@
+#include <notify-cpp/string_table.h>
+#include <notify-cpp/watch_tree.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace notifycpp;
+
+BOOST_AUTO_TEST_CASE(WatchTreeSharedPrefixTest)
+{
+    WatchTree tree;
+    const auto a = tree.insert("/srv/data/a");
+    const auto b = tree.insert("/srv/data/b");
+
+    BOOST_CHECK_EQUAL(tree.size(), 5);
+    BOOST_CHECK_EQUAL(tree.path(a), "/srv/data/a");
+    BOOST_CHECK_EQUAL(tree.path(b), "/srv/data/b");
+    BOOST_CHECK_EQUAL(tree.find("/srv/data/b"), b);
+    BOOST_CHECK_EQUAL(tree.find("/srv/data/c"), WatchTree::npos);
+
+    tree.release(a);
+    BOOST_CHECK_EQUAL(tree.size(), 4);
+    tree.release(b);
+    BOOST_CHECK_EQUAL(tree.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(WatchTreeMoveTest)
+{
+    WatchTree tree;
+    const auto directory = tree.insert("/srv/data");
+    const auto file = tree.insert("/srv/data/sub/file");
+    const auto other = tree.insert("/srv/other");
+
+    tree.move(directory, other, "renamed");
+    BOOST_CHECK_EQUAL(tree.path(file), "/srv/other/renamed/sub/file");
+    BOOST_CHECK_EQUAL(tree.find("/srv/other/renamed/sub"), tree.child(tree.find("/srv/other/renamed"), "sub"));
+    BOOST_CHECK_EQUAL(tree.find("/srv/data/sub/file"), WatchTree::npos);
+
+    // a directory can't be moved below itself
+    tree.move(directory, tree.find("/srv/other/renamed/sub"), "loop");
+    BOOST_CHECK_EQUAL(tree.path(directory), "/srv/other/renamed");
+}
+
+BOOST_AUTO_TEST_CASE(WatchTreeDetachTest)
+{
+    WatchTree tree;
+    const auto directory = tree.insert("/srv/data");
+    const auto file = tree.insert("/srv/data/file");
+
+    tree.detach(directory);
+    BOOST_CHECK_EQUAL(tree.find("/srv/data"), WatchTree::npos);
+
+    tree.release(file);
+    tree.release(directory);
+    BOOST_CHECK_EQUAL(tree.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(StringTableInternTest)
+{
+    StringTable table;
+    const auto a = table.intern("src");
+    const auto b = table.intern("include");
+    BOOST_CHECK_EQUAL(table.intern("src"), a);
+    BOOST_CHECK_EQUAL(table.find("include"), b);
+    BOOST_CHECK_EQUAL(table.find("test"), StringTable::npos);
+    BOOST_CHECK_EQUAL(table.get(b), "include");
+
+    for (int i = 0; i < 1000; ++i)
+        table.intern("name" + std::to_string(i));
+    BOOST_CHECK_EQUAL(table.size(), 1002);
+    BOOST_CHECK_EQUAL(table.get(table.find("name999")), "name999");
+    BOOST_CHECK_EQUAL(table.get(a), "src");
+}
+
+BOOST_AUTO_TEST_CASE(WatchTreeLargeTest)
+{
+    WatchTree tree;
+    std::vector<WatchTree::NodeId> nodes;
+    for (int i = 0; i < 100; ++i)
+        for (int j = 0; j < 100; ++j)
+            nodes.push_back(tree.insert("/srv/repository/module" + std::to_string(i) + "/source" + std::to_string(j)));
+
+    BOOST_CHECK_EQUAL(tree.size(), 3 + 100 + 100 * 100);
+    BOOST_CHECK(tree.memoryUsage() / nodes.size() < 64);
+
+    // remove every other entry and check the rest can still be found
+    for (std::size_t i = 0; i < nodes.size(); i += 2)
+        tree.release(nodes[i]);
+    for (std::size_t i = 1; i < nodes.size(); i += 2)
+        BOOST_CHECK_EQUAL(tree.find(tree.path(nodes[i])), nodes[i]);
+    BOOST_CHECK_EQUAL(tree.size(), 3 + 100 + 100 * 50);
+}
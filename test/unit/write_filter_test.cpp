@@ -0,0 +1,90 @@
+#include <notify-cpp/write_filter.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace notifycpp;
+
+namespace {
+struct WriteFilterDirectory {
+    WriteFilterDirectory()
+        : root(std::filesystem::absolute("write_filter.test"))
+    {
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root);
+    }
+
+    ~WriteFilterDirectory()
+    {
+        std::filesystem::remove_all(root);
+    }
+
+    void write(const std::filesystem::path& file, const std::string& content)
+    {
+        std::ofstream(file.string(), std::ios::trunc) << content;
+    }
+
+    const std::filesystem::path root;
+};
+}
+
+BOOST_FIXTURE_TEST_CASE(WriteFilterSmallFileTest, WriteFilterDirectory)
+{
+    const auto file = root / "file";
+    const FileSystemEvent written(file, Event::close_write);
+
+    WriteFilter filter;
+    write(file, "port=8080");
+    BOOST_CHECK(!filter.unchanged(written));
+    write(file, "port=8080");
+    BOOST_CHECK(filter.unchanged(written));
+    // same size
+    write(file, "port=8081");
+    BOOST_CHECK(!filter.unchanged(written));
+
+    BOOST_CHECK(!filter.unchanged(FileSystemEvent(file, Event::modify)));
+    BOOST_CHECK_EQUAL(filter.getSuppressed(), 1);
+
+    // recreated
+    BOOST_CHECK(!filter.unchanged(FileSystemEvent(file, Event::delete_sub)));
+    BOOST_CHECK(!filter.unchanged(written));
+}
+
+BOOST_FIXTURE_TEST_CASE(WriteFilterLargeFileTest, WriteFilterDirectory)
+{
+    const auto file = root / "large";
+    const FileSystemEvent written(file, Event::close_write);
+    std::string content(200 * 1024, 'x');
+
+    WriteFilter filter;
+    write(file, content);
+    BOOST_CHECK(!filter.unchanged(written));
+    // the full digest is not known yet
+    write(file, content);
+    BOOST_CHECK(!filter.unchanged(written));
+    write(file, content);
+    BOOST_CHECK(filter.unchanged(written));
+
+    // outside of the sampled blocks
+    content[20 * 1024] = 'y';
+    write(file, content);
+    BOOST_CHECK(!filter.unchanged(written));
+    write(file, content);
+    BOOST_CHECK(filter.unchanged(written));
+}
+
+BOOST_FIXTURE_TEST_CASE(WriteFilterCapacityTest, WriteFilterDirectory)
+{
+    WriteFilter filter(4);
+    for (int i = 0; i < 16; ++i) {
+        const auto file = root / std::to_string(i);
+        write(file, "same");
+        BOOST_CHECK(!filter.unchanged(FileSystemEvent(file, Event::close_write)));
+    }
+
+    // the last files are kept
+    BOOST_CHECK(filter.unchanged(FileSystemEvent(root / "15", Event::close_write)));
+}